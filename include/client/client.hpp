@@ -4,12 +4,13 @@
 #include <vector>
 
 #include <common/common.hpp>
+#include <common/resultCodec.hpp>
 
 namespace SISD{
 
 /**
-* @brief The encapsulated client class sending request to server. This client always sends formated http
-*       messages to localhost port 80
+* @brief The encapsulated client class sending request to server. This client sends formated http
+*       messages to localhost port 80 unless another server is given
 * 
 * @param 
 * @return 
@@ -27,6 +28,11 @@ public:
         Invalid
     }; 
 
+    enum ResponseFormat{
+        Json = 0,   // human-readable json, the server default
+        Binary      // compact binary layout, see SISD::ResultCodec
+    };
+
     /**
     * @brief the actual request that client sends. Users are expected to use Client::formRequest() to 
     *       construct a request 
@@ -75,10 +81,19 @@ public:
         */
         RequestType type() const;
 
+        /**
+        * @brief returns the response format this request asks the server for
+        * 
+        * @param void
+        * @return the requested response format
+        * 
+        */
+        ResponseFormat format() const;
+
     private:
         Request() = default;
 
-        Request(const FilepathVec& filePath, const RequestType& type);
+        Request(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format);
 
         class Impl;
         std::unique_ptr<Impl> m_impl;
@@ -86,6 +101,16 @@ public:
 
     Client();
 
+    /**
+    * @brief construct a client talking to a server other than localhost port 80
+    * 
+    * @param host host name or address of the server
+    * @param port port number or service name of the server
+    * @return 
+    * 
+    */
+    Client(const std::string& host, const std::string& port);
+
     ~Client();
 
     /**
@@ -94,10 +119,11 @@ public:
     * 
     * @param filePath vector of string containing image files, either relative or absolute
     * @param type request type, value could be any from struct Client::RequestType
+    * @param format the response format to ask the server for
     * @return the constructed request
     * 
     */
-    Request formRequest(const FilepathVec& filePath, const RequestType& type);
+    Request formRequest(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format = Json);
 
     /**
     * @brief sends the request to server and return result in form of json string
@@ -108,6 +134,26 @@ public:
     */
     std::string sendRequest(const Request& req);
 
+    /**
+    * @brief sends an already formatted http message as is, e.g. one recorded by the server's traffic
+    *       capture. The message should ask the server to close the connection after the response
+    * 
+    * @param message the complete http request including headers and body
+    * @return upon success the full response including its headers, otherwise empty
+    * 
+    */
+    std::string sendRaw(const std::string& message);
+
+    /**
+    * @brief decode a binary response returned by sendRequest() into structured results
+    * 
+    * @param response the full response returned by sendRequest(), including its headers
+    * @param out the destination of the decoded images
+    * @return true if the response carried a well-formed binary body
+    * 
+    */
+    static bool decodeResponse(const std::string& response, ImageRecordVec& out);
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_impl;
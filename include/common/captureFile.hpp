@@ -0,0 +1,92 @@
+#ifndef SISD_CAPTURE_FILE_HPP
+#define SISD_CAPTURE_FILE_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <utility>
+#include <vector>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief an http request as it arrived at the server
+*
+* @param
+* @return
+*
+*/
+struct CapturedRequest{
+    uint64_t arrivalUs;     // microseconds since the unix epoch at which the connection was accepted
+    std::string method;
+    std::string uri;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+};
+
+/**
+* @brief reads and writes traffic capture files. A capture is a header followed by records appended in
+*       arrival order, all little-endian:
+*
+*       file   := "SISDCAP" u8 version record*
+*       record := u32 recordLength u64 arrivalUs u16 methodLength method u16 uriLength uri
+*                 u16 headerCount header* u32 bodyLength body
+*       header := u16 nameLength name u32 valueLength value
+*
+*       recordLength counts the bytes after itself, so a record cut short by a crash can be detected and
+*       everything before it is still readable
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC CaptureFile final{
+public:
+    static constexpr uint8_t version = 1;
+
+    /// length of the file header
+    static constexpr std::size_t headerSize = 8;
+
+    /**
+    * @brief append the file header
+    *
+    * @param out the destination buffer
+    * @return void
+    *
+    */
+    static void encodeHeader(std::string& out);
+
+    /**
+    * @brief append one record
+    *
+    * @param request the request to encode
+    * @param out the destination buffer
+    * @return void
+    *
+    */
+    static void encodeRecord(const CapturedRequest& request, std::string& out);
+
+    /**
+    * @brief read and check the file header
+    *
+    * @param in the capture stream, positioned at its start
+    * @return true if the stream is a capture of a supported version
+    *
+    */
+    static bool readHeader(std::istream& in);
+
+    /**
+    * @brief read the next record
+    *
+    * @param in the capture stream, positioned after the header or the previous record
+    * @param out the destination. Its storage is reused
+    * @return true if a complete record was read, false at the end of the capture or on a truncated record
+    *
+    */
+    static bool readRecord(std::istream& in, CapturedRequest& out);
+};
+
+}
+
+#endif //#ifndef SISD_CAPTURE_FILE_HPP
@@ -0,0 +1,150 @@
+#ifndef SISD_RESULT_CODEC_HPP
+#define SISD_RESULT_CODEC_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief a single person found in an image. Colors are stored in OpenCV's BGR order
+*
+* @param
+* @return
+*
+*/
+struct PersonRecord{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    uint32_t attributes;    // bit i is set when ResultCodec::attributeNames[i] is present
+    uint8_t topColor[3];
+    uint8_t bottomColor[3];
+};
+
+/**
+* @brief all persons found in one image
+*
+* @param
+* @return
+*
+*/
+struct ImageRecord{
+    std::string imageName;
+    std::vector<PersonRecord> persons;
+};
+
+using ImageRecordVec = std::vector<ImageRecord>;
+
+/**
+* @brief converts inference results between the structured form and the two wire formats, the default
+*       human-readable json and a compact little-endian binary layout. The binary layout is one or more
+*       concatenated frames:
+*
+*       frame  := "SISR" u16 version u16 reserved u32 imageCount image*
+*       image  := u16 nameLength name u32 personCount person*
+*       person := i32 x i32 y i32 width i32 height u32 attributes u8[3] topColor u8[3] bottomColor u8[2] pad
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC ResultCodec final{
+public:
+    static constexpr std::size_t attributeCount = 8;
+
+    /// attribute names in the order of the attribute classification network outputs
+    static const char* const attributeNames[attributeCount];
+
+    /// the media type clients put in the Accept header to ask for the binary layout
+    static const char* const binaryMimeType;
+
+    static constexpr uint16_t binaryVersion = 1;
+
+    /**
+    * @brief convert a comma-joined attribute string, e.g. "is male,has_bag,", to a bitmask
+    *
+    * @param attributes comma-joined attribute names
+    * @return the bitmask. Unknown names are ignored
+    *
+    */
+    static uint32_t attributeMask(const std::string& attributes);
+
+    /**
+    * @brief convert an attribute bitmask back to the comma-joined string used in json results
+    *
+    * @param mask the bitmask
+    * @return comma-joined attribute names, each followed by a comma
+    *
+    */
+    static std::string attributeString(uint32_t mask);
+
+    /**
+    * @brief append a string as a quoted and escaped json string literal, for json that is assembled by
+    *       hand rather than rendered by toJson()
+    *
+    * @param out the destination buffer
+    * @param text the string, e.g. an image name sent by the client
+    * @return void
+    *
+    */
+    static void appendJsonString(std::string& out, const std::string& text);
+
+    /**
+    * @brief append one binary frame holding all images to the destination buffer
+    *
+    * @param images the images to encode
+    * @param out the destination buffer
+    * @return void
+    *
+    */
+    static void encodeBinary(const ImageRecordVec& images, std::string& out);
+
+    /**
+    * @brief decode every binary frame in the input and append the images to the destination
+    *
+    * @param data start of the binary input
+    * @param size length of the binary input
+    * @param out the destination
+    * @return true if the whole input was well-formed
+    *
+    */
+    static bool decodeBinary(const char* data, std::size_t size, ImageRecordVec& out);
+
+    /**
+    * @brief tell binary frames from json without decoding them
+    *
+    * @param data the encoded results
+    * @return true if the input starts with a binary frame header
+    *
+    */
+    static bool isBinary(const std::string& data);
+
+    /**
+    * @brief render images as the json result object. Images without persons are omitted. Colors are
+    *       not part of the json format
+    *
+    * @param images the images to render
+    * @return json string
+    *
+    */
+    static std::string toJson(const ImageRecordVec& images);
+
+    /**
+    * @brief parse a json result object back to structured form and append it to the destination.
+    *       Colors are left zero since the json format does not carry them
+    *
+    * @param json the json string
+    * @param out the destination
+    * @return true if success
+    *
+    */
+    static bool fromJson(const std::string& json, ImageRecordVec& out);
+};
+
+}
+
+#endif //#ifndef SISD_RESULT_CODEC_HPP
@@ -0,0 +1,83 @@
+#ifndef SISD_LATENCY_HISTOGRAM_HPP
+#define SISD_LATENCY_HISTOGRAM_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief a log-linear latency histogram in the spirit of HdrHistogram. Values are recorded in microseconds
+*       into power of two ranges that are each split into 64 linear sub-buckets, so any recorded value is
+*       reproduced within 1.6% while the whole range up to hours takes a few kilobytes. One histogram is
+*       meant to be owned by a single thread; merge them to report
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC LatencyHistogram final{
+public:
+    LatencyHistogram();
+
+    /**
+    * @brief record one latency
+    *
+    * @param us the latency in microseconds
+    * @return void
+    *
+    */
+    void record(uint64_t us);
+
+    /**
+    * @brief add all values recorded by another histogram
+    *
+    * @param other the histogram to be added
+    * @return void
+    *
+    */
+    void merge(const LatencyHistogram& other);
+
+    /**
+    * @brief discard all recorded values
+    *
+    * @param void
+    * @return void
+    *
+    */
+    void reset();
+
+    /**
+    * @brief the value at the given percentile, reported as the upper bound of the bucket it falls in
+    *
+    * @param p percentile between 0 and 100
+    * @return latency in microseconds, 0 if nothing is recorded
+    *
+    */
+    uint64_t percentile(double p) const;
+
+    uint64_t count() const;
+
+    uint64_t min() const;
+
+    uint64_t max() const;
+
+    double mean() const;
+
+private:
+    static std::size_t bucketIndex(uint64_t us);
+
+    static uint64_t bucketUpperBound(std::size_t idx);
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_min;
+    uint64_t m_max;
+    double m_sum;
+};
+
+}
+
+#endif //#ifndef SISD_LATENCY_HISTOGRAM_HPP
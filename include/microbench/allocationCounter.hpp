@@ -0,0 +1,50 @@
+#ifndef SISD_ALLOCATION_COUNTER_HPP
+#define SISD_ALLOCATION_COUNTER_HPP
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+namespace SISD{
+
+/**
+* @brief number of heap allocations made through operator new by any thread since start-up. The
+*       microbenchmark binary replaces the global operator new to maintain it
+*
+* @param void
+* @return the allocation count
+*
+*/
+uint64_t allocationCount();
+
+/**
+* @brief reports the heap allocations per iteration of a benchmark as its "allocs" counter once it
+*       goes out of scope. Create it right before the benchmark loop
+*
+* @param
+* @return
+*
+*/
+class AllocationScope final{
+public:
+    explicit AllocationScope(benchmark::State& state): m_state(state), m_start(allocationCount()){
+
+    }
+
+    ~AllocationScope(){
+        m_state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocationCount() - m_start),
+                benchmark::Counter::kAvgIterations);
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    benchmark::State& m_state;
+    uint64_t m_start;
+};
+
+}
+
+#endif //#ifndef SISD_ALLOCATION_COUNTER_HPP
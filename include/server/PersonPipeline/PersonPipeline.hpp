@@ -2,13 +2,17 @@
 #define SISD_PERSON_PIPELINE_HPP
 
 #include <common/common.hpp>
+#include <common/resultCodec.hpp>
+#include <server/PersonPipeline/backendConfig.hpp>
 
 namespace SISD{
 
+class StageTimings;
+
 /**
 * @brief This class wraps the entire person decoding-detection-classification pipeline.
 *       For now the decoding is soft-decoding using openCV. Inference workload is carried
-*       on CPU using Intel Openvino toolkit
+*       by an InferenceBackend, by default on CPU using Intel Openvino toolkit
 * 
 * @param 
 * @return 
@@ -17,7 +21,7 @@ namespace SISD{
 class SISD_DECLSPEC PersonPipeline{
 public:
     /**
-    * @brief construct a pipeline
+    * @brief construct a pipeline with the default backend
     * 
     * @param void
     * @return 
@@ -25,6 +29,15 @@ public:
     */
     PersonPipeline();
 
+    /**
+    * @brief construct a pipeline running on the given backend
+    * 
+    * @param config selects and configures the inference backend
+    * @return 
+    * 
+    */
+    explicit PersonPipeline(const BackendConfig& config);
+
     virtual ~PersonPipeline();
 
     /**
@@ -47,6 +60,20 @@ public:
     */
     std::string run(const char* input, std::size_t size, const std::string& imageName);
 
+    /**
+    * @brief run the pipeline with supplied image and return the structured result
+    * 
+    * @param input binnary input of compressed media type e.g. jpeg
+    * @param size length of the binary input
+    * @param imageName the name of image which will be set in the result
+    * @param result destination of the persons found in the image
+    * @param timings if not null, time spent in each pipeline stage is added to it
+    * @return true if success
+    * 
+    */
+    bool run(const char* input, std::size_t size, const std::string& imageName, ImageRecord& result,
+            StageTimings* timings = nullptr);
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_impl;
@@ -0,0 +1,61 @@
+#ifndef SISD_BACKEND_CONFIG_HPP
+#define SISD_BACKEND_CONFIG_HPP
+
+#include <chrono>
+#include <string>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief selects the inference backend of a pipeline and carries its settings
+*
+* @param
+* @return
+*
+*/
+struct SISD_DECLSPEC BackendConfig{
+    enum Type{
+        OpenVino = 0,   // the real networks on OpenVINO. Requires the IR files in the working directory
+        Mock            // synthetic outputs after a fixed delay, see SISD::MockBackend
+    };
+
+    /**
+    * @brief the default configuration: OpenVINO on CPU if the build has it, the mock backend otherwise
+    *
+    * @param void
+    * @return
+    *
+    */
+    BackendConfig();
+
+    /**
+    * @brief look up a backend type by its name
+    *
+    * @param name openvino or mock
+    * @param out the matching type
+    * @return true if the name is known
+    *
+    */
+    static bool parseType(const std::string& name, Type& out);
+
+    Type type;
+
+    /// OpenVINO device the networks are loaded to
+    std::string device;
+
+    /// time the mock spends computing per inference of the detection and the attributes network
+    std::chrono::microseconds mockDetectionDelay;
+    std::chrono::microseconds mockAttributesDelay;
+
+    /// time the mock spends in load(), standing in for reading and compiling the networks
+    std::chrono::microseconds mockLoadDelay;
+
+    /// persons the mock finds in every image
+    unsigned mockPersons;
+};
+
+}
+
+#endif //#ifndef SISD_BACKEND_CONFIG_HPP
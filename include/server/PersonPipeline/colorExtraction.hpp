@@ -0,0 +1,22 @@
+#ifndef SISD_COLOR_EXTRACTION_HPP
+#define SISD_COLOR_EXTRACTION_HPP
+
+#include <opencv2/opencv.hpp>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief find the dominant color of an image region by clustering its pixels with k-means and picking
+*       the center of the largest cluster
+*
+* @param image the BGR region, typically the top or bottom half of a detected person
+* @return the dominant color in BGR
+*
+*/
+SISD_DECLSPEC cv::Vec3b GetAvgColor(const cv::Mat& image);
+
+}
+
+#endif //#ifndef SISD_COLOR_EXTRACTION_HPP
@@ -0,0 +1,125 @@
+#ifndef SISD_INFERENCE_BACKEND_HPP
+#define SISD_INFERENCE_BACKEND_HPP
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <server/PersonPipeline/backendConfig.hpp>
+
+namespace SISD{
+
+/**
+* @brief the inference engine behind the person pipeline. A backend runs the person detection and the
+*       person attributes networks and hands out their raw output tensors; decoding them is left to the
+*       pipeline so that every backend is post-processed the same way.
+*
+*       Outputs of PersonDetection:
+*           0: SSD detections [1, 1, N, 7] of image_id, label, confidence, xmin, ymin, xmax, ymax with the
+*              coordinates normalized to the input image. A negative image_id ends the list
+*       Outputs of PersonAttributes:
+*           0: attribute probabilities [1, ResultCodec::attributeCount]
+*           1: top color point [1, 2], normalized to the person crop
+*           2: bottom color point [1, 2], normalized to the person crop
+*
+*       Backends report failures by throwing std::exception, except load()
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC InferenceBackend{
+public:
+    enum Network{
+        PersonDetection = 0,
+        PersonAttributes,
+        NetworkCount
+    };
+
+    struct Tensor{
+        std::vector<float> data;
+        std::vector<std::size_t> dims;
+    };
+
+    /**
+    * @brief create the backend selected by config
+    *
+    * @param config the backend settings
+    * @return the backend, or null if the type is not available in this build
+    *
+    */
+    static std::unique_ptr<InferenceBackend> create(const BackendConfig& config);
+
+    virtual ~InferenceBackend();
+
+    /**
+    * @brief a short name of the backend for logs
+    *
+    * @param void
+    * @return the name
+    *
+    */
+    virtual const char* name() const = 0;
+
+    /**
+    * @brief load both networks. May be called again to reload them
+    *
+    * @param perfCount whether per-layer performance counters should be collected
+    * @return true if success
+    *
+    */
+    virtual bool load(bool perfCount) = 0;
+
+    /**
+    * @brief set the input of a network, resizing the image as the network requires
+    *
+    * @param network the network to feed
+    * @param image BGR image
+    * @return void
+    *
+    */
+    virtual void enqueue(Network network, const cv::Mat& image) = 0;
+
+    /**
+    * @brief start an inference of a network on its current input
+    *
+    * @param network the network to run
+    * @return void
+    *
+    */
+    virtual void submitRequest(Network network) = 0;
+
+    /**
+    * @brief block until the inference started by submitRequest() is done
+    *
+    * @param network the network to wait for
+    * @return void
+    *
+    */
+    virtual void wait(Network network) = 0;
+
+    /**
+    * @brief copy an output of the last finished inference
+    *
+    * @param network the network the output belongs to
+    * @param index the output, see the class description
+    * @param out destination of the values and their dimensions. Its storage is reused
+    * @return void
+    *
+    */
+    virtual void output(Network network, std::size_t index, Tensor& out) = 0;
+
+    /**
+    * @brief report the per-layer counters of the last inference to SISD::LayerProfile. Backends without
+    *       layers do nothing
+    *
+    * @param network the network to report
+    * @return void
+    *
+    */
+    virtual void accumulatePerformanceCounts(Network network);
+};
+
+}
+
+#endif //#ifndef SISD_INFERENCE_BACKEND_HPP
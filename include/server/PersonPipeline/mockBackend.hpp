@@ -0,0 +1,48 @@
+#ifndef SISD_MOCK_BACKEND_HPP
+#define SISD_MOCK_BACKEND_HPP
+
+#include <server/PersonPipeline/inferenceBackend.hpp>
+
+namespace SISD{
+
+/**
+* @brief an inference backend that needs no models. Every inference keeps the calling thread busy for the
+*       configured delay, like a CPU bound engine would, and then produces synthetic outputs derived from
+*       the input size and a sample of its pixels, so the same image always yields the same persons.
+*       Detections include one non-person and one low confidence person to exercise the filtering
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC MockBackend final : public InferenceBackend{
+public:
+    explicit MockBackend(const BackendConfig& config);
+
+    ~MockBackend();
+
+    const char* name() const override;
+
+    bool load(bool perfCount) override;
+
+    void enqueue(Network network, const cv::Mat& image) override;
+
+    void submitRequest(Network network) override;
+
+    void wait(Network network) override;
+
+    void output(Network network, std::size_t index, Tensor& out) override;
+
+private:
+    std::chrono::microseconds m_delay[NetworkCount];
+    std::chrono::microseconds m_loadDelay;
+    unsigned m_persons;
+
+    /// digest of the current input of each network
+    uint32_t m_seed[NetworkCount];
+    std::chrono::steady_clock::time_point m_submitted[NetworkCount];
+};
+
+}
+
+#endif //#ifndef SISD_MOCK_BACKEND_HPP
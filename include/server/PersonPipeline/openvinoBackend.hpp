@@ -0,0 +1,43 @@
+#ifndef SISD_OPENVINO_BACKEND_HPP
+#define SISD_OPENVINO_BACKEND_HPP
+
+#include <server/PersonPipeline/inferenceBackend.hpp>
+
+namespace SISD{
+
+/**
+* @brief runs person-vehicle-bike-detection-crossroad-0078 and person-attributes-recognition-crossroad-0230
+*       with the Intel OpenVINO inference engine. Only available when the build found OpenVINO
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC OpenVinoBackend final : public InferenceBackend{
+public:
+    explicit OpenVinoBackend(const BackendConfig& config);
+
+    ~OpenVinoBackend();
+
+    const char* name() const override;
+
+    bool load(bool perfCount) override;
+
+    void enqueue(Network network, const cv::Mat& image) override;
+
+    void submitRequest(Network network) override;
+
+    void wait(Network network) override;
+
+    void output(Network network, std::size_t index, Tensor& out) override;
+
+    void accumulatePerformanceCounts(Network network) override;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+
+#endif //#ifndef SISD_OPENVINO_BACKEND_HPP
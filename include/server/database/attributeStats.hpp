@@ -0,0 +1,93 @@
+#ifndef SISD_ATTRIBUTE_STATS_HPP
+#define SISD_ATTRIBUTE_STATS_HPP
+
+#include <chrono>
+
+#include <common/common.hpp>
+#include <common/resultCodec.hpp>
+
+namespace SISD{
+
+/**
+* @brief aggregates of the results saved to the history, kept up to date by HistoryStorage::save() so that
+*       they are answered without reading stored records: images, persons, persons per attribute, persons
+*       per image and box sizes. Counts are kept per minute in a ring of a day's worth of buckets, and every
+*       bucket is sharded per thread like Counter, so saves never contend nor take a lock. A query sums the
+*       buckets of its window.
+*
+*       The aggregates count every result handed to save(), also ones the storage drops later. They start
+*       empty with the process and do not shrink with retention
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC AttributeStats final{
+public:
+    static constexpr int64_t bucketSeconds = 60;
+    static constexpr std::size_t bucketCount = 24 * 60;
+
+    /// persons per image are counted for 0 to 7 persons and for more
+    static constexpr std::size_t personsPerImageBuckets = 9;
+
+    /// box sizes, the square root of the box area in pixels, are counted up to each bound and above the last
+    static constexpr std::size_t boxSizeBuckets = 7;
+    static const int boxSizeBounds[boxSizeBuckets - 1];
+
+    ~AttributeStats();
+
+    AttributeStats(const AttributeStats&) = delete;
+
+    AttributeStats(AttributeStats&&) = delete;
+
+    AttributeStats& operator=(const AttributeStats&) = delete;
+
+    AttributeStats& operator=(AttributeStats&&) = delete;
+
+    /**
+    * @brief get a reference to the global singleton
+    *
+    * @param void
+    * @return reference to AttributeStats
+    *
+    */
+    static AttributeStats& getInstance();
+
+    /**
+    * @brief the longest window that can be queried, a full ring of buckets
+    *
+    * @param void
+    * @return the window
+    *
+    */
+    static std::chrono::seconds maxWindow();
+
+    /**
+    * @brief count the results of one request
+    *
+    * @param images the results
+    * @param timeMs when they were saved, in milliseconds since epoch. Results older than the ring are ignored
+    * @return void
+    *
+    */
+    void record(const ImageRecordVec& images, int64_t timeMs);
+
+    /**
+    * @brief render the aggregates of the buckets in a window ending now as json
+    *
+    * @param window the length of the window, rounded up to whole buckets and at most maxWindow()
+    * @return json string
+    *
+    */
+    std::string toJson(std::chrono::seconds window) const;
+
+private:
+    AttributeStats();
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+
+#endif //#ifndef SISD_ATTRIBUTE_STATS_HPP
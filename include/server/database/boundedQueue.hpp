@@ -0,0 +1,150 @@
+#ifndef SISD_BOUNDED_QUEUE_HPP
+#define SISD_BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief a fixed capacity lock-free multi-producer multi-consumer queue. Every cell carries a sequence
+*       number telling whether it is free for the producer or filled for the consumer of a given lap, so a
+*       push or pop is one compare-and-swap on the shared position plus a release store on the cell
+*
+* @param T element type, must be default constructible and movable
+* @return
+*
+*/
+template <typename T>
+class BoundedQueue final{
+public:
+    /**
+    * @brief construct an empty queue
+    *
+    * @param capacity the maximum number of elements, rounded up to a power of two
+    * @return
+    *
+    */
+    explicit BoundedQueue(std::size_t capacity): m_mask(roundUp(capacity) - 1u), m_cells(new Cell[m_mask + 1u]),
+            m_enqueuePos(0u), m_dequeuePos(0u){
+        for(std::size_t i = 0; i <= m_mask; ++i){
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+    * @brief append an element unless the queue is full
+    *
+    * @param value the element. Left untouched if the queue is full
+    * @return true if the element was queued
+    *
+    */
+    bool tryPush(T&& value){
+        Cell* cell;
+        std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while(true){
+            cell = &m_cells[pos & m_mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if(diff == 0){
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)){
+                    break;
+                }
+            }
+            else if(diff < 0){
+                return false;
+            }
+            else{
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1u, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * @brief remove the oldest element unless the queue is empty
+    *
+    * @param out destination of the element
+    * @return true if an element was removed
+    *
+    */
+    bool tryPop(T& out){
+        Cell* cell;
+        std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while(true){
+            cell = &m_cells[pos & m_mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1u);
+            if(diff == 0){
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)){
+                    break;
+                }
+            }
+            else if(diff < 0){
+                return false;
+            }
+            else{
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->value);
+        cell->sequence.store(pos + m_mask + 1u, std::memory_order_release);
+        return true;
+    }
+
+    /**
+    * @brief the number of queued elements. Only a snapshot while other threads push or pop
+    *
+    * @param void
+    * @return element count
+    *
+    */
+    std::size_t size() const{
+        const std::size_t dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+        const std::size_t enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0u;
+    }
+
+    std::size_t capacity() const{
+        return m_mask + 1u;
+    }
+
+private:
+    struct Cell{
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    static std::size_t roundUp(std::size_t capacity){
+        std::size_t ret = 2u;
+        while(ret < capacity){
+            ret <<= 1u;
+        }
+        return ret;
+    }
+
+    const std::size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    // producers and consumers update their position on separate cache lines. Padded rather than aligned
+    //  since the queue may be allocated with new, which ignores extended alignment before C++17
+    char m_pad0[64];
+    std::atomic<std::size_t> m_enqueuePos;
+    char m_pad1[64 - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> m_dequeuePos;
+    char m_pad2[64 - sizeof(std::atomic<std::size_t>)];
+};
+
+}
+
+#endif //#ifndef SISD_BOUNDED_QUEUE_HPP
@@ -0,0 +1,115 @@
+#ifndef SISD_HISTORY_EXPORT_HPP
+#define SISD_HISTORY_EXPORT_HPP
+
+#include <memory>
+#include <string>
+
+#include <server/database/historyStorage.hpp>
+
+namespace SISD{
+
+/**
+* @brief streams the records of a time range for bulk export, one page of HistoryStorage::exportRange()
+*       at a time, so that only a page and its encoding are held in memory however large the history is.
+*       Records come oldest first in one of two formats:
+*
+*       Ndjson: one json object per line, {"handle":"<handle>","time":<ms>,"result":<result object>}, with a
+*       null result for a record that cannot be decoded
+*
+*       Columnar: one length-prefixed batch per page, all integers little-endian:
+*
+*       batch := "SISC" u16 version u16 reserved u32 length u32 recordCount u32 personCount
+*                i64 time[recordCount] u64 handle[recordCount] u32 persons[recordCount]
+*                i32 x[personCount] i32 y[personCount] i32 width[personCount] i32 height[personCount]
+*                u32 attributes[personCount] u8 valid[recordCount]
+*
+*       length counts the bytes after it, persons[i] the persons of record i over all its images. valid[i]
+*       is 0 for a record that cannot be decoded, which has no persons then, and 1 otherwise. The output
+*       can be gzip compressed when the server is built with zlib
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC HistoryExport final{
+public:
+    enum Format{
+        Ndjson = 0,
+        Columnar
+    };
+
+    static constexpr uint16_t columnarVersion = 2;
+
+    /**
+    * @brief look up an export format by its name
+    *
+    * @param name ndjson or columnar
+    * @param out the format
+    * @return false if the name is unknown
+    *
+    */
+    static bool parseFormat(const std::string& name, Format& out);
+
+    /**
+    * @brief the media type of an export format
+    *
+    * @param format the format
+    * @return the media type
+    *
+    */
+    static const char* mimeType(Format format);
+
+    /**
+    * @brief whether this build can compress exports
+    *
+    * @param void
+    * @return true if built with zlib
+    *
+    */
+    static bool gzipAvailable();
+
+    /**
+    * @brief prepare an export, nothing is read before the first next()
+    *
+    * @param format the format of the records
+    * @param fromMs start of the time range in milliseconds since epoch, inclusive
+    * @param toMs end of the time range, inclusive
+    * @param pageRecords records read and encoded per chunk
+    * @param gzip compress the output, ignored if gzipAvailable() is false
+    * @return
+    *
+    */
+    HistoryExport(Format format, int64_t fromMs, int64_t toMs, std::size_t pageRecords, bool gzip);
+
+    ~HistoryExport();
+
+    HistoryExport(const HistoryExport&) = delete;
+
+    HistoryExport& operator=(const HistoryExport&) = delete;
+
+    /**
+    * @brief produce the next chunk of the export
+    *
+    * @param chunk receives the chunk, which may be empty while compression buffers the input
+    * @return false once the export is complete or failed
+    *
+    */
+    bool next(std::string& chunk);
+
+    /**
+    * @brief whether reading the history failed, which ends the export early
+    *
+    * @param void
+    * @return true on failure
+    *
+    */
+    bool failed() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+
+#endif //#ifndef SISD_HISTORY_EXPORT_HPP
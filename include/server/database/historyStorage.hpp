@@ -1,16 +1,22 @@
 #ifndef SISD_HISTORY_STORAGE_HPP
 #define SISD_HISTORY_STORAGE_HPP
 
+#include <chrono>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
 #include <common/common.hpp>
+#include <common/resultCodec.hpp>
 
 namespace SISD{
 
 /**
-* @brief the wrapper of database storing history records. Current implementation is Redis, which is a fast
-*       in-memory database
+* @brief the wrapper of database storing history records. The database is a StorageBackend selected in the
+*       options: Redis, which is a fast in-memory database, or an embedded append-only log. Saving is
+*       write-behind: records are queued and a background writer stores them in batches, so callers do not
+*       wait for the database. Records are indexed by the time they were saved and by the attributes of
+*       their persons
 * 
 * @param 
 * @return 
@@ -18,7 +24,75 @@ namespace SISD{
 */
 class SISD_DECLSPEC HistoryStorage final{
 public:
-    using JobHandle = uint32_t;
+    /// unique over restarts, and over servers sharing a Redis, as handles are reserved from the backend
+    using JobHandle = uint64_t;
+
+    /// handle and body of stored records. A body is json or, from format Binary on, a binary frame of
+    ///  ResultCodec. ResultCodec::isBinary() tells them apart, so records are only decoded when a reader
+    ///  needs the other form
+    using RecordVec = std::vector<std::pair<std::string, std::string>>;
+
+    /// the database records are stored in
+    enum BackendType{
+        Redis = 0,      // a Redis server, see SISD::RedisBackend
+        Log             // an append-only log in a local directory, see SISD::LogBackend
+    };
+
+    /// the form records are stored in
+    enum RecordFormat{
+        Json = 0,       // the json result as returned by /predict
+        Binary          // a ResultCodec binary frame, tagged with its version. Keeps colors, which json drops
+    };
+
+    /// records with at least one person matching an attribute filter
+    struct FilterResult{
+        std::vector<std::string> handles;   // in the order records were saved
+        uint64_t persons = 0u;              // matching persons over all these records
+    };
+
+    /// what save() does when the write queue is full
+    enum OverflowPolicy{
+        Block = 0,      // wait for the writer to make room
+        Drop,           // discard the record
+        Spill           // append the record to a local file which the writer stores once it catches up
+    };
+
+    struct Options{
+#ifdef SISD_WITH_REDIS
+        BackendType backend = Redis;
+#else
+        BackendType backend = Log;
+#endif
+        std::string uri = "tcp://127.0.0.1:6379";           // Redis to connect to
+        std::size_t redisPoolSize = 4;                      // connections shared by readers. The writer has its own
+        std::chrono::milliseconds redisConnectTimeout{0};   // longest a connect may take, 0 for no limit
+        std::chrono::milliseconds redisSocketTimeout{0};    // longest a command may take, 0 for no limit
+        std::chrono::milliseconds redisPoolWait{0};         // longest a reader waits for a free connection, 0 for
+                                                            //  no limit
+        bool redisKeepAlive = true;                         // enable TCP keepalive on the connections
+        bool redisCluster = false;                          // uri is a node of a Redis Cluster
+        std::size_t redisShards = 1;                        // hashes the records are spread over by handle
+        std::size_t handleBlock = 1024;                     // handles reserved from the backend at a time
+        std::size_t queueCapacity = 4096;                   // records waiting for the writer
+        std::size_t batchSize = 128;                        // records stored per round-trip
+        std::chrono::milliseconds flushInterval{5};         // longest a record waits for its batch to fill up
+        OverflowPolicy overflow = Block;
+        std::string spillPath = "history.spill";
+        RecordFormat format = Binary;                       // applies to records saved with their results
+        std::string logDir = "history.log";                 // directory of the log segments
+        std::size_t logSegmentBytes = 64u << 20u;           // size of a log segment
+        std::chrono::milliseconds logSyncInterval{0};       // least time between syncs of the log. 0 syncs every
+                                                            //  batch, negative leaves it to the operating system
+        std::size_t cacheRecords = 10000;                   // recent records kept in memory, 0 disables the cache
+        std::size_t cacheBytes = 64u << 20u;                // most memory the cache takes
+        std::chrono::milliseconds cacheWindow{300000};      // records saved longer ago leave the cache, 0 for no
+                                                            //  limit
+        std::chrono::seconds retentionAge{0};               // records saved longer ago are removed, 0 keeps them
+        uint64_t retentionRecords = 0u;                     // most records kept, 0 for no limit
+        uint64_t retentionBytes = 0u;                       // most bytes of record bodies kept, 0 for no limit
+        std::chrono::milliseconds sweepInterval{1000};      // time between two steps of the retention sweeper
+        std::size_t sweepBatch = 1000;                      // most records removed by one step
+    };
 
     ~HistoryStorage();
 
@@ -31,7 +105,8 @@ public:
     HistoryStorage& operator=(HistoryStorage&&) = delete;
 
     /**
-    * @brief get a reference to the global singleton
+    * @brief get a reference to the global singleton. Throws std::exception if the backend cannot be
+    *       opened on the first call
     * 
     * @param void
     * @return reference to HistoryStorage
@@ -40,33 +115,194 @@ public:
     static HistoryStorage& getInstance();
 
     /**
-    * @brief generate a unique job handle that will be used for later save operation
+    * @brief set the options of the singleton. Only takes effect if called before the first getInstance()
+    * 
+    * @param options the connection and the write queue settings
+    * @return void
+    * 
+    */
+    static void configure(const Options& options);
+
+    /**
+    * @brief look up an overflow policy by its name
+    * 
+    * @param name block, drop or spill
+    * @param out the matching policy
+    * @return true if the name is known
+    * 
+    */
+    static bool parseOverflowPolicy(const std::string& name, OverflowPolicy& out);
+
+    /**
+    * @brief look up a backend type by its name
+    * 
+    * @param name redis or log
+    * @param out the matching type
+    * @return true if the name is known
+    * 
+    */
+    static bool parseBackendType(const std::string& name, BackendType& out);
+
+    /**
+    * @brief look up a record format by its name
+    * 
+    * @param name json or binary
+    * @param out the matching format
+    * @return true if the name is known
+    * 
+    */
+    static bool parseRecordFormat(const std::string& name, RecordFormat& out);
+
+    /**
+    * @brief check that a cursor received from a client has the form scan() and scanRange() return: a
+    *       position, "<shard>:<position>" pairs separated by dots when the history is sharded, or
+    *       "<time>-<handle>" of the last record of a time range
+    * 
+    * @param cursor the cursor
+    * @return true if it is well formed. It may still not match the backend, which fails the scan
+    * 
+    */
+    static bool isCursor(const std::string& cursor);
+
+    /**
+    * @brief generate a unique job handle that will be used for later save operation. Handles are taken
+    *       from blocks of Options::handleBlock reserved from the backend, so that only one call per block
+    *       reaches the database and the others are a single atomic increment
     * 
     * @param void
-    * @return a uint32_t handle
+    * @return the handle
     * 
     */
     JobHandle generateHandle();
 
     /**
-    * @brief save a json record to database
+    * @brief a tag of the version of the history, for conditional requests. The version is incremented
+    *       whenever records are saved, stored from the spill file or removed by retention. It starts over
+    *       with every run, so the tag also holds the time the storage was opened
+    * 
+    * @param void
+    * @return "<start time>-<version>"
+    * 
+    */
+    std::string versionTag() const;
+
+    /**
+    * @brief queue a json record to be saved to database
     * 
     * @param handle the unique handle generated using generateHandle()
     * @param json the string to be saved
-    * @return true if success
+    * @return true if the record was queued or spilled, false if it was dropped
     * 
     */
     bool save(JobHandle handle, const std::string& json);
 
     /**
-    * @brief retrieve all records available in database
+    * @brief queue a record to be saved to database in the configured format, and index its persons by
+    *       attribute so that it can be found with filter(). The results are also counted in AttributeStats
     * 
-    * @param res the destination buffer
+    * @param handle the unique handle generated using generateHandle()
+    * @param json the record as json
+    * @param results the structured form of the json
+    * @return true if the record was queued or spilled, false if it was dropped
+    * 
+    */
+    bool save(JobHandle handle, const std::string& json, const ImageRecordVec& results);
+
+    /**
+    * @brief wait until every record queued before this call has been written
+    * 
+    * @param timeout the longest to wait
+    * @return true if everything was written in time
+    * 
+    */
+    bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
+
+    /**
+    * @brief retrieve all records available in database. Records still queued are flushed first
+    * 
+    * @param res the destination buffer, with every record converted to json
     * @return true if success
     * 
     */
     bool getAll(std::unordered_map<std::string, std::string>& res);
 
+    /**
+    * @brief retrieve a page of stored records with HSCAN, so that neither redis nor the caller has to handle the
+    *       whole history at once. The shards are scanned in parallel and the cursor holds the position in
+    *       each. Records still queued are flushed when a scan starts. A record may be returned twice if the
+    *       history grows during a scan
+    * 
+    * @param cursor "0" to start a scan, otherwise the next cursor returned by the previous page
+    * @param count the number of records wanted. Redis treats it as a hint, a page may hold more or fewer
+    * @param res the destination buffer
+    * @param next the cursor of the next page, "0" once the scan is complete
+    * @return true if success
+    * 
+    */
+    bool scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next);
+
+    /**
+    * @brief retrieve a page of the records saved within a time range, oldest first. Only the matching
+    *       records are read: their handles come from a range query on the time index of every shard, merged
+    *       by time, and their bodies from one HMGET per shard. Records still queued are flushed when a scan
+    *       starts. A range the hot cache covers is served from memory instead
+    * 
+    * @param fromMs start of the range in milliseconds since epoch, inclusive
+    * @param toMs end of the range in milliseconds since epoch, inclusive
+    * @param cursor "0" to start a scan, otherwise the next cursor returned by the previous page
+    * @param count the maximum number of records wanted
+    * @param res the destination buffer
+    * @param next the cursor of the next page, "0" once the scan is complete
+    * @return true if success
+    * 
+    */
+    bool scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count, RecordVec& res,
+            std::string& next);
+
+    /**
+    * @brief retrieve a page of the records saved within a time range like scanRange(), together with the
+    *       time every record was saved. Bulk exports use it, so it always reads the backend
+    * 
+    * @param fromMs start of the range in milliseconds since epoch, inclusive
+    * @param toMs end of the range in milliseconds since epoch, inclusive
+    * @param cursor "0" to start a scan, otherwise the next cursor returned by the previous page
+    * @param count the maximum number of records wanted
+    * @param res the destination buffer
+    * @param times receives the time of every record in res
+    * @param next the cursor of the next page, "0" once the scan is complete
+    * @return true if success
+    * 
+    */
+    bool exportRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count, RecordVec& res,
+            std::vector<int64_t>& times, std::string& next);
+
+    /**
+    * @brief find the records with a person having all the given attributes, by intersecting the sets of
+    *       persons indexed per attribute with SINTER in every shard. Records still queued are flushed first.
+    *       A time range the hot cache covers is served from memory instead
+    * 
+    * @param attributes bitmask of the attributes a person must have, see ResultCodec::attributeMask()
+    * @param fromMs start of the time range records must be saved in, in milliseconds since epoch
+    * @param toMs end of the time range, inclusive. A range covering all int64_t values is not checked
+    * @param res the matching handles and the count of matching persons
+    * @return true if success
+    * 
+    */
+    bool filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res);
+
+    /**
+    * @brief retrieve records by handle with one HMGET per shard. Handles of records no longer stored are
+    *       skipped
+    * 
+    * @param handles the handles, for example of a FilterResult
+    * @param offset the first handle to fetch
+    * @param count the number of handles to fetch from offset on
+    * @param res the destination buffer
+    * @return true if success
+    * 
+    */
+    bool fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count, RecordVec& res);
+
 private:
     HistoryStorage();
 
@@ -0,0 +1,167 @@
+#ifndef SISD_HOT_CACHE_HPP
+#define SISD_HOT_CACHE_HPP
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include <server/database/historyStorage.hpp>
+
+namespace SISD{
+
+/**
+* @brief the records saved last, kept in memory so that queries for a recent time window are answered
+*       without the backend. HistoryStorage::save() adds every record; the oldest ones are evicted once
+*       the cache holds more records or bytes than allowed, or records older than its window.
+*
+*       The cache holds every record saved since coveredFrom(), which starts at its creation and moves on
+*       with every eviction. Queries starting at or after it are complete, the others are refused
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC HotCache final{
+public:
+    using RecordVec = HistoryStorage::RecordVec;
+    using FilterResult = HistoryStorage::FilterResult;
+
+    /// time and handle of a record, which orders records like StorageBackend::scanRange() does
+    using Key = std::pair<int64_t, HistoryStorage::JobHandle>;
+
+    /**
+    * @brief construct an empty cache
+    *
+    * @param capacity the most records kept
+    * @param maxBytes the most bytes kept, counting bodies, attributes and bookkeeping
+    * @param window records saved longer ago than this are evicted, 0 for no limit
+    * @param startMs the time from which on every record saved is added
+    * @return
+    *
+    */
+    HotCache(std::size_t capacity, std::size_t maxBytes, std::chrono::milliseconds window, int64_t startMs);
+
+    HotCache(const HotCache&) = delete;
+
+    HotCache& operator=(const HotCache&) = delete;
+
+    /**
+    * @brief add a record that was just saved, evicting the oldest ones if needed
+    *
+    * @param handle the handle of the record
+    * @param timeMs when it was saved
+    * @param body the stored form of the record
+    * @param persons the attribute mask of every person
+    * @return void
+    *
+    */
+    void add(HistoryStorage::JobHandle handle, int64_t timeMs, const std::string& body,
+            const std::vector<uint32_t>& persons);
+
+    /**
+    * @brief take back a record that was added but not saved after all
+    *
+    * @param handle the handle of the record
+    * @return void
+    *
+    */
+    void remove(HistoryStorage::JobHandle handle);
+
+    /**
+    * @brief evict the oldest records until at most the given number are left, after the backend removed
+    *       records for retention, so that no record is served from the cache that the backend no longer holds
+    *
+    * @param records the most records left
+    * @return void
+    *
+    */
+    void trim(std::size_t records);
+
+    /**
+    * @brief the time from which on the cache holds every record saved
+    *
+    * @param void
+    * @return the time in milliseconds since epoch
+    *
+    */
+    int64_t coveredFrom() const;
+
+    /**
+    * @brief read a page of the records saved in a time range, oldest first, like HistoryStorage::scanRange()
+    *
+    * @param fromMs start of the range, inclusive
+    * @param toMs end of the range, inclusive
+    * @param after null to start the range, otherwise the key of the last record of the previous page
+    * @param count the most records returned
+    * @param res receives the records
+    * @param last set to the key of the last record returned, if any
+    * @param more set to whether the range has records after the page
+    * @return false if the cache does not cover where the page starts, nothing is returned then
+    *
+    */
+    bool range(int64_t fromMs, int64_t toMs, const Key* after, std::size_t count, RecordVec& res, Key& last,
+            bool& more) const;
+
+    /**
+    * @brief find the records of a time range with a person having all given attributes, like
+    *       HistoryStorage::filter()
+    *
+    * @param attributes the attribute mask
+    * @param fromMs start of the range, inclusive
+    * @param toMs end of the range, inclusive
+    * @param res receives the matching handles, oldest first, and the matching persons
+    * @return false if the cache does not cover fromMs, nothing is returned then
+    *
+    */
+    bool filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res) const;
+
+    /**
+    * @brief look up records by handle
+    *
+    * @param handles the handles
+    * @param first the first handle looked up
+    * @param last one past the last handle looked up
+    * @param res receives the records in the order of handles
+    * @return false if one of them is not cached, nothing is returned then
+    *
+    */
+    bool find(const std::vector<std::string>& handles, std::size_t first, std::size_t last, RecordVec& res) const;
+
+    /**
+    * @brief the size of the cache
+    *
+    * @param records set to the number of records
+    * @param bytes set to the bytes they take
+    * @return void
+    *
+    */
+    void usage(std::size_t& records, std::size_t& bytes) const;
+
+private:
+    struct Item{
+        std::string body;
+        std::vector<uint32_t> persons;
+    };
+
+    std::size_t sizeOf(const Item& item) const;
+
+    void evict(int64_t nowMs);
+
+    /// evict the oldest record. Expects m_mutex to be held and the cache not to be empty
+    void evictOldest();
+
+    const std::size_t m_capacity;
+    const std::size_t m_maxBytes;
+    const std::chrono::milliseconds m_window;
+
+    mutable std::mutex m_mutex;
+    std::deque<Key> m_order;    // by time, then handle
+    std::unordered_map<HistoryStorage::JobHandle, Item> m_items;
+    std::size_t m_bytes;
+    int64_t m_coveredFrom;
+};
+
+}
+
+#endif //#ifndef SISD_HOT_CACHE_HPP
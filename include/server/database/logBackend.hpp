@@ -0,0 +1,132 @@
+#ifndef SISD_LOG_BACKEND_HPP
+#define SISD_LOG_BACKEND_HPP
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+#include <server/database/storageBackend.hpp>
+
+namespace SISD{
+
+/**
+* @brief stores history in an embedded append-only log, so that the server needs no database. The log is a
+*       directory of segment files, each memory mapped and preallocated to the segment size; a batch is
+*       appended with plain memory copies and a new segment is started when the current one is full. Every
+*       segment starts with "SISDLOG" and a version byte, followed by records:
+*
+*       record := u32 length u32 checksum u64 handle i64 timeMs u32 personCount u32 attributes* body
+*
+*       length counts the bytes after the checksum, which is FNV-1a over them, and a zero length ends the
+*       segment. The index of handles, times and per-attribute persons is kept in memory and rebuilt from
+*       the log at startup, which stops at the first damaged record.
+*
+*       Writes are group committed: all records of a batch are synced to disk together, at most once per
+*       sync interval. Records not synced with their batch are synced by idle() once the interval is over,
+*       so none waits for the next batch.
+*
+*       Retention removes records from the front of the log. The file "head" holds the segment and offset of
+*       the first record kept, and the end of the handles reserved so far, so that both survive a restart;
+*       segments before the head are deleted
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC LogBackend final : public StorageBackend{
+public:
+    explicit LogBackend(const HistoryStorage::Options& options);
+
+    ~LogBackend();
+
+    const char* name() const override;
+
+    HistoryStorage::JobHandle reserveHandles(uint64_t count) override;
+
+    void write(std::vector<Record>& batch) override;
+
+    void scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next) override;
+
+    void scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count, RecordVec& res,
+            std::string& next, std::vector<int64_t>* times) override;
+
+    void filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res) override;
+
+    void fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+            RecordVec& res) override;
+
+    void usage(uint64_t& records, uint64_t& bytes) override;
+
+    std::size_t removeOldest(std::size_t count, int64_t beforeMs, uint64_t& bytes) override;
+
+    void idle() override;
+
+private:
+    struct Segment;
+
+    /// where a record lives in the log
+    struct Entry{
+        HistoryStorage::JobHandle handle;
+        int64_t timeMs;
+        uint32_t segment;
+        uint32_t offset;        // of the record in its segment
+        uint32_t bodyOffset;
+        uint32_t bodyLength;
+        uint64_t firstPerson;   // id of its first person, persons are numbered in the order of the log
+    };
+
+    /// map a segment file, creating it with the given capacity if it does not exist yet
+    void openSegment(const std::string& path, std::size_t capacity);
+
+    /// rebuild the index from the records of a segment from the given offset and find where its free space starts
+    void recover(uint32_t segment, std::size_t offset);
+
+    /// add a record of the log to the in-memory index
+    void index(uint32_t segment, uint32_t offset, uint32_t bodyLength, HistoryStorage::JobHandle handle,
+            int64_t timeMs, const std::vector<uint32_t>& persons);
+
+    /// durably replace the head file with the current head and next free handle
+    void writeHead();
+
+    /// append a record to the current segment, starting a new one if it does not fit
+    void append(const Record& record);
+
+    /// write the appended records of every segment to disk
+    void sync();
+
+    std::string body(const Entry& entry) const;
+
+    std::string m_dir;
+    std::size_t m_segmentBytes;
+    std::chrono::milliseconds m_syncInterval;
+    std::chrono::steady_clock::time_point m_lastSync;
+
+    // guards everything below. The writer only holds it while copying a batch into the mapping
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Segment>> m_segments;   // null for deleted ones
+    std::size_t m_unsynced;     // first segment with records not synced yet
+    std::size_t m_firstSegment; // segment of the head, the ones before it are deleted by the writer
+    std::size_t m_dropped;      // segments deleted so far
+
+    // positions count every record since startup, m_entries starts at the position m_entryBase
+    std::deque<Entry> m_entries;                                                    // in the order of the log
+    std::size_t m_entryBase;
+    std::unordered_map<HistoryStorage::JobHandle, std::size_t> m_byHandle;          // to positions
+    // time, handle and position of every record, sorted by time and then by handle as scanRange() pages them
+    std::vector<std::tuple<int64_t, HistoryStorage::JobHandle, std::size_t>> m_byTime;
+    std::vector<uint64_t> m_postings[ResultCodec::attributeCount];                  // sorted person ids
+    uint64_t m_persons;
+    uint64_t m_bytes;           // of the bodies of the records kept
+    std::size_t m_headSegment;  // of the first record kept, as in the head file
+    std::size_t m_headOffset;
+    HistoryStorage::JobHandle m_nextHandle;     // after the last handle reserved, as in the head file
+
+    // held while the head file is replaced, before m_mutex
+    std::mutex m_headMutex;
+};
+
+}
+
+#endif //#ifndef SISD_LOG_BACKEND_HPP
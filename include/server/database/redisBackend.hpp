@@ -0,0 +1,92 @@
+#ifndef SISD_REDIS_BACKEND_HPP
+#define SISD_REDIS_BACKEND_HPP
+
+#include <server/database/storageBackend.hpp>
+
+namespace sw{
+namespace redis{
+class Redis;
+class RedisCluster;
+class Pipeline;
+}
+}
+
+namespace SISD{
+
+class ShardPool;
+
+/**
+* @brief stores history in Redis, or in a Redis Cluster with Client sw::redis::RedisCluster. Records are
+*       spread by handle over Options::redisShards shards. A shard keeps its records in a hash by handle,
+*       indexes them by the time they were saved in a sorted set and by the attributes of their persons in
+*       one set per attribute, holding a "<handle>.<person index>" member for every person having it:
+*
+*       history:{<shard>}  history:{<shard>}:time  history:{<shard>}:attr:<bit>
+*
+*       The keys of a shard share a hash tag, so that a cluster keeps them in one slot, where they can be
+*       written with one pipeline and intersected, and spreads the shards over its nodes. A single shard on
+*       a plain Redis uses the keys of earlier versions, "history", "history:time" and "history:attr:<bit>".
+*
+*       A batch is written with one pipelined round-trip, or one per shard on a cluster, and reads fan out
+*       to the shards in parallel on threads started with the backend. Handles are reserved by incrementing "history:handle", and
+*       "history:{<shard>}:bytes" counts the size of the records of a shard for retention
+*
+* @param
+* @return
+*
+*/
+template<class Client>
+class SISD_DECLSPEC RedisBackend final : public StorageBackend{
+public:
+    explicit RedisBackend(const HistoryStorage::Options& options);
+
+    ~RedisBackend();
+
+    const char* name() const override;
+
+    HistoryStorage::JobHandle reserveHandles(uint64_t count) override;
+
+    void write(std::vector<Record>& batch) override;
+
+    void scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next) override;
+
+    void scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count, RecordVec& res,
+            std::string& next, std::vector<int64_t>* times) override;
+
+    void filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res) override;
+
+    void fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+            RecordVec& res) override;
+
+    void usage(uint64_t& records, uint64_t& bytes) override;
+
+    std::size_t removeOldest(std::size_t count, int64_t beforeMs, uint64_t& bytes) override;
+
+private:
+    /// the keys of a shard
+    struct Shard{
+        std::string tag;                // hash tag shared by the keys
+        std::string records;
+        std::string times;
+        std::string bytes;
+        std::vector<std::string> attributes;
+    };
+
+    std::size_t shardOf(HistoryStorage::JobHandle handle) const;
+
+    /// queue the commands of the flagged shards with queue(pipeline, shard) and run the pipelines in parallel
+    template<class Queue>
+    void pipelined(std::vector<std::unique_ptr<sw::redis::Pipeline>>& pipes, const std::vector<bool>& shards,
+            const Queue& queue);
+
+    std::unique_ptr<Client> m_ctxP;
+    std::vector<Shard> m_shards;
+    std::vector<std::unique_ptr<sw::redis::Pipeline>> m_writePipes;    // only used by the writer
+    std::vector<std::unique_ptr<sw::redis::Pipeline>> m_sweepPipes;    // only used by removeOldest()
+    std::unique_ptr<ShardPool> m_pool;                                  // runs the parts of a shard each
+    bool m_handleKeyChecked;
+};
+
+}
+
+#endif //#ifndef SISD_REDIS_BACKEND_HPP
@@ -0,0 +1,147 @@
+#ifndef SISD_STORAGE_BACKEND_HPP
+#define SISD_STORAGE_BACKEND_HPP
+
+#include <vector>
+
+#include <server/database/historyStorage.hpp>
+
+namespace SISD{
+
+/**
+* @brief the database behind HistoryStorage. HistoryStorage queues records and hands them to its backend in
+*       batches from a single writer thread, while the read functions are called from request handlers.
+*       A backend has to allow both at the same time.
+*
+*       Backends report failures by throwing std::exception
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC StorageBackend{
+public:
+    /// a record as saved, with everything needed to index it
+    struct Record{
+        HistoryStorage::JobHandle handle;
+        int64_t timeMs;                     // when the record was saved, in milliseconds since epoch
+        std::string body;                   // json or a ResultCodec binary frame
+        std::vector<uint32_t> persons;      // attribute mask of every person
+    };
+
+    using RecordVec = HistoryStorage::RecordVec;
+    using FilterResult = HistoryStorage::FilterResult;
+
+    /**
+    * @brief create the backend selected by the options
+    *
+    * @param options the history storage settings
+    * @return the backend, or null if the type is not available in this build
+    *
+    */
+    static std::unique_ptr<StorageBackend> create(const HistoryStorage::Options& options);
+
+    virtual ~StorageBackend();
+
+    /**
+    * @brief a short name of the backend for logs
+    *
+    * @param void
+    * @return the name
+    *
+    */
+    virtual const char* name() const = 0;
+
+    /**
+    * @brief reserve consecutive handles that are not reserved again, also not after a restart. HistoryStorage
+    *       does not call it from two threads at a time
+    *
+    * @param count the number of handles
+    * @return the first of them
+    *
+    */
+    virtual HistoryStorage::JobHandle reserveHandles(uint64_t count) = 0;
+
+    /**
+    * @brief store and index a batch of records
+    *
+    * @param batch the records, which may be moved from
+    * @return void
+    *
+    */
+    virtual void write(std::vector<Record>& batch) = 0;
+
+    /// see HistoryStorage::scan()
+    virtual void scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next) = 0;
+
+    /// see HistoryStorage::scanRange(). If times is not null, it receives the time of every record
+    virtual void scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+            RecordVec& res, std::string& next, std::vector<int64_t>* times) = 0;
+
+    /// see HistoryStorage::filter()
+    virtual void filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res) = 0;
+
+    /// see HistoryStorage::fetch()
+    virtual void fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+            RecordVec& res) = 0;
+
+    /**
+    * @brief count what is stored
+    *
+    * @param records set to the number of records
+    * @param bytes set to the size of their bodies
+    * @return void
+    *
+    */
+    virtual void usage(uint64_t& records, uint64_t& bytes) = 0;
+
+    /**
+    * @brief remove the records saved first, for retention. HistoryStorage calls it from its sweeper thread,
+    *       while the writer and request handlers keep running, but not from two threads at a time
+    *
+    * @param count the most records to remove
+    * @param beforeMs only records saved before this time are removed
+    * @param bytes set to the size of the bodies removed
+    * @return the number of records removed
+    *
+    */
+    virtual std::size_t removeOldest(std::size_t count, int64_t beforeMs, uint64_t& bytes) = 0;
+
+    /**
+    * @brief called by the writer thread while it has nothing to write, at least once per flush interval, for
+    *       work a backend defers, such as syncing what the last batches wrote
+    *
+    * @param void
+    * @return void
+    *
+    */
+    virtual void idle(){}
+
+    /**
+    * @brief read a cursor of scanRange(), which is "0" to start a range or "<time>-<handle>", the key of the
+    *       last record returned. Pages continue after that key, so records removed meanwhile do not shift them
+    *
+    * @param cursor the cursor
+    * @param timeMs set to the time of the last record returned
+    * @param handle set to its handle
+    * @return false if the cursor starts the range. Throws std::invalid_argument if it is malformed
+    *
+    */
+    static bool rangeKey(const std::string& cursor, int64_t& timeMs, HistoryStorage::JobHandle& handle);
+
+    /// the cursor of scanRange() continuing after the given record, see rangeKey()
+    static std::string rangeCursor(int64_t timeMs, HistoryStorage::JobHandle handle);
+
+protected:
+    /**
+    * @brief read a cursor made of a single position
+    *
+    * @param cursor the cursor
+    * @return the position. Throws std::invalid_argument if the cursor is not a plain number
+    *
+    */
+    static uint64_t position(const std::string& cursor);
+};
+
+}
+
+#endif //#ifndef SISD_STORAGE_BACKEND_HPP
@@ -0,0 +1,129 @@
+#ifndef SISD_JOB_QUEUE_HPP
+#define SISD_JOB_QUEUE_HPP
+
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+#include <common/common.hpp>
+#include <common/resultCodec.hpp>
+#include <server/PersonPipeline/backendConfig.hpp>
+#include <server/database/historyStorage.hpp>
+
+namespace SISD{
+
+/**
+* @brief runs predictions submitted through /jobs in the background, so that no connection is held open for
+*       the time of the pipeline. A pool of worker threads, each with its own PersonPipeline, takes jobs from
+*       a bounded queue in the order they were submitted, so a burst waits in the queue instead of on open
+*       connections. The results of a job are saved to HistoryStorage under its handle like those of
+*       /predict, and kept in memory for a while to be fetched by handle; jobs that have left memory are
+*       looked up in the history.
+*
+*       Jobs still queued when the server stops are discarded
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC JobQueue final{
+public:
+    using JobHandle = HistoryStorage::JobHandle;
+
+    /// images of a job by name, base64 encoded as /predict receives them
+    using ImageMap = std::unordered_map<std::string, std::string>;
+
+    enum Status{
+        Queued = 0,
+        Running,
+        Done,
+        Failed      // the pipeline could not be loaded, or an image is not valid base64
+    };
+
+    struct Options{
+        BackendConfig backend;                          // the inference backend of the workers' pipelines
+        std::size_t workers = 1;                        // threads running jobs, each loading the networks once
+        std::size_t capacity = 256;                     // most jobs waiting for a worker
+        std::size_t keepJobs = 1024;                    // finished jobs kept in memory
+        std::chrono::seconds keepTime{600};             // finished jobs leave memory after this time
+    };
+
+    ~JobQueue();
+
+    JobQueue(const JobQueue&) = delete;
+
+    JobQueue(JobQueue&&) = delete;
+
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    JobQueue& operator=(JobQueue&&) = delete;
+
+    /**
+    * @brief get a reference to the global singleton, which starts the workers on the first call. Call
+    *       HistoryStorage::getInstance() before, so that the storage outlives the workers
+    *
+    * @param void
+    * @return reference to JobQueue
+    *
+    */
+    static JobQueue& getInstance();
+
+    /**
+    * @brief set the options of the singleton. Only takes effect if called before the first getInstance()
+    *
+    * @param options the worker pool and the queue settings
+    * @return void
+    *
+    */
+    static void configure(const Options& options);
+
+    /**
+    * @brief the name of a status, as reported by /jobs
+    *
+    * @param status the status
+    * @return the name
+    *
+    */
+    static const char* statusName(Status status);
+
+    /**
+    * @brief queue a job
+    *
+    * @param images the images of the job, moved from if it is queued
+    * @param handle set to the handle of the job, generated with HistoryStorage::generateHandle()
+    * @return false if the queue is full
+    *
+    */
+    bool submit(ImageMap& images, JobHandle& handle);
+
+    /**
+    * @brief look up a job
+    *
+    * @param handle the handle of the job
+    * @param status set to the status of the job
+    * @param results receives the results once the job is done
+    * @return false if the job is neither in memory nor in the history, or the history cannot be read
+    *
+    */
+    bool lookup(JobHandle handle, Status& status, ImageRecordVec& results);
+
+    /**
+    * @brief be notified when a job finishes
+    *
+    * @param handle the handle of the job
+    * @param finished called from a worker thread once the job is done or failed
+    * @return false if the job is not queued or running, finished is not called then
+    *
+    */
+    bool watch(JobHandle handle, const std::function<void()>& finished);
+
+private:
+    JobQueue();
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+
+#endif //#ifndef SISD_JOB_QUEUE_HPP
@@ -0,0 +1,102 @@
+#ifndef SISD_LAYER_PROFILE_HPP
+#define SISD_LAYER_PROFILE_HPP
+
+#include <atomic>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief aggregates per-layer performance counters of the inference networks across requests. Counting
+*       is off by default since it costs inference time; while it is on the pipeline loads its networks
+*       with performance counting enabled and reports every finished request here
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC LayerProfile final{
+public:
+    ~LayerProfile();
+
+    LayerProfile(const LayerProfile&) = delete;
+
+    LayerProfile(LayerProfile&&) = delete;
+
+    LayerProfile& operator=(const LayerProfile&) = delete;
+
+    LayerProfile& operator=(LayerProfile&&) = delete;
+
+    /**
+    * @brief get a reference to the global singleton
+    *
+    * @param void
+    * @return reference to LayerProfile
+    *
+    */
+    static LayerProfile& getInstance();
+
+    /**
+    * @brief check if performance counting is requested
+    *
+    * @param void
+    * @return true if the networks should be profiled
+    *
+    */
+    bool enabled() const;
+
+    /**
+    * @brief turn performance counting on or off. Pipelines pick the change up before their next run
+    *
+    * @param enable the new state
+    * @return void
+    *
+    */
+    void setEnabled(bool enable);
+
+    /**
+    * @brief discard all aggregated counters
+    *
+    * @param void
+    * @return void
+    *
+    */
+    void reset();
+
+    /**
+    * @brief add one execution of a layer
+    *
+    * @param network name of the network the layer belongs to
+    * @param layer name of the layer
+    * @param layerType type of the layer, e.g. Convolution
+    * @param execType the kernel that ran, e.g. jit_avx512_I8
+    * @param realTimeUs wall time of the layer in microseconds
+    * @param cpuTimeUs cpu time of the layer in microseconds
+    * @return void
+    *
+    */
+    void accumulate(const std::string& network, const std::string& layer, const std::string& layerType,
+            const std::string& execType, long long realTimeUs, long long cpuTimeUs);
+
+    /**
+    * @brief render the aggregated layers as json, sorted by total real time, slowest first
+    *
+    * @param void
+    * @return json string
+    *
+    */
+    std::string toJson() const;
+
+private:
+    LayerProfile();
+
+    std::atomic<bool> m_enabled;
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+
+#endif //#ifndef SISD_LAYER_PROFILE_HPP
@@ -0,0 +1,220 @@
+#ifndef SISD_METRICS_HPP
+#define SISD_METRICS_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include <common/common.hpp>
+#include <server/profiling/stageTimings.hpp>
+
+namespace SISD{
+
+/**
+* @brief a monotonically increasing counter. Updates go to one of several cache line sized shards picked
+*       by the calling thread, so concurrent writers never contend. Shards are summed when read
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC Counter final{
+public:
+    static constexpr std::size_t shardCount = 16;
+
+    Counter();
+
+    Counter(const Counter&) = delete;
+
+    Counter& operator=(const Counter&) = delete;
+
+    void add(uint64_t value = 1u);
+
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard{
+        std::atomic<uint64_t> value;
+    };
+    Shard m_shards[shardCount];
+};
+
+/**
+* @brief a value that can go up and down, e.g. the number of open connections
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC Gauge final{
+public:
+    Gauge();
+
+    Gauge(const Gauge&) = delete;
+
+    Gauge& operator=(const Gauge&) = delete;
+
+    void add(int64_t value = 1);
+
+    void sub(int64_t value = 1);
+
+    void set(int64_t value);
+
+    int64_t value() const;
+
+private:
+    std::atomic<int64_t> m_value;
+};
+
+/**
+* @brief a latency histogram with fixed buckets from 100us to 10s. Like Counter it is sharded per thread
+*       and merged when read
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC Histogram final{
+public:
+    static constexpr std::size_t bucketCount = 16;
+
+    /// upper bounds of the buckets in seconds. The last bucket is unbounded
+    static const double bucketBounds[bucketCount - 1];
+
+    struct Snapshot{
+        uint64_t buckets[bucketCount];  // not cumulative
+        uint64_t count;
+        double sum;                     // in seconds
+    };
+
+    Histogram();
+
+    Histogram(const Histogram&) = delete;
+
+    Histogram& operator=(const Histogram&) = delete;
+
+    void observe(StageTimings::Clock::duration duration);
+
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard{
+        std::atomic<uint64_t> buckets[bucketCount];
+        std::atomic<uint64_t> sumNanoseconds;
+    };
+    Shard m_shards[Counter::shardCount];
+};
+
+/**
+* @brief the process wide registry of server metrics, exported in the Prometheus text format by the
+*       /metrics route
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC Metrics final{
+public:
+    enum Route{
+        Predict = 0,
+        History,
+        Export,
+        Stats,
+        Jobs,
+        MetricsRoute,
+        Debug,
+        Other,
+        RouteCount
+    };
+
+    /// http status codes tracked per route. Anything else is counted as "other"
+    static constexpr std::size_t statusCount = 9;
+    static const int statusCodes[statusCount - 1];
+
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+
+    Metrics(Metrics&&) = delete;
+
+    Metrics& operator=(const Metrics&) = delete;
+
+    Metrics& operator=(Metrics&&) = delete;
+
+    /**
+    * @brief get a reference to the global singleton
+    *
+    * @param void
+    * @return reference to Metrics
+    *
+    */
+    static Metrics& getInstance();
+
+    /**
+    * @brief account a finished request
+    *
+    * @param route the route that served the request
+    * @param status the http status code of the reply
+    * @param duration time spent handling the request
+    * @return void
+    *
+    */
+    void countRequest(Route route, int status, StageTimings::Clock::duration duration);
+
+    /**
+    * @brief account the stage timings of a finished prediction
+    *
+    * @param timings the stage timings of the request
+    * @return void
+    *
+    */
+    void observeStages(const StageTimings& timings);
+
+    /**
+    * @brief render all metrics in the Prometheus text exposition format
+    *
+    * @param void
+    * @return the exposition text
+    *
+    */
+    std::string exposition() const;
+
+    Counter imagesProcessed;
+    Counter personsDetected;
+    Counter bytesReceived;
+    Counter bytesSent;
+    Gauge inferenceQueueDepth;
+    Gauge connectionsInFlight;
+    Histogram storageSaveLatency;
+    Gauge historyQueueDepth;
+    Counter historyBatches;
+    Counter historyRecords;
+    Counter historyDropped;
+    Counter historySpilled;
+    Counter historyWriteErrors;
+    Counter historyJsonBytes;
+    Counter historyStoredBytes;
+    Counter historyExpired;
+    Gauge historyKeptRecords;
+    Gauge historyKeptBytes;
+    Counter historyCacheHits;
+    Counter historyCacheMisses;
+    Gauge historyCacheRecords;
+    Gauge historyCacheBytes;
+    Gauge jobQueueDepth;
+    Counter jobsCompleted;
+    Counter jobsFailed;
+    Counter jobsRejected;
+    Counter capturedRequests;
+    Counter capturedBytes;
+
+private:
+    Metrics();
+
+    Counter m_requests[RouteCount][statusCount];
+    Histogram m_requestLatency[RouteCount];
+    Histogram m_stageLatency[StageTimings::StageCount];
+};
+
+}
+
+#endif //#ifndef SISD_METRICS_HPP
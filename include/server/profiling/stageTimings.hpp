@@ -0,0 +1,140 @@
+#ifndef SISD_STAGE_TIMINGS_HPP
+#define SISD_STAGE_TIMINGS_HPP
+
+#include <chrono>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief accumulated wall time spent in each stage of serving a prediction. One instance is kept per
+*       request and one per image, so a slow request can be attributed to the stage responsible
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC StageTimings final{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Stage{
+        Receive = 0,        // reading the request from the socket, excluding parsing
+        Parse,              // http request parsing
+        Base64Decode,       // decoding the base64 image payloads
+        ImageDecode,        // decoding the compressed image
+        Preprocess,         // resizing and copying pixels into network inputs
+        Detection,          // person detection inference
+        Attributes,         // person attributes inference
+        ColorExtraction,    // top and bottom color clustering
+        Serialization,      // rendering the results
+        Storage,            // saving the results to history storage
+        StageCount
+    };
+
+    /**
+    * @brief adds the elapsed time between construction and destruction to a stage
+    *
+    * @param
+    * @return
+    *
+    */
+    class SISD_DECLSPEC Scope final{
+    public:
+        Scope(StageTimings* timings, Stage stage);
+
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StageTimings* m_timings;
+        Stage m_stage;
+        Clock::time_point m_start;
+    };
+
+    StageTimings();
+
+    /**
+    * @brief add a duration to a stage
+    *
+    * @param stage the stage to account to
+    * @param duration the time spent
+    * @return void
+    *
+    */
+    void add(Stage stage, Clock::duration duration);
+
+    /**
+    * @brief add all stages of another instance to this one
+    *
+    * @param other the timings to be added
+    * @return void
+    *
+    */
+    void merge(const StageTimings& other);
+
+    /**
+    * @brief clear all stages
+    *
+    * @param void
+    * @return void
+    *
+    */
+    void reset();
+
+    /**
+    * @brief returns the time accumulated in a stage
+    *
+    * @param stage the stage to query
+    * @return the accumulated duration
+    *
+    */
+    Clock::duration duration(Stage stage) const;
+
+    /**
+    * @brief returns the time accumulated in a stage
+    *
+    * @param stage the stage to query
+    * @return time in milliseconds
+    *
+    */
+    double milliseconds(Stage stage) const;
+
+    /**
+    * @brief returns the name of a stage as used in headers and json
+    *
+    * @param stage the stage
+    * @return a lower case name
+    *
+    */
+    static const char* name(Stage stage);
+
+    /**
+    * @brief render the stages as the value of a Server-Timing header, e.g. "receive;dur=1.250, parse;dur=0.310"
+    *
+    * @param void
+    * @return the header value
+    *
+    */
+    std::string toServerTiming() const;
+
+    /**
+    * @brief render the stages as a json object of milliseconds, e.g. {"receive": 1.250, "parse": 0.310}
+    *
+    * @param void
+    * @return json string
+    *
+    */
+    std::string toJson() const;
+
+private:
+    Clock::duration m_durations[StageCount];
+};
+
+}
+
+#endif //#ifndef SISD_STAGE_TIMINGS_HPP
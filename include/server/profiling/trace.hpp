@@ -0,0 +1,126 @@
+#ifndef SISD_TRACE_HPP
+#define SISD_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+
+#include <common/common.hpp>
+
+namespace SISD{
+
+/**
+* @brief opt-in span tracing for offline profiling. While a capture is running every SISD_TRACE_SCOPE
+*       records its begin time, duration and thread into a buffer owned by the calling thread. Captures
+*       are dumped in the Chrome trace_event json format which loads in Perfetto or chrome://tracing.
+*       When no capture is running a scope costs one relaxed atomic load
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC Trace final{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// spans recorded per thread in a single capture are capped to bound memory
+    static constexpr std::size_t maxSpansPerThread = 1u << 20;
+
+    /**
+    * @brief records the span between its construction and destruction if a capture is running
+    *
+    * @param
+    * @return
+    *
+    */
+    class SISD_DECLSPEC Scope final{
+    public:
+        explicit Scope(const char* name): m_name(name), m_active(Trace::enabled()){
+            if(m_active){
+                m_begin = Clock::now();
+            }
+        }
+
+        ~Scope(){
+            if(m_active){
+                Trace::record(m_name, m_begin, Clock::now());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        bool m_active;
+        Clock::time_point m_begin;
+    };
+
+    /**
+    * @brief check if a capture is running
+    *
+    * @param void
+    * @return true if spans are being recorded
+    *
+    */
+    static bool enabled(){
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief discard previously recorded spans and record new ones for the given duration
+    *
+    * @param duration how long the capture runs
+    * @return void
+    *
+    */
+    static void start(std::chrono::seconds duration);
+
+    /**
+    * @brief stop recording. Recorded spans are kept until the next start()
+    *
+    * @param void
+    * @return void
+    *
+    */
+    static void stop();
+
+    /**
+    * @brief record a finished span. Usually called through SISD_TRACE_SCOPE
+    *
+    * @param name the span name. Must outlive the capture, e.g. a string literal
+    * @param begin the time the span started
+    * @param end the time the span ended
+    * @return void
+    *
+    */
+    static void record(const char* name, Clock::time_point begin, Clock::time_point end);
+
+    /**
+    * @brief render all recorded spans in the Chrome trace_event json format
+    *
+    * @param void
+    * @return json string
+    *
+    */
+    static std::string dumpJson();
+
+    /**
+    * @brief write dumpJson() to a file
+    *
+    * @param path destination file
+    * @return true if success
+    *
+    */
+    static bool dumpToFile(const std::string& path);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+}
+
+/// trace the enclosing scope under the given name
+#define SISD_TRACE_SCOPE(name) ::SISD::Trace::Scope SISD_PP_CONCAT(sisdTraceScope, __LINE__)(name)
+
+#endif //#ifndef SISD_TRACE_HPP
@@ -0,0 +1,103 @@
+#ifndef SISD_TRAFFIC_CAPTURE_HPP
+#define SISD_TRAFFIC_CAPTURE_HPP
+
+#include <atomic>
+
+#include <common/common.hpp>
+
+namespace http {
+namespace server {
+struct request;
+} // namespace server
+} // namespace http
+
+namespace SISD{
+
+/**
+* @brief records incoming requests to an append-only capture file, see SISD::CaptureFile, so that real
+*       traffic can be replayed later with SISDReplay. Requests are sampled, requests with large bodies are
+*       skipped and recording stops once the file reaches its size cap. When no capture is running a call
+*       to record() costs one relaxed atomic load
+*
+* @param
+* @return
+*
+*/
+class SISD_DECLSPEC TrafficCapture final{
+public:
+    struct Options{
+        std::string path;
+        double sampleRate = 1.0;                // fraction of requests recorded
+        uint64_t maxRequestBytes = 64u << 20;   // requests with larger bodies are skipped
+        uint64_t maxFileBytes = 1u << 30;       // recording stops once the file would grow past this
+    };
+
+    ~TrafficCapture();
+
+    TrafficCapture(const TrafficCapture&) = delete;
+
+    TrafficCapture(TrafficCapture&&) = delete;
+
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+
+    TrafficCapture& operator=(TrafficCapture&&) = delete;
+
+    /**
+    * @brief get a reference to the global singleton
+    *
+    * @param void
+    * @return reference to TrafficCapture
+    *
+    */
+    static TrafficCapture& getInstance();
+
+    /**
+    * @brief start recording. An existing capture file is appended to
+    *
+    * @param options the file and the limits of the capture
+    * @return true if the file could be opened
+    *
+    */
+    bool start(const Options& options);
+
+    /**
+    * @brief stop recording and close the file
+    *
+    * @param void
+    * @return void
+    *
+    */
+    void stop();
+
+    /**
+    * @brief check if a capture is running
+    *
+    * @param void
+    * @return true if requests are being recorded
+    *
+    */
+    bool enabled() const{
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief record a complete request, subject to sampling and the size caps
+    *
+    * @param req the parsed request
+    * @return void
+    *
+    */
+    void record(const http::server::request& req);
+
+private:
+    TrafficCapture();
+
+    std::atomic<bool> m_enabled;
+
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+}
+
+#endif //#ifndef SISD_TRAFFIC_CAPTURE_HPP
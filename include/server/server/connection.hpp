@@ -51,7 +51,21 @@ private:
       std::size_t bytes_transferred);
 
   /// Handle completion of a write operation.
-  void handle_write(const boost::system::error_code& e);
+  void handle_write(const boost::system::error_code& e,
+      std::size_t bytes_transferred);
+
+  /// Start writing the reply.
+  void start_write();
+
+  /// Wait for a reply that is not ready yet, see reply::wait.
+  void start_wait();
+
+  /// Complete and write a reply that was waited for, unless that happened
+  /// already.
+  void finish_wait();
+
+  /// Handle expiry of the wait for a reply.
+  void handle_wait_timeout(const boost::system::error_code& e);
 
   /// Socket for the connection.
   boost::asio::ip::tcp::socket socket_;
@@ -74,6 +88,15 @@ private:
 
   /// The reply to be sent back to the client.
   reply reply_;
+
+  /// The chunk of a streamed reply currently being written.
+  std::string chunk_;
+
+  /// Ends the wait for a reply that is not ready yet.
+  boost::asio::steady_timer wait_timer_;
+
+  /// The time the connection was started, used to account the receive stage.
+  SISD::StageTimings::Clock::time_point start_time_;
 };
 
 typedef boost::shared_ptr<connection> connection_ptr;
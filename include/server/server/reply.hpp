@@ -11,6 +11,8 @@
 #ifndef HTTP_REPLY_HPP
 #define HTTP_REPLY_HPP
 
+#include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 #include <boost/asio.hpp>
@@ -49,6 +51,23 @@ struct reply
   /// The content to be sent in the reply.
   std::string content;
 
+  /// Optional producer of the rest of the content, called for one chunk at a
+  /// time once the previous one has been written, so that a large body never
+  /// has to be held in memory. Returns false when there is nothing more to
+  /// send. Streamed replies carry no Content-Length; the body ends when the
+  /// connection is closed, as HTTP/1.0 allows.
+  std::function<bool(std::string& chunk)> next_chunk;
+
+  /// Optional wait for a reply that is not ready yet, such as a long poll.
+  /// Instead of writing the reply the connection calls wait with a function
+  /// that may be called from any thread once the reply can be completed, and
+  /// gives up waiting after wait_timeout. Either way complete is then called
+  /// on the io thread to fill in the reply, which is written as usual. The io
+  /// thread serves other connections meanwhile.
+  std::function<void(const std::function<void()>& ready)> wait;
+  std::chrono::milliseconds wait_timeout{0};
+  std::function<void(reply& rep)> complete;
+
   /// Convert the reply into a vector of buffers. The buffers do not own the
   /// underlying memory blocks, therefore the reply object must remain valid and
   /// not be changed until the write operation has completed.
@@ -11,10 +11,12 @@
 #ifndef HTTP_REQUEST_HPP
 #define HTTP_REQUEST_HPP
 
+#include <chrono>
 #include <string>
 #include <iostream>
 #include <vector>
 #include "header.hpp"
+#include <server/profiling/stageTimings.hpp>
 
 namespace http {
 namespace server {
@@ -28,6 +30,12 @@ struct request
   int http_version_minor;
   std::vector<header> headers;
   std::string jsonData;
+
+  /// Wall clock time at which the connection was accepted.
+  std::chrono::system_clock::time_point arrival;
+
+  /// Time spent in each stage of serving this request.
+  SISD::StageTimings timings;
 };
 
 } // namespace server
@@ -15,6 +15,11 @@
 #include <unordered_map>
 #include <vector>
 #include <boost/noncopyable.hpp>
+#include <server/PersonPipeline/backendConfig.hpp>
+
+namespace SISD {
+class PersonPipeline;
+}
 
 namespace http {
 namespace server {
@@ -27,20 +32,28 @@ class request_handler
   : private boost::noncopyable
 {
 public:
-  /// Construct with a directory containing files to be served.
-  explicit request_handler(const std::string& doc_root);
+  /// Construct with a directory containing files to be served and the
+  /// inference backend predictions run on.
+  request_handler(const std::string& doc_root,
+      const SISD::BackendConfig& backend);
+
+  ~request_handler();
 
   /// Handle a request and produce a reply.
   void handle_request(const request& req, reply& rep);
 
-private:
-  /// The directory containing the files to be served.
-  std::string doc_root_;
+  // The parsing helpers below hold no state. They are public so that the
+  // microbenchmarks can drive them directly.
 
   /// Perform URL-decoding on a string. Returns false if the encoding was
   /// invalid.
   static bool url_decode(const std::string& in, std::string& out);
 
+  /// Split a URL query string into URL-decoded key/value pairs. Returns false
+  /// if the encoding was invalid.
+  static bool parseQuery(const std::string& in,
+      std::unordered_map<std::string, std::string>& out);
+
   static bool retrieveMultipartBoundary(const std::string& in, std::string& out);
 
   static bool retrieveImages(const std::string& boundary, const std::string& in, std::unordered_map<std::string, std::string>& out);
@@ -49,7 +62,25 @@ private:
 
   static bool retrieveImageFromMultiPartMessage(const std::string& in, std::string& out);
 
-  static bool combineJsonResults(const std::vector<std::string>& results, std::stringstream& resultss);
+private:
+  /// The directory containing the files to be served.
+  std::string doc_root_;
+
+  /// The inference backend the pipeline is created with.
+  SISD::BackendConfig backend_;
+
+  /// The person pipeline, loaded by the first prediction and kept for the
+  /// following ones.
+  std::unique_ptr<SISD::PersonPipeline> pipeline_;
+
+  /// Extract the base64 encoded images of a multipart request by name.
+  /// Returns false if the request is not a valid multipart message.
+  static bool retrieveRequestImages(const request& req,
+      std::unordered_map<std::string, std::string>& out);
+
+  /// Check whether the client asked for the binary result layout in its Accept
+  /// header. Json is used otherwise.
+  static bool acceptsBinary(const request& req);
 };
 
 } // namespace server
@@ -26,10 +26,11 @@ class server
   : private boost::noncopyable
 {
 public:
-  /// Construct the server to listen on the specified TCP address and port, and
-  /// serve up files from the given directory.
+  /// Construct the server to listen on the specified TCP address and port,
+  /// serve up files from the given directory and run predictions on the given
+  /// inference backend.
   explicit server(const std::string& address, const std::string& port,
-      const std::string& doc_root);
+      const std::string& doc_root, const SISD::BackendConfig& backend);
 
   /// Run the server's io_context loop.
   void run();
@@ -44,12 +45,18 @@ private:
   /// Handle a request to stop the server.
   void handle_stop();
 
+  /// Handle a request to write the recorded trace spans to a file.
+  void handle_trace_dump();
+
   /// The io_context used to perform asynchronous operations.
   boost::asio::io_context io_context_;
 
   /// The signal_set is used to register for process termination notifications.
   boost::asio::signal_set signals_;
 
+  /// The signal_set used to register for trace dump notifications.
+  boost::asio::signal_set trace_signals_;
+
   /// Acceptor used to listen for incoming connections.
   boost::asio::ip::tcp::acceptor acceptor_;
 
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <server/PersonPipeline/PersonPipeline.hpp>
+#include <server/profiling/stageTimings.hpp>
+
+struct benchOption{
+    std::string imageDir;
+    unsigned concurrency;
+    unsigned iterations;
+    unsigned warmup;
+    std::string jsonPath;
+    SISD::BackendConfig backend;
+};
+
+struct benchImage{
+    std::string name;
+    std::string data;
+};
+
+/// what a single worker measured
+struct workerResult{
+    std::vector<double> latenciesMs;
+    unsigned long long persons = 0;
+    unsigned long long failures = 0;
+    SISD::StageTimings timings;
+};
+
+benchOption parseArguments(int argc, char* argv[])
+{
+    using namespace boost::program_options;
+
+    variables_map vm;
+    options_description opt_desc("This is the offline pipeline benchmark of the Simple Inference Service Demo (SISD).\n\n"
+            "Example usages: SISDBench -d images -c 4 -n 10 -w 2 -j result.json\n\nOptions");
+    opt_desc.add_options()
+        ("help,h", "Produce this help message")
+        ("dir,d", value<std::string>(), "Directory of jpeg images to be inferenced")
+        ("concurrency,c", value<unsigned>()->default_value(1), "Number of pipelines running in parallel, one per thread")
+        ("iterations,n", value<unsigned>()->default_value(10), "Number of passes over the image directory")
+        ("warmup,w", value<unsigned>()->default_value(1), "Number of untimed passes over the image directory per pipeline")
+        ("json,j", value<std::string>(), "Write the report as json to this file")
+        ("backend,b", value<std::string>(), "Inference backend. Value could be openvino or mock. Defaults to openvino if built with it")
+        ("mock-delay-ms", value<double>()->default_value(20.0), "Time the mock backend spends per person detection")
+        ("mock-attributes-delay-ms", value<double>()->default_value(2.0), "Time the mock backend spends per person attributes recognition");
+
+    store(parse_command_line(argc, argv, opt_desc), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << opt_desc << std::endl;
+        exit(0);
+    }
+
+    benchOption ret;
+    if (!vm.count("dir")) {
+        std::cerr << "An image directory is required! Exit" << std::endl;
+        exit(1);
+    }
+    ret.imageDir = vm["dir"].as<std::string>();
+    ret.concurrency = std::max(vm["concurrency"].as<unsigned>(), 1u);
+    ret.iterations = std::max(vm["iterations"].as<unsigned>(), 1u);
+    ret.warmup = vm["warmup"].as<unsigned>();
+    if (vm.count("json")) {
+        ret.jsonPath = vm["json"].as<std::string>();
+    }
+    if (vm.count("backend") && !SISD::BackendConfig::parseType(vm["backend"].as<std::string>(), ret.backend.type)) {
+        std::cerr << "Invalid backend. Value could be openvino or mock. Exit" << std::endl;
+        exit(1);
+    }
+    ret.backend.mockDetectionDelay = std::chrono::microseconds(
+            static_cast<long long>(std::max(vm["mock-delay-ms"].as<double>(), 0.0) * 1000.0));
+    ret.backend.mockAttributesDelay = std::chrono::microseconds(
+            static_cast<long long>(std::max(vm["mock-attributes-delay-ms"].as<double>(), 0.0) * 1000.0));
+    return ret;
+}
+
+bool loadImages(const std::string& dir, std::vector<benchImage>& images){
+    try{
+        for(boost::filesystem::directory_iterator it(dir), end; it != end; ++it){
+            if(!boost::filesystem::is_regular_file(it->path())){
+                continue;
+            }
+            std::string extension = boost::algorithm::to_lower_copy(it->path().extension().string());
+            if(extension != ".jpg" && extension != ".jpeg"){
+                continue;
+            }
+            std::ifstream fileIn(it->path().string(), std::ios::binary);
+            benchImage image;
+            image.name = it->path().filename().string();
+            image.data.assign(std::istreambuf_iterator<char>(fileIn), {});
+            if(!image.data.empty()){
+                images.push_back(std::move(image));
+            }
+        }
+    }
+    catch (const boost::filesystem::filesystem_error& ex){
+        std::cerr << "Encountered an error of " << ex.what() << " upon reading " << dir << std::endl;
+        return false;
+    }
+    std::sort(images.begin(), images.end(), [](const benchImage& l, const benchImage& r){
+        return l.name < r.name;
+    });
+    return !images.empty();
+}
+
+double percentile(const std::vector<double>& sorted, double p){
+    if(sorted.empty()){
+        return 0.0;
+    }
+    std::size_t idx = static_cast<std::size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+int main(int argc, char* argv[]){
+    benchOption opt = parseArguments(argc, argv);
+
+    std::vector<benchImage> images;
+    if(!loadImages(opt.imageDir, images)){
+        std::cerr << "No jpeg images found in " << opt.imageDir << "! Exit" << std::endl;
+        return 1;
+    }
+
+    // every pipeline is loaded before the clock starts
+    std::vector<std::unique_ptr<SISD::PersonPipeline>> pipelines;
+    for(unsigned i = 0; i < opt.concurrency; ++i){
+        pipelines.emplace_back(new SISD::PersonPipeline(opt.backend));
+        if(!pipelines.back()->init()){
+            std::cerr << "Unable to initialize pipeline! Exit" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::size_t totalRuns = static_cast<std::size_t>(opt.iterations) * images.size();
+    std::atomic<std::size_t> nextRun(0u);
+    std::atomic<unsigned> warmedUp(0u);
+    std::vector<workerResult> results(opt.concurrency);
+
+    std::chrono::steady_clock::time_point start;
+    std::vector<std::thread> workers;
+    for(unsigned w = 0; w < opt.concurrency; ++w){
+        workers.emplace_back([&, w](){
+            SISD::PersonPipeline& pipeline = *pipelines[w];
+            workerResult& result = results[w];
+
+            for(unsigned i = 0; i < opt.warmup; ++i){
+                for(const auto& image : images){
+                    SISD::ImageRecord record;
+                    pipeline.run(image.data.data(), image.data.size(), image.name, record);
+                }
+            }
+            // all workers start the timed phase together
+            warmedUp.fetch_add(1u);
+            while(warmedUp.load() < opt.concurrency){
+                std::this_thread::yield();
+            }
+            if(w == 0){
+                start = std::chrono::steady_clock::now();
+            }
+
+            result.latenciesMs.reserve(totalRuns / opt.concurrency + 1);
+            for(std::size_t run = nextRun.fetch_add(1u); run < totalRuns; run = nextRun.fetch_add(1u)){
+                const benchImage& image = images[run % images.size()];
+                SISD::ImageRecord record;
+                auto t0 = std::chrono::steady_clock::now();
+                bool ok = pipeline.run(image.data.data(), image.data.size(), image.name, record, &result.timings);
+                auto t1 = std::chrono::steady_clock::now();
+                result.latenciesMs.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+                result.persons += record.persons.size();
+                result.failures += ok ? 0u : 1u;
+            }
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+    const double elapsedS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // merge what the workers measured
+    std::vector<double> latencies;
+    unsigned long long persons = 0u;
+    unsigned long long failures = 0u;
+    SISD::StageTimings timings;
+    for(const auto& result : results){
+        latencies.insert(latencies.end(), result.latenciesMs.begin(), result.latenciesMs.end());
+        persons += result.persons;
+        failures += result.failures;
+        timings.merge(result.timings);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double stageTotalMs = 0.0;
+    for(int i = 0; i < SISD::StageTimings::StageCount; ++i){
+        stageTotalMs += timings.milliseconds(static_cast<SISD::StageTimings::Stage>(i));
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double peakRssMb = usage.ru_maxrss / 1024.0;     // ru_maxrss is in kilobytes on linux
+
+    std::ostringstream json;
+    char buffer[128];
+    json << "{\n";
+    json << "  \"images\": " << images.size() << ",\n";
+    json << "  \"concurrency\": " << opt.concurrency << ",\n";
+    json << "  \"iterations\": " << opt.iterations << ",\n";
+    json << "  \"warmup\": " << opt.warmup << ",\n";
+    json << "  \"runs\": " << latencies.size() << ",\n";
+    json << "  \"failures\": " << failures << ",\n";
+    std::snprintf(buffer, sizeof(buffer), "  \"elapsed_s\": %.3f,\n", elapsedS);
+    json << buffer;
+    std::snprintf(buffer, sizeof(buffer), "  \"images_per_s\": %.3f,\n", latencies.size() / elapsedS);
+    json << buffer;
+    std::snprintf(buffer, sizeof(buffer), "  \"persons_per_s\": %.3f,\n", persons / elapsedS);
+    json << buffer;
+    std::snprintf(buffer, sizeof(buffer),
+            "  \"latency_ms\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p99.9\": %.3f, \"max\": %.3f},\n",
+            percentile(latencies, 50.0), percentile(latencies, 90.0), percentile(latencies, 99.0),
+            percentile(latencies, 99.9), latencies.empty() ? 0.0 : latencies.back());
+    json << buffer;
+    json << "  \"stage_share\": {";
+    for(int i = 0; i < SISD::StageTimings::StageCount; ++i){
+        SISD::StageTimings::Stage stage = static_cast<SISD::StageTimings::Stage>(i);
+        std::snprintf(buffer, sizeof(buffer), "%s\"%s\": %.4f", i == 0 ? "" : ", ", SISD::StageTimings::name(stage),
+                stageTotalMs > 0.0 ? timings.milliseconds(stage) / stageTotalMs : 0.0);
+        json << buffer;
+    }
+    json << "},\n";
+    std::snprintf(buffer, sizeof(buffer), "  \"peak_rss_mb\": %.1f\n", peakRssMb);
+    json << buffer;
+    json << "}\n";
+
+    std::cout << json.str();
+    if(!opt.jsonPath.empty()){
+        std::ofstream out(opt.jsonPath, std::ios::trunc);
+        out << json.str();
+        if(!out){
+            std::cerr << "Unable to write " << opt.jsonPath << std::endl;
+            return 1;
+        }
+    }
+
+    return failures == 0u ? 0 : 1;
+}
@@ -16,7 +16,7 @@ namespace SISD{
 
 class Client::Request::Impl{
 public:
-    Impl(const FilepathVec& filePath, const RequestType& type);
+    Impl(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format);
 
     Impl();
 
@@ -28,18 +28,21 @@ public:
 
     RequestType type() const;
 
+    ResponseFormat format() const;
+
 private:
     bool m_valid;
     FilepathVec m_filenames;
     RequestType m_type;
+    ResponseFormat m_format;
 };
 
-Client::Request::Impl::Impl(const FilepathVec& filePath, const RequestType& type): m_valid(true),
-        m_filenames(filePath), m_type(type){
+Client::Request::Impl::Impl(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format): m_valid(true),
+        m_filenames(filePath), m_type(type), m_format(format){
 
 }
 
-Client::Request::Impl::Impl():m_valid(false), m_filenames({}), m_type(RequestType::Invalid){
+Client::Request::Impl::Impl():m_valid(false), m_filenames({}), m_type(RequestType::Invalid), m_format(ResponseFormat::Json){
 
 }
 
@@ -59,6 +62,10 @@ Client::RequestType Client::Request::Impl::type() const{
     return m_type;
 }
 
+Client::ResponseFormat Client::Request::Impl::format() const{
+    return m_format;
+}
+
 Client::Request::Request(Request&& req){
     m_impl = std::move(req.m_impl);
 }
@@ -86,28 +93,37 @@ Client::RequestType Client::Request::type() const{
     return m_impl->type();
 }
 
-Client::Request::Request(const FilepathVec& filePath, const RequestType& type){
-    m_impl = std::unique_ptr<Impl>(new Impl(filePath, type));
+Client::ResponseFormat Client::Request::format() const{
+    return m_impl->format();
+}
+
+Client::Request::Request(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format){
+    m_impl = std::unique_ptr<Impl>(new Impl(filePath, type, format));
 }
 
 
 class Client::Impl{
 public:
 
-    Impl();
+    Impl(const std::string& host, const std::string& port);
 
     ~Impl();
 
-    Request formRequest(const FilepathVec& filePath, const RequestType& type);
+    Request formRequest(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format);
 
     std::string sendRequest(const Request& req);
 
+    std::string sendRaw(const std::string& message);
+
 private:
+    std::string m_host;
+    std::string m_port;
+
     // std::string base64Encode(const char* data, std::size_t size) const;
 
 };
 
-Client::Impl::Impl(){
+Client::Impl::Impl(const std::string& host, const std::string& port): m_host(host), m_port(port){
 
 }
 
@@ -115,7 +131,7 @@ Client::Impl::~Impl(){
 
 }
 
-Client::Request Client::Impl::formRequest(const FilepathVec& filePath, const RequestType& type){
+Client::Request Client::Impl::formRequest(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format){
     if(type == Client::Person){
         if(filePath.empty()){
             std::cerr << "File path is empty!" << std::endl;
@@ -147,14 +163,14 @@ Client::Request Client::Impl::formRequest(const FilepathVec& filePath, const Req
             }
         }
         if(valid){
-            return Request(filePath, type);
+            return Request(filePath, type, format);
         }
         else{
             return Request();
         }
     }
     else if(type == Client::History){
-        return Request(filePath, type);
+        return Request(filePath, type, format);
     }
     else{
         // invalid type
@@ -168,7 +184,7 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
 
         // Get a list of endpoints corresponding to the server name.
         boost::asio::ip::tcp::resolver resolver(io_context);
-        boost::asio::ip::tcp::resolver::results_type endpoints = resolver.resolve("localhost", "http");
+        boost::asio::ip::tcp::resolver::results_type endpoints = resolver.resolve(m_host, m_port);
 
         // Try each endpoint until we successfully establish a connection.
         boost::asio::ip::tcp::socket socket(io_context);
@@ -216,7 +232,7 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
             std::ostream request_stream(&request);
             request_stream << "POST " << "/predict" << " HTTP/1.0\r\n";
             // request_stream << "Host: " << "localhost" << "\r\n";
-            request_stream << "Accept: */*\r\n";
+            request_stream << "Accept: " << (req.format() == Client::Binary ? ResultCodec::binaryMimeType : "*/*") << "\r\n";
             request_stream << "Content-Length: " << stringRequestData.length() << "\r\n";
             request_stream << "Content-Type: multipart/form-data; boundary=77580b83-390b-4c34-8393-4eac360c7b42\r\n";
             request_stream << "Connection: close\r\n\r\n";
@@ -249,7 +265,7 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
             }
             else
             {
-                throw ec;
+                throw boost::system::system_error(ec);
             }
             
             // Check that response is OK.
@@ -264,7 +280,7 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
             std::ostream request_stream(&request);
             request_stream << "GET " << "/history" << " HTTP/1.0\r\n";
             // request_stream << "Host: " << "localhost" << "\r\n";
-            request_stream << "Accept: */*\r\n";
+            request_stream << "Accept: " << (req.format() == Client::Binary ? ResultCodec::binaryMimeType : "*/*") << "\r\n";
             request_stream << "Connection: close\r\n\r\n";
 
             // std::stringstream testss;
@@ -291,14 +307,14 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
             }
             else
             {
-                throw ec;
+                throw boost::system::system_error(ec);
             }
             
             // Check that response is OK.
             std::istream response_stream(&response);
             return std::string(std::istreambuf_iterator<char>(response_stream), {});
         }
-
+        return "";
     }
     catch (std::exception& e)
     {
@@ -308,6 +324,32 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
 
 }
 
+std::string Client::Impl::sendRaw(const std::string& message){
+    try{
+        boost::asio::io_context io_context;
+        boost::asio::ip::tcp::resolver resolver(io_context);
+        boost::asio::ip::tcp::socket socket(io_context);
+        boost::asio::connect(socket, resolver.resolve(m_host, m_port));
+
+        boost::asio::write(socket, boost::asio::buffer(message));
+
+        // the server closes the connection after the response, so everything up to EOF is the response
+        boost::asio::streambuf response;
+        boost::system::error_code ec;
+        boost::asio::read(socket, response, boost::asio::transfer_all(), ec);
+        if(ec != boost::asio::error::eof){
+            throw boost::system::system_error(ec);
+        }
+        std::istream response_stream(&response);
+        return std::string(std::istreambuf_iterator<char>(response_stream), {});
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << "\n";
+        return "";
+    }
+}
+
 // std::string Client::Impl::base64Encode(const char* data, std::size_t size) const{
 //     std::stringstream ss;
 //     typedef 
@@ -327,20 +369,41 @@ std::string Client::Impl::sendRequest(const Client::Request& req){
 //     return ss.str();
 // }
 
-Client::Client(){
-    m_impl = std::unique_ptr<Impl>(new Impl);
+Client::Client(): Client("localhost", "http"){
+
+}
+
+Client::Client(const std::string& host, const std::string& port){
+    m_impl = std::unique_ptr<Impl>(new Impl(host, port));
 }
 
 Client::~Client(){
 
 }
 
-Client::Request Client::formRequest(const FilepathVec& filePath, const RequestType& type){
-    return m_impl->formRequest(filePath, type);
+Client::Request Client::formRequest(const FilepathVec& filePath, const RequestType& type, const ResponseFormat& format){
+    return m_impl->formRequest(filePath, type, format);
 }
 
 std::string Client::sendRequest(const Request& req){
     return m_impl->sendRequest(req);
 }
 
+std::string Client::sendRaw(const std::string& message){
+    return m_impl->sendRaw(message);
+}
+
+bool Client::decodeResponse(const std::string& response, ImageRecordVec& out){
+    std::string::size_type bodyIdx = response.find("\r\n\r\n");
+    if(bodyIdx == std::string::npos){
+        return false;
+    }
+    if(response.find(ResultCodec::binaryMimeType) > bodyIdx){
+        // not a binary response
+        return false;
+    }
+    bodyIdx += 4;
+    return ResultCodec::decodeBinary(response.data() + bodyIdx, response.length() - bodyIdx, out);
+}
+
 }
\ No newline at end of file
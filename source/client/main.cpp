@@ -10,6 +10,8 @@ struct sisdOption{
     } type;
 
     std::vector<std::string> images;
+
+    SISD::Client::ResponseFormat format;
 };
 
 sisdOption parseArguments(int argc, char* argv[])
@@ -21,7 +23,8 @@ sisdOption parseArguments(int argc, char* argv[])
     opt_desc.add_options()
         ("help,h", "Produce this help message")
         ("image,i", value<std::vector<std::string>>(), "Input image to be inferenced. Can specify multiple times")
-        ("type,t", value<std::string>(), "Request type. Value could be predict or history");
+        ("type,t", value<std::string>(), "Request type. Value could be predict or history")
+        ("format,f", value<std::string>(), "Response format. Value could be json or binary. Defaults to json");
 
     store(parse_command_line(argc, argv, opt_desc), vm);
     notify(vm);
@@ -48,6 +51,17 @@ sisdOption parseArguments(int argc, char* argv[])
         std::cout << "Request type unset. Defaults to predict"<<std::endl;
         ret.type = sisdOption::Predict;
     }
+    ret.format = SISD::Client::Json;
+    if (vm.count("format")) {
+        std::string format = vm["format"].as<std::string>();
+        if(format == "binary"){
+            ret.format = SISD::Client::Binary;
+        }
+        else if(format != "json"){
+            std::cout<< "Invalid response format. Value could be json or binary. Exit" << std::endl;
+            exit(0);
+        }
+    }
     if(ret.type == sisdOption::Predict){
         if (vm.count("image")) {
             ret.images = vm["image"].as<std::vector<std::string>>();
@@ -65,7 +79,8 @@ int main(int argc, char* argv[]){
 
     SISD::Client client;
 
-    SISD::Client::Request req = client.formRequest(opt.images, opt.type == sisdOption::Predict ? SISD::Client::Person : SISD::Client::History);
+    SISD::Client::Request req = client.formRequest(opt.images, opt.type == sisdOption::Predict ? SISD::Client::Person : SISD::Client::History,
+            opt.format);
 
     if(!req){
         std::cerr << "Not a valid request!"<<std::endl;
@@ -75,7 +90,24 @@ int main(int argc, char* argv[]){
     std::string response = client.sendRequest(req);
 
     std::cout<<"Response received is "<<std::endl;
-    std::cout<<response<<std::endl;
+    if(opt.format == SISD::Client::Binary){
+        SISD::ImageRecordVec results;
+        if(!SISD::Client::decodeResponse(response, results)){
+            std::cerr << "Unable to decode binary response!" << std::endl;
+            std::cout<<response<<std::endl;
+            return 0;
+        }
+        for(const auto& image : results){
+            std::cout << image.imageName << ": " << image.persons.size() << " person(s)" << std::endl;
+            for(const auto& person : image.persons){
+                std::cout << "  (" << person.x << "," << person.y << ")-(" << person.width << "," << person.height << ") "
+                        << SISD::ResultCodec::attributeString(person.attributes) << std::endl;
+            }
+        }
+    }
+    else{
+        std::cout<<response<<std::endl;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <istream>
+
+#include <common/captureFile.hpp>
+
+namespace SISD{
+
+namespace{
+
+const char fileMagic[7] = {'S', 'I', 'S', 'D', 'C', 'A', 'P'};
+
+void putU16(std::string& out, uint16_t v){
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>((v >> 8) & 0xff));
+}
+
+void putU32(std::string& out, uint32_t v){
+    for(int i = 0; i < 4; ++i){
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+void putU64(std::string& out, uint64_t v){
+    for(int i = 0; i < 8; ++i){
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+/// bounds checked reader over a record held in memory
+class RecordReader{
+public:
+    RecordReader(const std::string& data): m_data(data), m_pos(0u){
+
+    }
+
+    bool getU16(uint16_t& v){
+        uint64_t ret;
+        if(!get(2u, ret)){
+            return false;
+        }
+        v = static_cast<uint16_t>(ret);
+        return true;
+    }
+
+    bool getU32(uint32_t& v){
+        uint64_t ret;
+        if(!get(4u, ret)){
+            return false;
+        }
+        v = static_cast<uint32_t>(ret);
+        return true;
+    }
+
+    bool getU64(uint64_t& v){
+        return get(8u, v);
+    }
+
+    bool getString(std::size_t length, std::string& out){
+        if(m_data.length() - m_pos < length){
+            return false;
+        }
+        out.assign(m_data, m_pos, length);
+        m_pos += length;
+        return true;
+    }
+
+    bool atEnd() const{
+        return m_pos == m_data.length();
+    }
+
+private:
+    bool get(std::size_t bytes, uint64_t& v){
+        if(m_data.length() - m_pos < bytes){
+            return false;
+        }
+        v = 0u;
+        for(std::size_t i = 0; i < bytes; ++i){
+            v |= static_cast<uint64_t>(static_cast<unsigned char>(m_data[m_pos + i])) << (8 * i);
+        }
+        m_pos += bytes;
+        return true;
+    }
+
+    const std::string& m_data;
+    std::size_t m_pos;
+};
+
+}
+
+constexpr uint8_t CaptureFile::version;
+constexpr std::size_t CaptureFile::headerSize;
+
+void CaptureFile::encodeHeader(std::string& out){
+    out.append(fileMagic, sizeof(fileMagic));
+    out.push_back(static_cast<char>(version));
+}
+
+void CaptureFile::encodeRecord(const CapturedRequest& request, std::string& out){
+    const std::size_t lengthPos = out.length();
+    putU32(out, 0u);
+    putU64(out, request.arrivalUs);
+    const std::size_t methodLength = std::min<std::size_t>(request.method.length(), UINT16_MAX);
+    putU16(out, static_cast<uint16_t>(methodLength));
+    out.append(request.method, 0, methodLength);
+    const std::size_t uriLength = std::min<std::size_t>(request.uri.length(), UINT16_MAX);
+    putU16(out, static_cast<uint16_t>(uriLength));
+    out.append(request.uri, 0, uriLength);
+    const std::size_t headerCount = std::min<std::size_t>(request.headers.size(), UINT16_MAX);
+    putU16(out, static_cast<uint16_t>(headerCount));
+    for(std::size_t i = 0; i < headerCount; ++i){
+        const std::size_t nameLength = std::min<std::size_t>(request.headers[i].first.length(), UINT16_MAX);
+        putU16(out, static_cast<uint16_t>(nameLength));
+        out.append(request.headers[i].first, 0, nameLength);
+        putU32(out, static_cast<uint32_t>(request.headers[i].second.length()));
+        out.append(request.headers[i].second);
+    }
+    putU32(out, static_cast<uint32_t>(request.body.length()));
+    out.append(request.body);
+
+    // fill in the record length now that it is known
+    const uint32_t recordLength = static_cast<uint32_t>(out.length() - lengthPos - 4u);
+    for(int i = 0; i < 4; ++i){
+        out[lengthPos + i] = static_cast<char>((recordLength >> (8 * i)) & 0xff);
+    }
+}
+
+bool CaptureFile::readHeader(std::istream& in){
+    char header[headerSize];
+    if(!in.read(header, headerSize)){
+        return false;
+    }
+    return std::equal(fileMagic, fileMagic + sizeof(fileMagic), header) &&
+            static_cast<uint8_t>(header[sizeof(fileMagic)]) == version;
+}
+
+bool CaptureFile::readRecord(std::istream& in, CapturedRequest& out){
+    unsigned char lengthBytes[4];
+    if(!in.read(reinterpret_cast<char*>(lengthBytes), sizeof(lengthBytes))){
+        return false;
+    }
+    const uint32_t recordLength = static_cast<uint32_t>(lengthBytes[0]) | (static_cast<uint32_t>(lengthBytes[1]) << 8) |
+            (static_cast<uint32_t>(lengthBytes[2]) << 16) | (static_cast<uint32_t>(lengthBytes[3]) << 24);
+    std::string record(recordLength, '\0');
+    if(!in.read(&record[0], recordLength)){
+        return false;
+    }
+
+    RecordReader reader(record);
+    uint16_t methodLength, uriLength, headerCount;
+    if(!reader.getU64(out.arrivalUs) || !reader.getU16(methodLength) || !reader.getString(methodLength, out.method) ||
+            !reader.getU16(uriLength) || !reader.getString(uriLength, out.uri) || !reader.getU16(headerCount)){
+        return false;
+    }
+    out.headers.resize(headerCount);
+    for(auto& header : out.headers){
+        uint16_t nameLength;
+        uint32_t valueLength;
+        if(!reader.getU16(nameLength) || !reader.getString(nameLength, header.first) ||
+                !reader.getU32(valueLength) || !reader.getString(valueLength, header.second)){
+            return false;
+        }
+    }
+    uint32_t bodyLength;
+    return reader.getU32(bodyLength) && reader.getString(bodyLength, out.body) && reader.atEnd();
+}
+
+}
@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <common/resultCodec.hpp>
+
+namespace SISD{
+
+namespace{
+
+const char frameMagic[4] = {'S', 'I', 'S', 'R'};
+const std::size_t frameHeaderSize = 12;
+const std::size_t personRecordSize = 28;
+
+void putU16(std::string& out, uint16_t v){
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>((v >> 8) & 0xff));
+}
+
+void putU32(std::string& out, uint32_t v){
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>((v >> 8) & 0xff));
+    out.push_back(static_cast<char>((v >> 16) & 0xff));
+    out.push_back(static_cast<char>((v >> 24) & 0xff));
+}
+
+uint16_t getU16(const unsigned char* p){
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t getU32(const unsigned char* p){
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+            (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+}
+
+constexpr std::size_t ResultCodec::attributeCount;
+constexpr uint16_t ResultCodec::binaryVersion;
+
+const char* const ResultCodec::attributeNames[ResultCodec::attributeCount] = {
+    "is male", "has_bag", "has_backpack" , "has hat", "has longsleeves", "has longpants", "has longhair", "has coat_jacket"
+};
+
+const char* const ResultCodec::binaryMimeType = "application/x-sisd-result";
+
+uint32_t ResultCodec::attributeMask(const std::string& attributes){
+    uint32_t mask = 0u;
+    std::string::size_type startIdx = 0;
+    while(startIdx < attributes.length()){
+        std::string::size_type endIdx = attributes.find(',', startIdx);
+        if(endIdx == std::string::npos){
+            endIdx = attributes.length();
+        }
+        const std::string name = attributes.substr(startIdx, endIdx-startIdx);
+        for(std::size_t i = 0; i < attributeCount; ++i){
+            if(name == attributeNames[i]){
+                mask |= (1u << i);
+                break;
+            }
+        }
+        startIdx = endIdx + 1;
+    }
+    return mask;
+}
+
+std::string ResultCodec::attributeString(uint32_t mask){
+    std::string ret;
+    for(std::size_t i = 0; i < attributeCount; ++i){
+        if(mask & (1u << i)){
+            ret += attributeNames[i];
+            ret += ",";
+        }
+    }
+    return ret;
+}
+
+void ResultCodec::appendJsonString(std::string& out, const std::string& text){
+    out.push_back('"');
+    for(char c : text){
+        switch(c){
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20u){
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            }
+            else{
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+void ResultCodec::encodeBinary(const ImageRecordVec& images, std::string& out){
+    std::size_t size = frameHeaderSize;
+    for(const auto& image: images){
+        size += 2 + image.imageName.length() + 4 + image.persons.size() * personRecordSize;
+    }
+    out.reserve(out.size() + size);
+
+    out.append(frameMagic, sizeof(frameMagic));
+    putU16(out, binaryVersion);
+    putU16(out, 0u);
+    putU32(out, static_cast<uint32_t>(images.size()));
+
+    for(const auto& image: images){
+        const std::size_t nameLength = std::min<std::size_t>(image.imageName.length(), 0xffff);
+        putU16(out, static_cast<uint16_t>(nameLength));
+        out.append(image.imageName, 0, nameLength);
+        putU32(out, static_cast<uint32_t>(image.persons.size()));
+        for(const auto& person: image.persons){
+            putU32(out, static_cast<uint32_t>(person.x));
+            putU32(out, static_cast<uint32_t>(person.y));
+            putU32(out, static_cast<uint32_t>(person.width));
+            putU32(out, static_cast<uint32_t>(person.height));
+            putU32(out, person.attributes);
+            out.append(reinterpret_cast<const char*>(person.topColor), 3);
+            out.append(reinterpret_cast<const char*>(person.bottomColor), 3);
+            putU16(out, 0u);
+        }
+    }
+}
+
+bool ResultCodec::decodeBinary(const char* data, std::size_t size, ImageRecordVec& out){
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+
+    while(p != end){
+        if(static_cast<std::size_t>(end - p) < frameHeaderSize || std::memcmp(p, frameMagic, sizeof(frameMagic)) != 0){
+            return false;
+        }
+        if(getU16(p + 4) != binaryVersion){
+            return false;
+        }
+        uint32_t imageCount = getU32(p + 8);
+        p += frameHeaderSize;
+
+        for(uint32_t i = 0; i < imageCount; ++i){
+            if(end - p < 2){
+                return false;
+            }
+            std::size_t nameLength = getU16(p);
+            p += 2;
+            if(static_cast<std::size_t>(end - p) < nameLength + 4){
+                return false;
+            }
+            ImageRecord image;
+            image.imageName.assign(reinterpret_cast<const char*>(p), nameLength);
+            p += nameLength;
+            uint32_t personCount = getU32(p);
+            p += 4;
+            if(static_cast<std::size_t>(end - p) / personRecordSize < personCount){
+                return false;
+            }
+            image.persons.resize(personCount);
+            for(auto& person: image.persons){
+                person.x = static_cast<int32_t>(getU32(p));
+                person.y = static_cast<int32_t>(getU32(p + 4));
+                person.width = static_cast<int32_t>(getU32(p + 8));
+                person.height = static_cast<int32_t>(getU32(p + 12));
+                person.attributes = getU32(p + 16);
+                std::memcpy(person.topColor, p + 20, 3);
+                std::memcpy(person.bottomColor, p + 23, 3);
+                p += personRecordSize;
+            }
+            out.push_back(std::move(image));
+        }
+    }
+    return true;
+}
+
+bool ResultCodec::isBinary(const std::string& data){
+    return data.length() >= sizeof(frameMagic) && std::memcmp(data.data(), frameMagic, sizeof(frameMagic)) == 0;
+}
+
+std::string ResultCodec::toJson(const ImageRecordVec& images){
+    boost::property_tree::ptree jsonTree;
+
+    for(const auto& image: images){
+        boost::property_tree::ptree frameNode;
+
+        for(const auto& person: image.persons){
+            boost::property_tree::ptree roiNode;
+            roiNode.put("x", person.x);
+            roiNode.put("y", person.y);
+            roiNode.put("width", person.width);
+            roiNode.put("height", person.height);
+            roiNode.put("attributes", attributeString(person.attributes));
+
+            frameNode.push_back(std::make_pair("", roiNode));
+        }
+        if(!frameNode.empty()){
+            jsonTree.push_back(std::make_pair(image.imageName, frameNode));
+        }
+    }
+
+    if(jsonTree.empty()){
+        return "{\n}\n";
+    }
+    std::stringstream ss;
+    boost::property_tree::json_parser::write_json(ss, jsonTree);
+    return ss.str();
+}
+
+bool ResultCodec::fromJson(const std::string& json, ImageRecordVec& out){
+    boost::property_tree::ptree jsonTree;
+    try{
+        std::istringstream ss(json);
+        boost::property_tree::json_parser::read_json(ss, jsonTree);
+
+        for(const auto& frameNode: jsonTree){
+            ImageRecord image;
+            image.imageName = frameNode.first;
+            for(const auto& roiNode: frameNode.second){
+                PersonRecord person;
+                std::memset(&person, 0, sizeof(person));
+                person.x = roiNode.second.get<int32_t>("x", 0);
+                person.y = roiNode.second.get<int32_t>("y", 0);
+                person.width = roiNode.second.get<int32_t>("width", 0);
+                person.height = roiNode.second.get<int32_t>("height", 0);
+                person.attributes = attributeMask(roiNode.second.get<std::string>("attributes", ""));
+                image.persons.push_back(person);
+            }
+            out.push_back(std::move(image));
+        }
+    }
+    catch(const boost::property_tree::ptree_error&){
+        return false;
+    }
+    return true;
+}
+
+}
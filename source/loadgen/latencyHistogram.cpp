@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <limits>
+
+#include <loadgen/latencyHistogram.hpp>
+
+namespace SISD{
+
+namespace{
+
+/// values below this are counted exactly, above it every power of two range has halfSubBuckets buckets
+constexpr uint64_t subBucketCount = 128u;
+constexpr uint64_t halfSubBuckets = subBucketCount / 2;
+constexpr unsigned halfSubBucketBits = 6u;
+
+/// ranges 2^7 .. 2^63, i.e. every value an uint64_t can hold
+constexpr std::size_t totalBuckets = subBucketCount + (64u - halfSubBucketBits - 1u) * halfSubBuckets;
+
+unsigned highestBit(uint64_t value){
+    unsigned ret = 0u;
+    while(value >>= 1u){
+        ++ret;
+    }
+    return ret;
+}
+
+}
+
+LatencyHistogram::LatencyHistogram(): m_buckets(totalBuckets, 0u){
+    reset();
+}
+
+std::size_t LatencyHistogram::bucketIndex(uint64_t us){
+    if(us < subBucketCount){
+        return static_cast<std::size_t>(us);
+    }
+    // shift the value so that it lands in [halfSubBuckets, subBucketCount)
+    const unsigned shift = highestBit(us) - halfSubBucketBits;
+    return static_cast<std::size_t>(subBucketCount + (shift - 1u) * halfSubBuckets + ((us >> shift) - halfSubBuckets));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(std::size_t idx){
+    if(idx < subBucketCount){
+        return idx;
+    }
+    const uint64_t offset = idx - subBucketCount;
+    const unsigned shift = static_cast<unsigned>(offset / halfSubBuckets) + 1u;
+    const uint64_t sub = offset % halfSubBuckets + halfSubBuckets;
+    return ((sub + 1u) << shift) - 1u;
+}
+
+void LatencyHistogram::record(uint64_t us){
+    m_buckets[bucketIndex(us)]++;
+    m_count++;
+    m_min = std::min(m_min, us);
+    m_max = std::max(m_max, us);
+    m_sum += static_cast<double>(us);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other){
+    for(std::size_t i = 0; i < m_buckets.size(); ++i){
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+}
+
+void LatencyHistogram::reset(){
+    std::fill(m_buckets.begin(), m_buckets.end(), 0u);
+    m_count = 0u;
+    m_min = std::numeric_limits<uint64_t>::max();
+    m_max = 0u;
+    m_sum = 0.0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const{
+    if(m_count == 0u){
+        return 0u;
+    }
+    p = std::min(std::max(p, 0.0), 100.0);
+    const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(p / 100.0 * m_count + 0.5), 1u);
+    uint64_t seen = 0u;
+    for(std::size_t i = 0; i < m_buckets.size(); ++i){
+        seen += m_buckets[i];
+        if(seen >= rank){
+            // never report beyond what was actually seen
+            return std::min(bucketUpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+uint64_t LatencyHistogram::count() const{
+    return m_count;
+}
+
+uint64_t LatencyHistogram::min() const{
+    return m_count ? m_min : 0u;
+}
+
+uint64_t LatencyHistogram::max() const{
+    return m_max;
+}
+
+double LatencyHistogram::mean() const{
+    return m_count ? m_sum / m_count : 0.0;
+}
+
+}
@@ -0,0 +1,549 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <client/client.hpp>
+#include <loadgen/latencyHistogram.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+struct loadOption{
+    enum{
+        Closed,     // every connection sends its next request as soon as the previous one is answered
+        Open        // requests are sent at a target rate with Poisson arrivals, regardless of the answers
+    } mode;
+
+    std::string host;
+    std::string port;
+    std::string imageDir;
+    unsigned connections;
+    double rate;
+    double rateStep;
+    double rateMax;
+    double duration;
+    double warmup;
+    std::vector<std::pair<unsigned, double>> imageMix;     // images per request, weight
+    double historyRatio;
+    SISD::Client::ResponseFormat format;
+    double sloMs;
+    unsigned seed;
+    std::string jsonPath;
+    std::string baselinePath;
+    double tolerance;
+};
+
+/// reference numbers of a workload, the last stage of a run is checked against them
+struct baseline{
+    double throughput = 0.0;            // succeeded requests per second
+    double p99Ms = 0.0;                 // p99 latency over all routes
+};
+
+/// what one run at a fixed load measured
+struct stageResult{
+    double targetRate = 0.0;            // 0 for closed loop
+    double elapsedS = 0.0;
+    uint64_t scheduled = 0u;            // requests the open loop schedule placed in the measured window
+    uint64_t sent = 0u;
+    uint64_t succeeded = 0u;
+    std::map<std::string, uint64_t> errors;
+    SISD::LatencyHistogram all;
+    SISD::LatencyHistogram predict;
+    SISD::LatencyHistogram history;
+
+    void merge(const stageResult& other){
+        sent += other.sent;
+        succeeded += other.succeeded;
+        for(const auto& error : other.errors){
+            errors[error.first] += error.second;
+        }
+        all.merge(other.all);
+        predict.merge(other.predict);
+        history.merge(other.history);
+    }
+};
+
+bool parseImageMix(const std::string& mix, std::vector<std::pair<unsigned, double>>& out){
+    std::vector<std::string> entries;
+    boost::algorithm::split(entries, mix, boost::algorithm::is_any_of(","));
+    for(const auto& entry : entries){
+        std::vector<std::string> fields;
+        boost::algorithm::split(fields, entry, boost::algorithm::is_any_of(":"));
+        try{
+            unsigned images = static_cast<unsigned>(std::stoul(fields[0]));
+            double weight = fields.size() > 1 ? std::stod(fields[1]) : 1.0;
+            if(images == 0u || weight <= 0.0 || fields.size() > 2){
+                return false;
+            }
+            out.emplace_back(images, weight);
+        }
+        catch (const std::exception&){
+            return false;
+        }
+    }
+    return !out.empty();
+}
+
+loadOption parseArguments(int argc, char* argv[])
+{
+    using namespace boost::program_options;
+
+    variables_map vm;
+    options_description opt_desc("This is the load generator of the Simple Inference Service Demo (SISD).\n\n"
+            "Example usages:\n"
+            "  SISDLoad -d images -m closed -c 8 -t 30\n"
+            "  SISDLoad -d images -m open -r 5 --rate-step 5 --rate-max 50 --mix 1:70,2:20,4:10 --slo-ms 500\n\nOptions");
+    opt_desc.add_options()
+        ("help,h", "Produce this help message")
+        ("host", value<std::string>()->default_value("localhost"), "Server host")
+        ("port,p", value<std::string>()->default_value("80"), "Server port")
+        ("dir,d", value<std::string>(), "Directory of jpeg images the requests draw from")
+        ("mode,m", value<std::string>()->default_value("closed"), "Load model. Value could be closed or open")
+        ("connections,c", value<unsigned>()->default_value(1), "Concurrent connections. In open mode this caps the requests in flight")
+        ("rate,r", value<double>(), "Target requests per second in open mode")
+        ("rate-step", value<double>(), "Raise the rate by this much after every stage to sweep for the saturation point")
+        ("rate-max", value<double>(), "Last rate of the sweep")
+        ("duration,t", value<double>()->default_value(10.0), "Measured seconds per stage")
+        ("warmup,w", value<double>()->default_value(2.0), "Unmeasured seconds before every stage")
+        ("mix", value<std::string>()->default_value("1"), "Images per predict request as n:weight pairs, e.g. 1:70,2:20,4:10")
+        ("history-ratio", value<double>()->default_value(0.0), "Fraction of requests sent to /history instead of /predict")
+        ("format,f", value<std::string>()->default_value("json"), "Response format. Value could be json or binary")
+        ("slo-ms", value<double>(), "A sweep stage whose p99 exceeds this is considered saturated")
+        ("seed", value<unsigned>()->default_value(1), "Seed of the request and arrival randomness")
+        ("json,j", value<std::string>(), "Write the report as json to this file")
+        ("baseline", value<std::string>(), "Json file with the expected throughput and p99_ms. Exit with 2 if the last stage regressed")
+        ("tolerance", value<double>()->default_value(0.1), "Allowed relative regression against the baseline");
+
+    store(parse_command_line(argc, argv, opt_desc), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << opt_desc << std::endl;
+        exit(0);
+    }
+
+    loadOption ret;
+    ret.host = vm["host"].as<std::string>();
+    ret.port = vm["port"].as<std::string>();
+    ret.connections = std::max(vm["connections"].as<unsigned>(), 1u);
+    ret.duration = vm["duration"].as<double>();
+    ret.warmup = std::max(vm["warmup"].as<double>(), 0.0);
+    ret.historyRatio = vm["history-ratio"].as<double>();
+    ret.seed = vm["seed"].as<unsigned>();
+    ret.sloMs = vm.count("slo-ms") ? vm["slo-ms"].as<double>() : 0.0;
+    if (vm.count("json")) {
+        ret.jsonPath = vm["json"].as<std::string>();
+    }
+    if (vm.count("baseline")) {
+        ret.baselinePath = vm["baseline"].as<std::string>();
+    }
+    ret.tolerance = vm["tolerance"].as<double>();
+    if (ret.tolerance < 0.0) {
+        std::cerr << "Tolerance cannot be negative. Exit" << std::endl;
+        exit(1);
+    }
+    if (vm.count("dir")) {
+        ret.imageDir = vm["dir"].as<std::string>();
+    }
+    if(ret.duration <= 0.0 || ret.historyRatio < 0.0 || ret.historyRatio > 1.0){
+        std::cerr << "Duration must be positive and the history ratio within [0, 1]. Exit" << std::endl;
+        exit(1);
+    }
+    if(ret.imageDir.empty() && ret.historyRatio < 1.0){
+        std::cerr << "Predict requests require an image directory! Exit" << std::endl;
+        exit(1);
+    }
+
+    std::string mode = vm["mode"].as<std::string>();
+    if(mode == "closed"){
+        ret.mode = loadOption::Closed;
+    }
+    else if(mode == "open"){
+        ret.mode = loadOption::Open;
+    }
+    else{
+        std::cerr << "Invalid mode. Value could be closed or open. Exit" << std::endl;
+        exit(1);
+    }
+
+    ret.rate = vm.count("rate") ? vm["rate"].as<double>() : 0.0;
+    ret.rateStep = vm.count("rate-step") ? vm["rate-step"].as<double>() : 0.0;
+    ret.rateMax = vm.count("rate-max") ? vm["rate-max"].as<double>() : ret.rate;
+    if(ret.mode == loadOption::Open && (ret.rate <= 0.0 || (ret.rateMax > ret.rate && ret.rateStep <= 0.0))){
+        std::cerr << "Open mode requires a positive rate, and a positive rate step to sweep! Exit" << std::endl;
+        exit(1);
+    }
+
+    if(!parseImageMix(vm["mix"].as<std::string>(), ret.imageMix)){
+        std::cerr << "Invalid image mix. Expected n:weight pairs, e.g. 1:70,2:20,4:10. Exit" << std::endl;
+        exit(1);
+    }
+
+    std::string format = vm["format"].as<std::string>();
+    if(format == "binary"){
+        ret.format = SISD::Client::Binary;
+    }
+    else if(format == "json"){
+        ret.format = SISD::Client::Json;
+    }
+    else{
+        std::cerr << "Invalid response format. Value could be json or binary. Exit" << std::endl;
+        exit(1);
+    }
+    return ret;
+}
+
+bool listImages(const std::string& dir, std::vector<std::string>& images){
+    try{
+        for(boost::filesystem::directory_iterator it(dir), end; it != end; ++it){
+            std::string extension = boost::algorithm::to_lower_copy(it->path().extension().string());
+            if(boost::filesystem::is_regular_file(it->path()) && (extension == ".jpg" || extension == ".jpeg")){
+                images.push_back(it->path().string());
+            }
+        }
+    }
+    catch (const boost::filesystem::filesystem_error& ex){
+        std::cerr << "Encountered an error of " << ex.what() << " upon reading " << dir << std::endl;
+        return false;
+    }
+    std::sort(images.begin(), images.end());
+    return !images.empty();
+}
+
+/**
+* @brief classify a raw response returned by SISD::Client::sendRequest()
+*
+* @param response the raw response including the status line
+* @return empty string on success, otherwise the error category
+*
+*/
+std::string classifyResponse(const std::string& response){
+    if(response.empty()){
+        return "transport";
+    }
+    // "HTTP/1.0 200 OK"
+    std::string::size_type space = response.find(' ');
+    if(space == std::string::npos || response.length() < space + 4){
+        return "malformed";
+    }
+    std::string status = response.substr(space + 1, 3);
+    if(status[0] == '2'){
+        return "";
+    }
+    return "status " + status;
+}
+
+/**
+* @brief run one stage of load. Closed loop if rate is 0, otherwise open loop at rate requests per second
+*
+* @param opt the load options
+* @param images the image files requests draw from
+* @param rate the target rate, or 0 for closed loop
+* @return the merged result of all connections
+*
+*/
+stageResult runStage(const loadOption& opt, const std::vector<std::string>& images, double rate){
+    // the Poisson arrival schedule is fixed up front so that a slow server cannot delay it
+    std::vector<Clock::duration> arrivals;
+    if(rate > 0.0){
+        std::mt19937_64 rng(opt.seed);
+        std::exponential_distribution<double> gap(rate);
+        double t = 0.0;
+        for(t += gap(rng); t < opt.warmup + opt.duration; t += gap(rng)){
+            arrivals.push_back(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t)));
+        }
+    }
+
+    std::vector<double> mixWeights;
+    for(const auto& entry : opt.imageMix){
+        mixWeights.push_back(entry.second);
+    }
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point measureFrom = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.warmup));
+    const Clock::time_point deadline = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.duration));
+
+    std::atomic<std::size_t> nextArrival(0u);
+    std::vector<stageResult> results(opt.connections);
+    std::vector<std::thread> workers;
+    for(unsigned w = 0; w < opt.connections; ++w){
+        workers.emplace_back([&, w](){
+            SISD::Client client(opt.host, opt.port);
+            stageResult& result = results[w];
+            std::mt19937 rng(opt.seed * 7919u + w);
+            std::uniform_real_distribution<double> routeDist(0.0, 1.0);
+            std::uniform_int_distribution<std::size_t> imageDist(0u, images.empty() ? 0u : images.size() - 1u);
+            std::discrete_distribution<std::size_t> mixDist(mixWeights.begin(), mixWeights.end());
+
+            while(true){
+                Clock::time_point intended;
+                if(rate > 0.0){
+                    std::size_t idx = nextArrival.fetch_add(1u);
+                    if(idx >= arrivals.size()){
+                        break;
+                    }
+                    intended = start + arrivals[idx];
+                    std::this_thread::sleep_until(intended);
+                }
+                else{
+                    intended = Clock::now();
+                    if(intended >= deadline){
+                        break;
+                    }
+                }
+
+                bool history = routeDist(rng) < opt.historyRatio;
+                SISD::Client::FilepathVec files;
+                if(!history){
+                    for(unsigned i = opt.imageMix[mixDist(rng)].first; i > 0u; --i){
+                        files.push_back(images[imageDist(rng)]);
+                    }
+                }
+                SISD::Client::Request req = client.formRequest(files, history ? SISD::Client::History : SISD::Client::Person,
+                        opt.format);
+                std::string response = client.sendRequest(req);
+                const Clock::time_point done = Clock::now();
+
+                if(intended < measureFrom){
+                    continue;
+                }
+                // latency counts from when the request was due, not from when it went out, so a stalled
+                // server is charged for the requests it kept waiting too (coordinated omission)
+                uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(done - intended).count());
+                result.sent++;
+                result.all.record(us);
+                (history ? result.history : result.predict).record(us);
+                std::string error = classifyResponse(response);
+                if(error.empty()){
+                    result.succeeded++;
+                }
+                else{
+                    result.errors[error]++;
+                }
+            }
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    stageResult ret;
+    ret.targetRate = rate;
+    ret.scheduled = static_cast<uint64_t>(std::count_if(arrivals.begin(), arrivals.end(), [&](const Clock::duration& arrival){
+        return start + arrival >= measureFrom;
+    }));
+    for(const auto& result : results){
+        ret.merge(result);
+    }
+    // an open loop stage lasts until its last scheduled request is answered
+    ret.elapsedS = std::chrono::duration<double>(std::max(Clock::now(), deadline) - measureFrom).count();
+    return ret;
+}
+
+std::string latencyJson(const SISD::LatencyHistogram& hist){
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+            "{\"count\": %llu, \"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+            "\"p99.9\": %.3f, \"max\": %.3f}",
+            static_cast<unsigned long long>(hist.count()), hist.mean() / 1000.0, hist.min() / 1000.0,
+            hist.percentile(50.0) / 1000.0, hist.percentile(90.0) / 1000.0, hist.percentile(99.0) / 1000.0,
+            hist.percentile(99.9) / 1000.0, hist.max() / 1000.0);
+    return buffer;
+}
+
+std::string stageJson(const stageResult& stage){
+    std::ostringstream json;
+    char buffer[128];
+    json << "{\"target_rate\": " << stage.targetRate;
+    std::snprintf(buffer, sizeof(buffer), ", \"elapsed_s\": %.3f, \"throughput\": %.3f", stage.elapsedS,
+            stage.elapsedS > 0.0 ? stage.succeeded / stage.elapsedS : 0.0);
+    json << buffer;
+    json << ", \"scheduled\": " << stage.scheduled << ", \"sent\": " << stage.sent << ", \"succeeded\": " << stage.succeeded << ", \"errors\": {";
+    bool first = true;
+    for(const auto& error : stage.errors){
+        json << (first ? "" : ", ") << "\"" << error.first << "\": " << error.second;
+        first = false;
+    }
+    json << "}, \"latency_ms\": {\"all\": " << latencyJson(stage.all) << ", \"predict\": " << latencyJson(stage.predict)
+            << ", \"history\": " << latencyJson(stage.history) << "}}";
+    return json.str();
+}
+
+void printStage(const stageResult& stage){
+    if(stage.targetRate > 0.0){
+        std::printf("target %.1f req/s: ", stage.targetRate);
+    }
+    std::printf("%llu requests in %.2fs, %.2f req/s succeeded\n", static_cast<unsigned long long>(stage.sent),
+            stage.elapsedS, stage.elapsedS > 0.0 ? stage.succeeded / stage.elapsedS : 0.0);
+    const std::pair<const char*, const SISD::LatencyHistogram*> routes[] = {
+        {"all", &stage.all}, {"predict", &stage.predict}, {"history", &stage.history}
+    };
+    for(const auto& route : routes){
+        if(route.second->count() == 0u){
+            continue;
+        }
+        std::printf("  %-8s p50 %9.2fms  p90 %9.2fms  p99 %9.2fms  p99.9 %9.2fms  max %9.2fms\n", route.first,
+                route.second->percentile(50.0) / 1000.0, route.second->percentile(90.0) / 1000.0,
+                route.second->percentile(99.0) / 1000.0, route.second->percentile(99.9) / 1000.0,
+                route.second->max() / 1000.0);
+    }
+    for(const auto& error : stage.errors){
+        std::printf("  error %-12s %llu\n", error.first.c_str(), static_cast<unsigned long long>(error.second));
+    }
+}
+
+/**
+* @brief check if a sweep stage failed to keep up with its target
+*
+* @param opt the load options
+* @param stage the stage to check
+* @return true if the server is saturated at this rate
+*
+*/
+bool saturated(const loadOption& opt, const stageResult& stage){
+    // compare against the rate actually drawn rather than the target, which Poisson arrivals only approximate
+    const double throughput = stage.elapsedS > 0.0 ? stage.succeeded / stage.elapsedS : 0.0;
+    return throughput < 0.95 * stage.scheduled / opt.duration || !stage.errors.empty() ||
+            (opt.sloMs > 0.0 && stage.all.percentile(99.0) > opt.sloMs * 1000.0);
+}
+
+bool loadBaseline(const std::string& path, baseline& out){
+    try{
+        boost::property_tree::ptree root;
+        boost::property_tree::read_json(path, root);
+        out.throughput = root.get<double>("throughput");
+        out.p99Ms = root.get<double>("p99_ms");
+    }
+    catch (const std::exception& ex){
+        std::cerr << "Unable to read baseline " << path << ": " << ex.what() << std::endl;
+        return false;
+    }
+    return out.throughput > 0.0 && out.p99Ms > 0.0;
+}
+
+/**
+* @brief compare a stage against the baseline
+*
+* @param opt the load options
+* @param stage the stage to check
+* @param reference the expected numbers
+* @param failures destination of a description of every regression
+* @return true if the stage is within tolerance and saw no errors
+*
+*/
+bool checkBaseline(const loadOption& opt, const stageResult& stage, const baseline& reference,
+        std::vector<std::string>& failures){
+    char buffer[256];
+    const double throughput = stage.elapsedS > 0.0 ? stage.succeeded / stage.elapsedS : 0.0;
+    const double p99Ms = stage.all.percentile(99.0) / 1000.0;
+    if(throughput < reference.throughput * (1.0 - opt.tolerance)){
+        std::snprintf(buffer, sizeof(buffer), "throughput %.2f req/s is below the baseline %.2f req/s by more than %.0f%%",
+                throughput, reference.throughput, opt.tolerance * 100.0);
+        failures.push_back(buffer);
+    }
+    if(p99Ms > reference.p99Ms * (1.0 + opt.tolerance)){
+        std::snprintf(buffer, sizeof(buffer), "p99 %.2fms is above the baseline %.2fms by more than %.0f%%",
+                p99Ms, reference.p99Ms, opt.tolerance * 100.0);
+        failures.push_back(buffer);
+    }
+    for(const auto& error : stage.errors){
+        failures.push_back(std::to_string(error.second) + " requests failed with " + error.first);
+    }
+    return failures.empty();
+}
+
+int main(int argc, char* argv[]){
+    loadOption opt = parseArguments(argc, argv);
+
+    std::vector<std::string> images;
+    if(!opt.imageDir.empty() && !listImages(opt.imageDir, images)){
+        std::cerr << "No jpeg images found in " << opt.imageDir << "! Exit" << std::endl;
+        return 1;
+    }
+
+    baseline reference;
+    if(!opt.baselinePath.empty() && !loadBaseline(opt.baselinePath, reference)){
+        std::cerr << "The baseline requires a positive throughput and p99_ms! Exit" << std::endl;
+        return 1;
+    }
+
+    std::vector<stageResult> stages;
+    double sustainedRate = 0.0;
+    bool foundSaturation = false;
+    if(opt.mode == loadOption::Closed){
+        stages.push_back(runStage(opt, images, 0.0));
+        printStage(stages.back());
+    }
+    else{
+        for(double rate = opt.rate; rate <= opt.rateMax + 1e-9; rate += opt.rateStep){
+            stages.push_back(runStage(opt, images, rate));
+            printStage(stages.back());
+            if(saturated(opt, stages.back())){
+                foundSaturation = true;
+                break;
+            }
+            sustainedRate = rate;
+            if(opt.rateStep <= 0.0){
+                break;
+            }
+        }
+        if(foundSaturation){
+            std::printf("saturated at %.1f req/s, highest sustained rate %.1f req/s\n", stages.back().targetRate, sustainedRate);
+        }
+    }
+
+    std::vector<std::string> regressions;
+    bool passed = true;
+    if(!opt.baselinePath.empty()){
+        passed = checkBaseline(opt, stages.back(), reference, regressions);
+        for(const auto& regression : regressions){
+            std::printf("regression: %s\n", regression.c_str());
+        }
+        std::printf("baseline check %s\n", passed ? "passed" : "failed");
+    }
+
+    if(!opt.jsonPath.empty()){
+        std::ofstream out(opt.jsonPath, std::ios::trunc);
+        out << "{\n  \"mode\": \"" << (opt.mode == loadOption::Closed ? "closed" : "open") << "\",\n";
+        out << "  \"connections\": " << opt.connections << ",\n";
+        out << "  \"stages\": [\n";
+        for(std::size_t i = 0; i < stages.size(); ++i){
+            out << "    " << stageJson(stages[i]) << (i + 1 < stages.size() ? ",\n" : "\n");
+        }
+        out << "  ]";
+        if(opt.mode == loadOption::Open){
+            out << ",\n  \"saturated\": " << (foundSaturation ? "true" : "false");
+            out << ",\n  \"sustained_rate\": " << sustainedRate;
+        }
+        if(!opt.baselinePath.empty()){
+            out << ",\n  \"baseline\": {\"throughput\": " << reference.throughput << ", \"p99_ms\": " << reference.p99Ms
+                    << ", \"tolerance\": " << opt.tolerance << ", \"passed\": " << (passed ? "true" : "false")
+                    << ", \"regressions\": [";
+            for(std::size_t i = 0; i < regressions.size(); ++i){
+                out << (i ? ", " : "") << "\"" << regressions[i] << "\"";
+            }
+            out << "]}";
+        }
+        out << "\n}\n";
+        if(!out){
+            std::cerr << "Unable to write " << opt.jsonPath << std::endl;
+            return 1;
+        }
+    }
+
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,200 @@
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include <common/resultCodec.hpp>
+#include <common/utility/base64.h>
+#include <microbench/allocationCounter.hpp>
+#include <server/server/reply.hpp>
+#include <server/server/request.hpp>
+#include <server/server/request_handler.hpp>
+#include <server/server/request_parser.hpp>
+
+namespace{
+
+const std::string boundary = "77580b83-390b-4c34-8393-4eac360c7b42";
+
+std::string randomBytes(std::size_t size){
+    std::mt19937 rng(42u);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::string ret(size, '\0');
+    for(auto& c : ret){
+        c = static_cast<char>(dist(rng));
+    }
+    return ret;
+}
+
+/// a multipart body the way SISDClient sends it, with bodySize spread evenly over parts images
+std::string multipartBody(int64_t parts, int64_t bodySize){
+    const std::string image = base64_encode(randomBytes(static_cast<std::size_t>(bodySize / parts * 3 / 4)));
+    std::ostringstream body;
+    for(int64_t i = 0; i < parts; ++i){
+        body << "--" << boundary << "\r\n";
+        body << "Content-Disposition: form-data; name=\"datafile\"; filename=\"" << i << ".jpeg\"\r\n";
+        body << "Content-Type: image/jpeg\r\n\r\n";
+        body << image << "\r\n";
+    }
+    body << "--" << boundary << "--\r\n";
+    return body.str();
+}
+
+std::string predictRequest(int64_t parts, int64_t bodySize){
+    const std::string body = multipartBody(parts, bodySize);
+    std::ostringstream req;
+    req << "POST /predict HTTP/1.0\r\n";
+    req << "Accept: */*\r\n";
+    req << "Content-Length: " << body.length() << "\r\n";
+    req << "Content-Type: multipart/form-data; boundary=" << boundary << "\r\n";
+    req << "Connection: close\r\n\r\n";
+    req << body;
+    return req.str();
+}
+
+/// request bodies from a single thumbnail to a batch of full HD frames
+const std::vector<int64_t> bodySizes = {100 << 10, 1 << 20, 5 << 20, 20 << 20};
+const std::vector<int64_t> partCounts = {1, 8, 64};
+
+}
+
+static void BM_base64_encode(benchmark::State& state){
+    const std::string data = randomBytes(static_cast<std::size_t>(state.range(0)));
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        benchmark::DoNotOptimize(base64_encode(data));
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_base64_encode)->ArgsProduct({bodySizes})->Unit(benchmark::kMicrosecond);
+
+static void BM_base64_decode(benchmark::State& state){
+    const std::string data = base64_encode(randomBytes(static_cast<std::size_t>(state.range(0) * 3 / 4)));
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        benchmark::DoNotOptimize(base64_decode(data));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+}
+BENCHMARK(BM_base64_decode)->ArgsProduct({bodySizes})->Unit(benchmark::kMicrosecond);
+
+static void BM_request_parser_parse(benchmark::State& state){
+    const std::string data = predictRequest(state.range(0), state.range(1));
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        http::server::request_parser parser;
+        http::server::request req;
+        boost::tribool result;
+        boost::tie(result, boost::tuples::ignore) = parser.parse(req, data.begin(), data.end());
+        if(!result){
+            state.SkipWithError("request rejected by the parser");
+            break;
+        }
+        benchmark::DoNotOptimize(req.jsonData.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+}
+BENCHMARK(BM_request_parser_parse)->ArgsProduct({partCounts, bodySizes})->Unit(benchmark::kMicrosecond);
+
+static void BM_request_handler_retrieveImages(benchmark::State& state){
+    const std::string body = multipartBody(state.range(0), state.range(1));
+    std::unordered_map<std::string, std::string> images;
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        if(!http::server::request_handler::retrieveImages(boundary, body, images)){
+            state.SkipWithError("multipart body rejected");
+            break;
+        }
+        benchmark::DoNotOptimize(images.size());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(body.size()));
+}
+BENCHMARK(BM_request_handler_retrieveImages)->ArgsProduct({partCounts, bodySizes})->Unit(benchmark::kMicrosecond);
+
+static void BM_request_handler_url_decode(benchmark::State& state){
+    // a /history query with escaped characters every few bytes
+    std::string uri = "/history?";
+    while(uri.size() < static_cast<std::size_t>(state.range(0))){
+        uri += "name=crossroad%20cam%2F01&from=2020-10-01T00%3A00%3A00&";
+    }
+    uri.resize(static_cast<std::size_t>(state.range(0)));
+    std::string out;
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        http::server::request_handler::url_decode(uri, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_request_handler_url_decode)->Arg(32)->Arg(256)->Arg(2048);
+
+static void BM_reply_to_buffers(benchmark::State& state){
+    http::server::reply rep;
+    rep.status = http::server::reply::ok;
+    rep.content = std::string(static_cast<std::size_t>(state.range(0)), 'x');
+    rep.headers.resize(4);
+    rep.headers[0].name = "Content-Length";
+    rep.headers[0].value = std::to_string(rep.content.size());
+    rep.headers[1].name = "Content-Type";
+    rep.headers[1].value = "application/json";
+    rep.headers[2].name = "Server-Timing";
+    rep.headers[2].value = "receive;dur=1.250, parse;dur=0.310, base64_decode;dur=2.100, image_decode;dur=4.800";
+    rep.headers[3].name = "Connection";
+    rep.headers[3].value = "close";
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        benchmark::DoNotOptimize(rep.to_buffers());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_reply_to_buffers)->Arg(1 << 10)->Arg(64 << 10)->Arg(1 << 20);
+
+namespace{
+
+SISD::ImageRecordVec resultRecords(int64_t images, int64_t persons){
+    SISD::ImageRecordVec ret(static_cast<std::size_t>(images));
+    for(int64_t i = 0; i < images; ++i){
+        ret[i].imageName = std::to_string(i) + ".jpeg";
+        for(int64_t p = 0; p < persons; ++p){
+            SISD::PersonRecord person;
+            person.x = static_cast<int32_t>(p * 37 % 1800);
+            person.y = static_cast<int32_t>(p * 53 % 900);
+            person.width = 64;
+            person.height = 160;
+            person.attributes = static_cast<uint32_t>(p * 0x5bu) & 0xffu;
+            person.topColor[0] = person.bottomColor[2] = static_cast<uint8_t>(p);
+            person.topColor[1] = person.bottomColor[1] = 128u;
+            person.topColor[2] = person.bottomColor[0] = 255u;
+            ret[i].persons.push_back(person);
+        }
+    }
+    return ret;
+}
+
+}
+
+// constructJsonMessage was folded into ResultCodec::toJson
+static void BM_ResultCodec_toJson(benchmark::State& state){
+    const SISD::ImageRecordVec records = resultRecords(state.range(0), state.range(1));
+    std::size_t bytes = 0u;
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        std::string json = SISD::ResultCodec::toJson(records);
+        bytes = json.size();
+        benchmark::DoNotOptimize(json.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(bytes));
+}
+BENCHMARK(BM_ResultCodec_toJson)->ArgsProduct({{1, 16, 64}, {1, 8, 32}})->Unit(benchmark::kMicrosecond);
+
+static void BM_ResultCodec_encodeBinary(benchmark::State& state){
+    const SISD::ImageRecordVec records = resultRecords(state.range(0), state.range(1));
+    std::string out;
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        out.clear();
+        SISD::ResultCodec::encodeBinary(records, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(out.size()));
+}
+BENCHMARK(BM_ResultCodec_encodeBinary)->ArgsProduct({{1, 16, 64}, {1, 8, 32}});
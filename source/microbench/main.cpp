@@ -0,0 +1,43 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <microbench/allocationCounter.hpp>
+
+namespace{
+
+std::atomic<uint64_t> allocations(0u);
+
+}
+
+namespace SISD{
+
+uint64_t allocationCount(){
+    return allocations.load(std::memory_order_relaxed);
+}
+
+}
+
+// every allocation of the process goes through here, so that benchmarks can report how many they make.
+// The array and nothrow forms of the standard library forward to these two
+void* operator new(std::size_t size){
+    allocations.fetch_add(1u, std::memory_order_relaxed);
+    if(void* ptr = std::malloc(size ? size : 1u)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept{
+    std::free(ptr);
+}
+
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept{
+    operator delete(ptr);
+}
+
+BENCHMARK_MAIN();
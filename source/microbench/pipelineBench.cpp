@@ -0,0 +1,67 @@
+#include <iostream>
+
+#ifdef SISD_WITH_OPENVINO
+#include <inference_engine.hpp>
+#include <server/PersonPipeline/ocv_common.hpp>
+#endif
+#include <server/PersonPipeline/colorExtraction.hpp>
+
+#include <microbench/allocationCounter.hpp>
+
+namespace{
+
+cv::Mat randomImage(int width, int height){
+    cv::Mat ret(height, width, CV_8UC3);
+    cv::randu(ret, cv::Scalar::all(0), cv::Scalar::all(255));
+    return ret;
+}
+
+#ifdef SISD_WITH_OPENVINO
+InferenceEngine::Blob::Ptr inputBlob(std::size_t width, std::size_t height){
+    auto ret = InferenceEngine::make_shared_blob<uint8_t>(InferenceEngine::TensorDesc(
+            InferenceEngine::Precision::U8, {1, 3, height, width}, InferenceEngine::Layout::NCHW));
+    ret->allocate();
+    return ret;
+}
+#endif
+
+}
+
+#ifdef SISD_WITH_OPENVINO
+
+/// person crops as the detector cuts them from 1080p crossroad footage, resized to the 80x160 input of
+/// person-attributes-recognition-crossroad-0230
+static void BM_matU8ToBlob_person(benchmark::State& state){
+    const cv::Mat image = randomImage(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    InferenceEngine::Blob::Ptr blob = inputBlob(80, 160);
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        matU8ToBlob<uint8_t>(image, blob);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(image.total() * image.elemSize()));
+}
+BENCHMARK(BM_matU8ToBlob_person)->Args({40, 100})->Args({80, 160})->Args({120, 300})->Args({200, 500});
+
+/// whole frames resized to the 1024x1024 input of person-vehicle-bike-detection-crossroad-0078
+static void BM_matU8ToBlob_frame(benchmark::State& state){
+    const cv::Mat image = randomImage(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    InferenceEngine::Blob::Ptr blob = inputBlob(1024, 1024);
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        matU8ToBlob<uint8_t>(image, blob);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(image.total() * image.elemSize()));
+}
+BENCHMARK(BM_matU8ToBlob_frame)->Args({1024, 1024})->Args({1280, 720})->Args({1920, 1080})->Unit(benchmark::kMicrosecond);
+#endif
+
+/// the top and bottom color regions, a third of the width and a quarter of the height of the same person crops
+static void BM_GetAvgColor(benchmark::State& state){
+    const cv::Mat image = randomImage(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    SISD::AllocationScope allocations(state);
+    for(auto _ : state){
+        benchmark::DoNotOptimize(SISD::GetAvgColor(image));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(image.total() * image.elemSize()));
+}
+BENCHMARK(BM_GetAvgColor)->Args({13, 25})->Args({26, 40})->Args({40, 75})->Args({66, 125})->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <client/client.hpp>
+#include <common/captureFile.hpp>
+#include <loadgen/latencyHistogram.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+struct replayOption{
+    std::string capturePath;
+    std::string host;
+    std::string port;
+    double speedup;
+    unsigned connections;
+    uint64_t limit;
+    std::string jsonPath;
+};
+
+/// a request ready to go out at its scheduled time
+struct pendingRequest{
+    Clock::time_point intended;
+    std::string message;
+};
+
+/// what the replay measured, merged over all connections
+struct replayResult{
+    uint64_t sent = 0u;
+    uint64_t succeeded = 0u;
+    std::map<std::string, uint64_t> errors;
+    SISD::LatencyHistogram latency;
+    SISD::LatencyHistogram lag;         // how late requests went out, which the replay itself is to blame for
+
+    void merge(const replayResult& other){
+        sent += other.sent;
+        succeeded += other.succeeded;
+        for(const auto& error : other.errors){
+            errors[error.first] += error.second;
+        }
+        latency.merge(other.latency);
+        lag.merge(other.lag);
+    }
+};
+
+replayOption parseArguments(int argc, char* argv[])
+{
+    using namespace boost::program_options;
+
+    variables_map vm;
+    options_description opt_desc("This is the traffic replay tool of the Simple Inference Service Demo (SISD). It resends\n"
+            "requests recorded by SISDServer --capture at their original pacing, or scaled by a speedup.\n\n"
+            "Example usages:\n"
+            "  SISDReplay -f traffic.cap -p 8080\n"
+            "  SISDReplay -f traffic.cap -p 8080 -s 2 -c 64 -j replay.json\n\nOptions");
+    opt_desc.add_options()
+        ("help,h", "Produce this help message")
+        ("file,f", value<std::string>(), "Capture file to replay")
+        ("host", value<std::string>()->default_value("localhost"), "Server host")
+        ("port,p", value<std::string>()->default_value("80"), "Server port")
+        ("speedup,s", value<double>()->default_value(1.0), "Replay this many times faster than recorded. 0 sends as fast as possible")
+        ("connections,c", value<unsigned>()->default_value(64), "Maximum requests in flight")
+        ("limit,n", value<uint64_t>()->default_value(0), "Stop after this many requests. 0 replays the whole capture")
+        ("json,j", value<std::string>(), "Write the report as json to this file");
+
+    store(parse_command_line(argc, argv, opt_desc), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << opt_desc << std::endl;
+        exit(0);
+    }
+
+    replayOption ret;
+    if (!vm.count("file")) {
+        std::cerr << "A capture file is required! Exit" << std::endl;
+        exit(1);
+    }
+    ret.capturePath = vm["file"].as<std::string>();
+    ret.host = vm["host"].as<std::string>();
+    ret.port = vm["port"].as<std::string>();
+    ret.speedup = vm["speedup"].as<double>();
+    ret.connections = std::max(vm["connections"].as<unsigned>(), 1u);
+    ret.limit = vm["limit"].as<uint64_t>();
+    if (vm.count("json")) {
+        ret.jsonPath = vm["json"].as<std::string>();
+    }
+    if (ret.speedup < 0.0) {
+        std::cerr << "Speedup cannot be negative. Exit" << std::endl;
+        exit(1);
+    }
+    return ret;
+}
+
+/**
+* @brief render a captured request as an http message which asks the server to close the connection
+*       after responding
+*
+* @param request the captured request
+* @return the http message
+*
+*/
+std::string formatMessage(const SISD::CapturedRequest& request){
+    std::string message;
+    message.reserve(request.body.length() + 512u);
+    message.append(request.method).append(" ").append(request.uri).append(" HTTP/1.0\r\n");
+    for(const auto& header : request.headers){
+        if(header.first == "Connection"){
+            continue;
+        }
+        message.append(header.first).append(": ").append(header.second).append("\r\n");
+    }
+    message.append("Connection: close\r\n\r\n");
+    message.append(request.body);
+    return message;
+}
+
+/**
+* @brief classify a raw response returned by SISD::Client::sendRaw()
+*
+* @param response the raw response including the status line
+* @return empty string on success, otherwise the error category
+*
+*/
+std::string classifyResponse(const std::string& response){
+    if(response.empty()){
+        return "transport";
+    }
+    std::string::size_type space = response.find(' ');
+    if(space == std::string::npos || response.length() < space + 4){
+        return "malformed";
+    }
+    std::string status = response.substr(space + 1, 3);
+    if(status[0] == '2'){
+        return "";
+    }
+    return "status " + status;
+}
+
+std::string latencyJson(const SISD::LatencyHistogram& hist){
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+            "{\"count\": %llu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p99.9\": %.3f, \"max\": %.3f}",
+            static_cast<unsigned long long>(hist.count()), hist.mean() / 1000.0, hist.percentile(50.0) / 1000.0,
+            hist.percentile(90.0) / 1000.0, hist.percentile(99.0) / 1000.0, hist.percentile(99.9) / 1000.0,
+            hist.max() / 1000.0);
+    return buffer;
+}
+
+int main(int argc, char* argv[]){
+    replayOption opt = parseArguments(argc, argv);
+
+    std::ifstream in(opt.capturePath, std::ios::binary);
+    if(!in || !SISD::CaptureFile::readHeader(in)){
+        std::cerr << opt.capturePath << " is not a capture file of a supported version! Exit" << std::endl;
+        return 1;
+    }
+
+    // requests are read and scheduled by the main thread while the connections send them. The queue is
+    //  bounded so that a long capture is not held in memory at once
+    const std::size_t maxQueued = opt.connections * 4u;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<pendingRequest> queue;
+    bool finished = false;
+
+    std::vector<replayResult> results(opt.connections);
+    std::vector<std::thread> workers;
+    for(unsigned w = 0; w < opt.connections; ++w){
+        workers.emplace_back([&, w](){
+            SISD::Client client(opt.host, opt.port);
+            replayResult& result = results[w];
+            while(true){
+                pendingRequest request;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    queueChanged.wait(lock, [&](){
+                        return !queue.empty() || finished;
+                    });
+                    if(queue.empty()){
+                        break;
+                    }
+                    request = std::move(queue.front());
+                    queue.pop_front();
+                }
+                queueChanged.notify_all();
+
+                const Clock::time_point sentAt = Clock::now();
+                std::string response = client.sendRaw(request.message);
+                const Clock::time_point done = Clock::now();
+
+                // latency counts from when the request was due, as in SISDLoad's open loop
+                result.sent++;
+                result.latency.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(done - request.intended).count()));
+                result.lag.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::max(sentAt - request.intended, Clock::duration::zero())).count()));
+                std::string error = classifyResponse(response);
+                if(error.empty()){
+                    result.succeeded++;
+                }
+                else{
+                    result.errors[error]++;
+                }
+            }
+        });
+    }
+
+    SISD::CapturedRequest record;
+    uint64_t scheduled = 0u;
+    uint64_t firstArrivalUs = 0u;
+    uint64_t lastArrivalUs = 0u;
+    const Clock::time_point start = Clock::now();
+    while((opt.limit == 0u || scheduled < opt.limit) && SISD::CaptureFile::readRecord(in, record)){
+        if(scheduled == 0u){
+            firstArrivalUs = record.arrivalUs;
+        }
+        lastArrivalUs = std::max(lastArrivalUs, record.arrivalUs);
+        pendingRequest request;
+        request.intended = start;
+        if(opt.speedup > 0.0 && record.arrivalUs > firstArrivalUs){
+            request.intended += std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double, std::micro>((record.arrivalUs - firstArrivalUs) / opt.speedup));
+        }
+        request.message = formatMessage(record);
+        std::this_thread::sleep_until(request.intended);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueChanged.wait(lock, [&](){
+                return queue.size() < maxQueued;
+            });
+            queue.push_back(std::move(request));
+        }
+        queueChanged.notify_all();
+        scheduled++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    queueChanged.notify_all();
+    for(auto& worker : workers){
+        worker.join();
+    }
+    const double elapsedS = std::chrono::duration<double>(Clock::now() - start).count();
+
+    replayResult total;
+    for(const auto& result : results){
+        total.merge(result);
+    }
+    const double recordedS = (lastArrivalUs - firstArrivalUs) / 1e6;
+    std::printf("replayed %llu requests recorded over %.2fs in %.2fs, %.2f req/s succeeded\n",
+            static_cast<unsigned long long>(total.sent), recordedS, elapsedS, elapsedS > 0.0 ? total.succeeded / elapsedS : 0.0);
+    std::printf("  latency  p50 %9.2fms  p90 %9.2fms  p99 %9.2fms  p99.9 %9.2fms  max %9.2fms\n",
+            total.latency.percentile(50.0) / 1000.0, total.latency.percentile(90.0) / 1000.0,
+            total.latency.percentile(99.0) / 1000.0, total.latency.percentile(99.9) / 1000.0, total.latency.max() / 1000.0);
+    std::printf("  send lag p50 %9.2fms  p99 %9.2fms  max %9.2fms\n", total.lag.percentile(50.0) / 1000.0,
+            total.lag.percentile(99.0) / 1000.0, total.lag.max() / 1000.0);
+    for(const auto& error : total.errors){
+        std::printf("  error %-12s %llu\n", error.first.c_str(), static_cast<unsigned long long>(error.second));
+    }
+    if(total.lag.percentile(99.0) > 10000u){
+        std::printf("requests went out late, raise --connections to keep up with the recorded pacing\n");
+    }
+
+    if(!opt.jsonPath.empty()){
+        std::ofstream out(opt.jsonPath, std::ios::trunc);
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer), "{\n  \"speedup\": %.3f,\n  \"recorded_s\": %.3f,\n  \"elapsed_s\": %.3f,\n"
+                "  \"throughput\": %.3f,\n", opt.speedup, recordedS, elapsedS, elapsedS > 0.0 ? total.succeeded / elapsedS : 0.0);
+        out << buffer;
+        out << "  \"sent\": " << total.sent << ",\n  \"succeeded\": " << total.succeeded << ",\n  \"errors\": {";
+        bool first = true;
+        for(const auto& error : total.errors){
+            out << (first ? "" : ", ") << "\"" << error.first << "\": " << error.second;
+            first = false;
+        }
+        out << "},\n  \"latency_ms\": " << latencyJson(total.latency) << ",\n  \"send_lag_ms\": " << latencyJson(total.lag)
+                << "\n}\n";
+        if(!out){
+            std::cerr << "Unable to write " << opt.jsonPath << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
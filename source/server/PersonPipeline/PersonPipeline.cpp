@@ -13,209 +13,37 @@
 #include <unordered_map>
 
 #include <boost/exception/all.hpp>
-#include <boost/property_tree/json_parser.hpp>
 
-#include <inference_engine.hpp>
+#include <opencv2/opencv.hpp>
 #include <server/PersonPipeline/slog.hpp>
-#include <server/PersonPipeline/ocv_common.hpp>
+#include <server/PersonPipeline/colorExtraction.hpp>
+#include <server/PersonPipeline/inferenceBackend.hpp>
 
 #include <server/PersonPipeline/PersonPipeline.hpp>
-
-using namespace InferenceEngine;
+#include <server/profiling/layerProfile.hpp>
+#include <server/profiling/stageTimings.hpp>
+#include <server/profiling/trace.hpp>
 
 namespace SISD{
-// -------------------------Generic routines for detection networks-------------------------------------------------
-
-struct BaseDetection {
-    ExecutableNetwork net;
-    InferRequest request;
-    std::string commandLineFlag;
-    std::string topoName;
-    Blob::Ptr inputBlob;
-    std::string inputName;
-    std::string outputName;
-
-    BaseDetection(const std::string &commandLineFlag, const std::string &topoName)
-            : commandLineFlag(commandLineFlag), topoName(topoName) {}
-
-    ExecutableNetwork * operator ->() {
-        return &net;
-    }
-    virtual CNNNetwork read(const Core& ie)  = 0;
-
-    virtual void setRoiBlob(const Blob::Ptr &roiBlob) {
-        if (!enabled())
-            return;
-        if (!request)
-            request = net.CreateInferRequest();
-
-        request.SetBlob(inputName, roiBlob);
-    }
 
-    virtual void enqueue(const cv::Mat &person) {
-        if (!enabled())
-            return;
-        if (!request)
-            request = net.CreateInferRequest();
-
-        inputBlob = request.GetBlob(inputName);
-        matU8ToBlob<uint8_t>(person, inputBlob);
-    }
-
-    virtual void submitRequest() {
-        if (!enabled() || !request) return;
-        request.StartAsync();
-    }
+class PersonPipeline::Impl{
+public:
+    explicit Impl(const BackendConfig& config);
 
-    virtual void wait() {
-        if (!enabled()|| !request) return;
-        request.Wait(IInferRequest::WaitMode::RESULT_READY);
-    }
-    mutable bool enablingChecked = false;
-    mutable bool _enabled = false;
-
-    bool enabled() const  {
-        if (!enablingChecked) {
-            _enabled = !commandLineFlag.empty();
-            if (!_enabled) {
-                slog::info << topoName << " detection DISABLED" << slog::endl;
-            }
-            enablingChecked = true;
-        }
-        return _enabled;
-    }
+    ~Impl();
 
-    void printPerformanceCounts(std::string fullDeviceName) const {
-        ::printPerformanceCounts(request, std::cout, fullDeviceName);
-    }
-};
+    bool init();
 
-struct PersonDetection : BaseDetection{
-    int maxProposalCount;
-    int objectSize;
-    float width = 0.0f;
-    float height = 0.0f;
-    bool resultsFetched = false;
+    bool run(const char* input, std::size_t size, const std::string& imageName, ImageRecord& result,
+            StageTimings* timings);
 
-    struct Result {
+private:
+    struct Detection {
         int label;
         float confidence;
         cv::Rect location;
     };
 
-    std::vector<Result> results;
-
-    void submitRequest() override {
-        resultsFetched = false;
-        results.clear();
-        BaseDetection::submitRequest();
-    }
-
-    void setRoiBlob(const Blob::Ptr &frameBlob) override {
-        height = static_cast<float>(frameBlob->getTensorDesc().getDims()[2]);
-        width = static_cast<float>(frameBlob->getTensorDesc().getDims()[3]);
-        BaseDetection::setRoiBlob(frameBlob);
-    }
-
-    void enqueue(const cv::Mat &frame) override {
-        height = static_cast<float>(frame.rows);
-        width = static_cast<float>(frame.cols);
-        BaseDetection::enqueue(frame);
-    }
-
-    PersonDetection() : BaseDetection("person-vehicle-bike-detection-crossroad-0078.xml", "Person Detection"), maxProposalCount(0), objectSize(0) {}
-    CNNNetwork read(const Core& ie) override {
-        slog::info << "Loading network files for PersonDetection" << slog::endl;
-        /** Read network model **/
-        auto network = ie.ReadNetwork("person-vehicle-bike-detection-crossroad-0078.xml");
-        /** Set batch size to 1 **/
-        slog::info << "Batch size is forced to  1" << slog::endl;
-        network.setBatchSize(1);
-        // -----------------------------------------------------------------------------------------------------
-
-        /** SSD-based network should have one input and one output **/
-        // ---------------------------Check inputs ------------------------------------------------------
-        slog::info << "Checking Person Detection inputs" << slog::endl;
-        InputsDataMap inputInfo(network.getInputsInfo());
-        if (inputInfo.size() != 1) {
-            throw std::logic_error("Person Detection network should have only one input");
-        }
-        InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
-        inputInfoFirst->setPrecision(Precision::U8);
-
-
-        inputInfoFirst->getInputData()->setLayout(Layout::NCHW);
-        inputName = inputInfo.begin()->first;
-        // -----------------------------------------------------------------------------------------------------
-
-        // ---------------------------Check outputs ------------------------------------------------------
-        slog::info << "Checking Person Detection outputs" << slog::endl;
-        OutputsDataMap outputInfo(network.getOutputsInfo());
-        if (outputInfo.size() != 1) {
-            throw std::logic_error("Person Detection network should have only one output");
-        }
-        DataPtr& _output = outputInfo.begin()->second;
-        const SizeVector outputDims = _output->getTensorDesc().getDims();
-        outputName = outputInfo.begin()->first;
-        maxProposalCount = outputDims[2];
-        objectSize = outputDims[3];
-        if (objectSize != 7) {
-            throw std::logic_error("Output should have 7 as a last dimension");
-        }
-        if (outputDims.size() != 4) {
-            throw std::logic_error("Incorrect output dimensions for SSD");
-        }
-        _output->setPrecision(Precision::FP32);
-        _output->setLayout(Layout::NCHW);
-
-        slog::info << "Loading Person Detection model to CPU" << slog::endl;
-        return network;
-    }
-
-    void fetchResults() {
-        if (!enabled()) return;
-        results.clear();
-        if (resultsFetched) return;
-        resultsFetched = true;
-        LockedMemory<const void> outputMapped = as<MemoryBlob>(request.GetBlob(outputName))->rmap();
-        const float *detections = outputMapped.as<float *>();
-        // pretty much regular SSD post-processing
-        for (int i = 0; i < maxProposalCount; i++) {
-            float image_id = detections[i * objectSize + 0];  // in case of batch
-            if (image_id < 0) {  // indicates end of detections
-                break;
-            }
-
-            Result r;
-            r.label = static_cast<int>(detections[i * objectSize + 1]);
-            r.confidence = detections[i * objectSize + 2];
-
-            r.location.x = static_cast<int>(detections[i * objectSize + 3] * width);
-            r.location.y = static_cast<int>(detections[i * objectSize + 4] * height);
-            r.location.width = static_cast<int>(detections[i * objectSize + 5] * width - r.location.x);
-            r.location.height = static_cast<int>(detections[i * objectSize + 6] * height - r.location.y);
-
-            std::cout << "[" << i << "," << r.label << "] element, prob = " << r.confidence <<
-                        "    (" << r.location.x << "," << r.location.y << ")-(" << r.location.width << ","
-                        << r.location.height << ")"
-                        << ((r.confidence > 0.72) ? " WILL BE RENDERED!" : "") << std::endl;
-
-            if (r.confidence <= 0.72) {
-                continue;
-            }
-            results.push_back(r);
-        }
-    }
-};
-
-struct PersonAttribsDetection : BaseDetection {
-    std::string outputNameForAttributes;
-    std::string outputNameForTopColorPoint;
-    std::string outputNameForBottomColorPoint;
-
-
-    PersonAttribsDetection() : BaseDetection("person-attributes-recognition-crossroad-0230.xml", "Person Attributes Recognition") {}
-
     struct AttributesAndColorPoints{
         std::vector<std::string> attributes_strings;
         std::vector<bool> attributes_indicators;
@@ -225,230 +53,148 @@ struct PersonAttribsDetection : BaseDetection {
         cv::Vec3b bottom_color;
     };
 
-    static cv::Vec3b GetAvgColor(const cv::Mat& image) {
-        int clusterCount = 5;
-        cv::Mat labels;
-        cv::Mat centers;
-        cv::Mat image32f;
-        image.convertTo(image32f, CV_32F);
-        image32f = image32f.reshape(1, image32f.rows*image32f.cols);
-        clusterCount = std::min(clusterCount, image32f.rows);
-        cv::kmeans(image32f, clusterCount, labels, cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::MAX_ITER, 10, 1.0),
-                    10, cv::KMEANS_RANDOM_CENTERS, centers);
-        centers.convertTo(centers, CV_8U);
-        centers = centers.reshape(0, clusterCount);
-        std::vector<int> freq(clusterCount);
-
-        for (int i = 0; i < labels.rows * labels.cols; ++i) {
-            freq[labels.at<int>(i)]++;
-        }
+    /// regular SSD post-processing of the detection output
+    void fetchDetections(float width, float height);
 
-        auto freqArgmax = std::max_element(freq.begin(), freq.end()) - freq.begin();
+    AttributesAndColorPoints GetPersonAttributes();
 
-        return centers.at<cv::Vec3b>(freqArgmax);
-    }
-
-    AttributesAndColorPoints GetPersonAttributes() {
-        static const char *const attributeStrings[] = {
-                "is male", "has_bag", "has_backpack" , "has hat", "has longsleeves", "has longpants", "has longhair", "has coat_jacket"
-        };
-
-        Blob::Ptr attribsBlob = request.GetBlob(outputNameForAttributes);
-        Blob::Ptr topColorPointBlob = request.GetBlob(outputNameForTopColorPoint);
-        Blob::Ptr bottomColorPointBlob = request.GetBlob(outputNameForBottomColorPoint);
-        size_t numOfAttrChannels = attribsBlob->getTensorDesc().getDims().at(1);
-        size_t numOfTCPointChannels = topColorPointBlob->getTensorDesc().getDims().at(1);
-        size_t numOfBCPointChannels = bottomColorPointBlob->getTensorDesc().getDims().at(1);
-
-        if (numOfAttrChannels != arraySize(attributeStrings)) {
-            throw std::logic_error("Output size (" + std::to_string(numOfAttrChannels) + ") of the "
-                                   "Person Attributes Recognition network is not equal to expected "
-                                   "number of attributes (" + std::to_string(arraySize(attributeStrings)) + ")");
-        }
-        if (numOfTCPointChannels != 2) {
-            throw std::logic_error("Output size (" + std::to_string(numOfTCPointChannels) + ") of the "
-                                   "Person Attributes Recognition network is not equal to point coordinates(2)");
-        }
-        if (numOfBCPointChannels != 2) {
-            throw std::logic_error("Output size (" + std::to_string(numOfBCPointChannels) + ") of the "
-                                   "Person Attributes Recognition network is not equal to point coordinates (2)");
-        }
+    BackendConfig m_config;
+    std::unique_ptr<InferenceBackend> m_backend;
+    bool m_perfCounting;
 
-        LockedMemory<const void> attribsBlobMapped = as<MemoryBlob>(attribsBlob)->rmap();
-        auto outputAttrValues = attribsBlobMapped.as<float*>();
-        LockedMemory<const void> topColorPointBlobMapped = as<MemoryBlob>(topColorPointBlob)->rmap();
-        auto outputTCPointValues = topColorPointBlobMapped.as<float*>();
-        LockedMemory<const void> bottomColorPointBlobMapped = as<MemoryBlob>(bottomColorPointBlob)->rmap();
-        auto outputBCPointValues = bottomColorPointBlobMapped.as<float*>();
+    // output buffers, kept to reuse their storage between runs
+    std::vector<Detection> m_detections;
+    InferenceBackend::Tensor m_detectionOutput;
+    InferenceBackend::Tensor m_attribsOutput;
+    InferenceBackend::Tensor m_topColorPointOutput;
+    InferenceBackend::Tensor m_bottomColorPointOutput;
+};
 
-        AttributesAndColorPoints returnValue;
+PersonPipeline::Impl::Impl(const BackendConfig& config): m_config(config), m_perfCounting(false){
 
-        returnValue.top_color_point.x = outputTCPointValues[0];
-        returnValue.top_color_point.y = outputTCPointValues[1];
+}
 
-        returnValue.bottom_color_point.x = outputBCPointValues[0];
-        returnValue.bottom_color_point.y = outputBCPointValues[1];
+PersonPipeline::Impl::~Impl(){
 
-        for (size_t i = 0; i < arraySize(attributeStrings); i++) {
-            returnValue.attributes_strings.push_back(attributeStrings[i]);
-            returnValue.attributes_indicators.push_back(outputAttrValues[i] > 0.5);
-        }
+}
 
-        return returnValue;
+bool PersonPipeline::Impl::init(){
+    if (!m_backend) {
+        m_backend = InferenceBackend::create(m_config);
+        if (!m_backend)
+            return false;
+        slog::info << "Using the " << m_backend->name() << " inference backend" << slog::endl;
     }
+    // performance counting has to be chosen when the networks are loaded
+    m_perfCounting = LayerProfile::getInstance().enabled();
+    return m_backend->load(m_perfCounting);
+}
 
-    CNNNetwork read(const Core& ie) override {
-        slog::info << "Loading network files for PersonAttribs" << slog::endl;
-        /** Read network model **/
-        auto network = ie.ReadNetwork("person-attributes-recognition-crossroad-0230.xml");
-        /** Extract model name and load it's weights **/
-        network.setBatchSize(1);
-        slog::info << "Batch size is forced to 1 for Person Attribs" << slog::endl;
-        // -----------------------------------------------------------------------------------------------------
-
-        /** Person Attribs network should have one input two outputs **/
-        // ---------------------------Check inputs ------------------------------------------------------
-        slog::info << "Checking PersonAttribs inputs" << slog::endl;
-        InputsDataMap inputInfo(network.getInputsInfo());
-        if (inputInfo.size() != 1) {
-            throw std::logic_error("Person Attribs topology should have only one input");
-        }
-        InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
-        inputInfoFirst->setPrecision(Precision::U8);
-
-        inputInfoFirst->getInputData()->setLayout(Layout::NCHW);
-        inputName = inputInfo.begin()->first;
-        // -----------------------------------------------------------------------------------------------------
-
-        // ---------------------------Check outputs ------------------------------------------------------
-        slog::info << "Checking Person Attribs outputs" << slog::endl;
-        OutputsDataMap outputInfo(network.getOutputsInfo());
-        if (outputInfo.size() != 3) {
-             throw std::logic_error("Person Attribs Network expects networks having one output");
-        }
-        auto it = outputInfo.begin();
-        outputNameForAttributes = (it++)->second->getName();  // attribute probabilities
-        outputNameForTopColorPoint = (it++)->second->getName();  // top color location
-        outputNameForBottomColorPoint = (it++)->second->getName();  // bottom color location
-        slog::info << "Loading Person Attributes Recognition model to CPU" << slog::endl;
-        _enabled = true;
-        return network;
+void PersonPipeline::Impl::fetchDetections(float width, float height){
+    m_detections.clear();
+    m_backend->output(InferenceBackend::PersonDetection, 0, m_detectionOutput);
+    const std::vector<std::size_t>& outputDims = m_detectionOutput.dims;
+    if (outputDims.size() != 4 || outputDims[3] != 7) {
+        throw std::logic_error("Incorrect output dimensions for SSD");
     }
-};
-
-struct Load {
-    BaseDetection& detector;
-    explicit Load(BaseDetection& detector) : detector(detector) { }
-
-    void into(Core & ie, const std::string & deviceName) const {
-        if (detector.enabled()) {
-            detector.net = ie.LoadNetwork(detector.read(ie), deviceName);
+    const int maxProposalCount = static_cast<int>(outputDims[2]);
+    const int objectSize = static_cast<int>(outputDims[3]);
+    const float *detections = m_detectionOutput.data.data();
+    // pretty much regular SSD post-processing
+    for (int i = 0; i < maxProposalCount; i++) {
+        float image_id = detections[i * objectSize + 0];  // in case of batch
+        if (image_id < 0) {  // indicates end of detections
+            break;
         }
-    }
-};
-
-
-class PersonPipeline::Impl{
-public:
-    struct ROI{
-        unsigned x;
-        unsigned y;
-        unsigned w;
-        unsigned h;
-        std::string attrib;
-    };
-
-    struct Result{
-        using ROIVec = std::vector<ROI>;
-        ROIVec rois;
-        std::string imageName;
-    };
-
-    using ResultVec = std::vector<Result>;
-
-    Impl();
-
-    ~Impl();
-
-    bool init();
-
-    std::string run(const char* input, std::size_t size, const std::string& imageName);
 
-private:
-    std::string constructJsonMessage(const ResultVec& results) const;
+        Detection r;
+        r.label = static_cast<int>(detections[i * objectSize + 1]);
+        r.confidence = detections[i * objectSize + 2];
 
-    PersonDetection m_personDetection;
-    PersonAttribsDetection m_personAttribs;
-};
+        r.location.x = static_cast<int>(detections[i * objectSize + 3] * width);
+        r.location.y = static_cast<int>(detections[i * objectSize + 4] * height);
+        r.location.width = static_cast<int>(detections[i * objectSize + 5] * width - r.location.x);
+        r.location.height = static_cast<int>(detections[i * objectSize + 6] * height - r.location.y);
 
-PersonPipeline::Impl::Impl(){
+        std::cout << "[" << i << "," << r.label << "] element, prob = " << r.confidence <<
+                    "    (" << r.location.x << "," << r.location.y << ")-(" << r.location.width << ","
+                    << r.location.height << ")"
+                    << ((r.confidence > 0.72) ? " WILL BE RENDERED!" : "") << std::endl;
 
+        if (r.confidence <= 0.72) {
+            continue;
+        }
+        m_detections.push_back(r);
+    }
 }
 
-PersonPipeline::Impl::~Impl(){
+PersonPipeline::Impl::AttributesAndColorPoints PersonPipeline::Impl::GetPersonAttributes() {
+    static const auto& attributeStrings = ResultCodec::attributeNames;
 
-}
+    m_backend->output(InferenceBackend::PersonAttributes, 0, m_attribsOutput);
+    m_backend->output(InferenceBackend::PersonAttributes, 1, m_topColorPointOutput);
+    m_backend->output(InferenceBackend::PersonAttributes, 2, m_bottomColorPointOutput);
+    size_t numOfAttrChannels = m_attribsOutput.dims.at(1);
+    size_t numOfTCPointChannels = m_topColorPointOutput.dims.at(1);
+    size_t numOfBCPointChannels = m_bottomColorPointOutput.dims.at(1);
 
-bool PersonPipeline::Impl::init(){
-    try {
-        std::cout << "InferenceEngine: " << GetInferenceEngineVersion() << std::endl;
+    if (numOfAttrChannels != ResultCodec::attributeCount) {
+        throw std::logic_error("Output size (" + std::to_string(numOfAttrChannels) + ") of the "
+                               "Person Attributes Recognition network is not equal to expected "
+                               "number of attributes (" + std::to_string(ResultCodec::attributeCount) + ")");
+    }
+    if (numOfTCPointChannels != 2) {
+        throw std::logic_error("Output size (" + std::to_string(numOfTCPointChannels) + ") of the "
+                               "Person Attributes Recognition network is not equal to point coordinates(2)");
+    }
+    if (numOfBCPointChannels != 2) {
+        throw std::logic_error("Output size (" + std::to_string(numOfBCPointChannels) + ") of the "
+                               "Person Attributes Recognition network is not equal to point coordinates (2)");
+    }
 
-        // --------------------------- 1. Load inference engine -------------------------------------
-        Core ie;
+    const float* outputAttrValues = m_attribsOutput.data.data();
+    const float* outputTCPointValues = m_topColorPointOutput.data.data();
+    const float* outputBCPointValues = m_bottomColorPointOutput.data.data();
 
-        std::set<std::string> loadedDevices;
+    AttributesAndColorPoints returnValue;
 
-        std::vector<std::string> deviceNames = {
-                "CPU",
-                "CPU",
-                "CPU"
-        };
+    returnValue.top_color_point.x = outputTCPointValues[0];
+    returnValue.top_color_point.y = outputTCPointValues[1];
 
-        for (auto && flag : deviceNames) {
-            if (flag.empty())
-                continue;
+    returnValue.bottom_color_point.x = outputBCPointValues[0];
+    returnValue.bottom_color_point.y = outputBCPointValues[1];
 
-            auto i = loadedDevices.find(flag);
-            if (i != loadedDevices.end()) {
-                continue;
-            }
-            slog::info << "Loading device " << flag << slog::endl;
+    for (size_t i = 0; i < ResultCodec::attributeCount; i++) {
+        returnValue.attributes_strings.push_back(attributeStrings[i]);
+        returnValue.attributes_indicators.push_back(outputAttrValues[i] > 0.5);
+    }
 
-            /** Printing device version **/
-            std::cout << ie.GetVersions(flag) << std::endl;
+    return returnValue;
+}
 
-            loadedDevices.insert(flag);
-        }
+bool PersonPipeline::Impl::run(const char* input, std::size_t size, const std::string& imageName, ImageRecord& result,
+        StageTimings* timings){
+    result.imageName = imageName;
+    result.persons.clear();
 
-        // --------------------------- 2. Read IR models and load them to devices ------------------------------
-        Load(m_personDetection).into(ie, "CPU");
-        Load(m_personAttribs).into(ie, "CPU");
-    }
-    catch (const std::exception& error) {
-        std::cerr << "[ ERROR ] " << error.what() << std::endl;
+    // load the networks if init() was skipped, and reload them if performance counting was toggled since
+    if((!m_backend || LayerProfile::getInstance().enabled() != m_perfCounting) && !init()){
         return false;
     }
-    catch (...) {
-        std::cerr << "[ ERROR ] Unknown/internal exception happened." << std::endl;
-        return false;
-    }
-    return true;
-}
-
-std::string PersonPipeline::Impl::run(const char* input, std::size_t size, const std::string& imageName){
-    std::string jsonOut = "";
     try{
         ::cv::Mat rawData( 1, size, CV_8UC1, (void*)input );
 
-        ::cv::Mat frame = cv::imdecode(rawData, ::cv::IMREAD_COLOR);
+        ::cv::Mat frame;
+        {
+            StageTimings::Scope scope(timings, StageTimings::ImageDecode);
+            SISD_TRACE_SCOPE("imdecode");
+            frame = cv::imdecode(rawData, ::cv::IMREAD_COLOR);
+        }
 
         const size_t width  = frame.size().width;
         const size_t height = frame.size().height;
 
         // --------------------------- 3. Do inference ---------------------------------------------------------
-        Blob::Ptr frameBlob;  // Blob to be used to keep processed frame data
-        ROI cropRoi;  // cropped image coordinates
-        Blob::Ptr roiBlob;  // This blob contains data from cropped image (vehicle or license plate)
         cv::Mat person;  // Mat object containing person data cropped by openCV
 
         /** Start inference & calc performance **/
@@ -457,44 +203,57 @@ std::string PersonPipeline::Impl::run(const char* input, std::size_t size, const
         slog::info << "Start inference " << slog::endl;
 
         do {
-            m_personDetection.enqueue(frame);
+            {
+                StageTimings::Scope scope(timings, StageTimings::Preprocess);
+                m_backend->enqueue(InferenceBackend::PersonDetection, frame);
+            }
             // --------------------------- Run Person detection inference --------------------------------------
             auto t0 = std::chrono::high_resolution_clock::now();
-            m_personDetection.submitRequest();
-            m_personDetection.wait();
+            m_backend->submitRequest(InferenceBackend::PersonDetection);
+            m_backend->wait(InferenceBackend::PersonDetection);
+            // parse inference results internally (e.g. apply a threshold, etc)
+            fetchDetections(static_cast<float>(width), static_cast<float>(height));
             auto t1 = std::chrono::high_resolution_clock::now();
+            if (m_perfCounting)
+                m_backend->accumulatePerformanceCounts(InferenceBackend::PersonDetection);
             ms detection = std::chrono::duration_cast<ms>(t1 - t0);
-            // parse inference results internally (e.g. apply a threshold, etc)
-            m_personDetection.fetchResults();
+            if (timings)
+                timings->add(StageTimings::Detection, t1 - t0);
             // -------------------------------------------------------------------------------------------------
 
             // --------------------------- Process the results down to the pipeline ----------------------------
             ms personAttribsNetworkTime(0), personReIdNetworktime(0);
             int personAttribsInferred = 0,  personReIdInferred = 0;
-            Result res;
-            for (auto && result : m_personDetection.results) {
-                if (result.label == 1) {  // person
-                    auto clippedRect = result.location & cv::Rect(0, 0, width, height);
+            for (auto && candidate : m_detections) {
+                if (candidate.label == 1) {  // person
+                    auto clippedRect = candidate.location & cv::Rect(0, 0, width, height);
                     person = frame(clippedRect);
 
-                    PersonAttribsDetection::AttributesAndColorPoints resPersAttrAndColor;
+                    AttributesAndColorPoints resPersAttrAndColor;
                     std::string resPersReid = "";
                     cv::Point top_color_p;
                     cv::Point bottom_color_p;
 
 
                     // --------------------------- Run Person Attributes Recognition -----------------------
-                    m_personAttribs.enqueue(person);
+                    {
+                        StageTimings::Scope scope(timings, StageTimings::Preprocess);
+                        m_backend->enqueue(InferenceBackend::PersonAttributes, person);
+                    }
 
                     t0 = std::chrono::high_resolution_clock::now();
-                    m_personAttribs.submitRequest();
-                    m_personAttribs.wait();
+                    m_backend->submitRequest(InferenceBackend::PersonAttributes);
+                    m_backend->wait(InferenceBackend::PersonAttributes);
                     t1 = std::chrono::high_resolution_clock::now();
                     personAttribsNetworkTime += std::chrono::duration_cast<ms>(t1 - t0);
                     personAttribsInferred++;
+                    if (m_perfCounting)
+                        m_backend->accumulatePerformanceCounts(InferenceBackend::PersonAttributes);
                     // --------------------------- Process outputs -----------------------------------------
 
-                    resPersAttrAndColor = m_personAttribs.GetPersonAttributes();
+                    resPersAttrAndColor = GetPersonAttributes();
+                    if (timings)
+                        timings->add(StageTimings::Attributes, std::chrono::high_resolution_clock::now() - t0);
 
                     top_color_p.x = static_cast<int>(resPersAttrAndColor.top_color_point.x) * person.cols;
                     top_color_p.y = static_cast<int>(resPersAttrAndColor.top_color_point.y) * person.rows;
@@ -523,8 +282,11 @@ std::string PersonPipeline::Impl::run(const char* input, std::size_t size, const
 
                     bc_rect = bc_rect & person_rect;
 
-                    resPersAttrAndColor.top_color = PersonAttribsDetection::GetAvgColor(person(tc_rect));
-                    resPersAttrAndColor.bottom_color = PersonAttribsDetection::GetAvgColor(person(bc_rect));
+                    {
+                        StageTimings::Scope scope(timings, StageTimings::ColorExtraction);
+                        resPersAttrAndColor.top_color = GetAvgColor(person(tc_rect));
+                        resPersAttrAndColor.bottom_color = GetAvgColor(person(bc_rect));
+                    }
 
                     // --------------------------- Process outputs -----------------------------------------
                     if (!resPersAttrAndColor.attributes_strings.empty()) {
@@ -532,24 +294,28 @@ std::string PersonPipeline::Impl::run(const char* input, std::size_t size, const
                         for (size_t i = 0; i < resPersAttrAndColor.attributes_strings.size(); ++i)
                             if (resPersAttrAndColor.attributes_indicators[i])
                                 output_attribute_string += resPersAttrAndColor.attributes_strings[i] + ",";
-                        std::cout << "Person ROI: " << result.location.x << ", " << result.location.y << ". "
-                            << result.location.width << ", " << result.location.height << std::endl;
+                        std::cout << "Person ROI: " << candidate.location.x << ", " << candidate.location.y << ". "
+                            << candidate.location.width << ", " << candidate.location.height << std::endl;
                         std::cout << "Person Attributes results: " << output_attribute_string << std::endl;
                         std::cout << "Person top color: " << resPersAttrAndColor.top_color << std::endl;
                         std::cout << "Person bottom color: " << resPersAttrAndColor.bottom_color << std::endl;
-                        ROI roi;
-                        roi.x = result.location.x;
-                        roi.y = result.location.y;
-                        roi.w = result.location.width;
-                        roi.h = result.location.height;
-                        roi.attrib = output_attribute_string;
-                        res.rois.push_back(roi);
+                        PersonRecord record;
+                        record.x = candidate.location.x;
+                        record.y = candidate.location.y;
+                        record.width = candidate.location.width;
+                        record.height = candidate.location.height;
+                        record.attributes = 0u;
+                        for (size_t i = 0; i < resPersAttrAndColor.attributes_indicators.size(); ++i)
+                            if (resPersAttrAndColor.attributes_indicators[i])
+                                record.attributes |= (1u << i);
+                        for (int c = 0; c < 3; ++c) {
+                            record.topColor[c] = resPersAttrAndColor.top_color[c];
+                            record.bottomColor[c] = resPersAttrAndColor.bottom_color[c];
+                        }
+                        result.persons.push_back(record);
                     }
                 }
             }
-            res.imageName = imageName;
-            jsonOut = constructJsonMessage(ResultVec{res});
-            std::cout << jsonOut << std::endl;
 
         } while(false);
 
@@ -560,47 +326,21 @@ std::string PersonPipeline::Impl::run(const char* input, std::size_t size, const
     }
     catch (const std::exception& error) {
         std::cerr << "[ ERROR ] " << error.what() << std::endl;
+        return false;
     }
     catch (...) {
         std::cerr << "[ ERROR ] Unknown/internal exception happened." << std::endl;
+        return false;
     }
-    return jsonOut;
+    return true;
 }
 
-std::string PersonPipeline::Impl::constructJsonMessage(const ResultVec& results) const{
-    boost::property_tree::ptree jsonTree;
-
-    for(const auto& frame: results){
-        boost::property_tree::ptree frameNode;
-
-        for(const auto& roi: frame.rois){
-            boost::property_tree::ptree roiNode;
-            roiNode.put("x", roi.x);
-            roiNode.put("y", roi.y);
-            roiNode.put("width", roi.w);
-            roiNode.put("height", roi.h);
-            roiNode.put("attributes", roi.attrib);
-
-            frameNode.push_back(std::make_pair("", roiNode));
-        }
-        if(!frameNode.empty()){
-            // jsonTree.add_child(frame.imageName, frameNode);
-            jsonTree.push_back(std::make_pair(frame.imageName, frameNode));
-        }
-    }
-
-    if(jsonTree.empty()){
-        return "";
-    }
-    else{
-        std::stringstream ss;
-        boost::property_tree::json_parser::write_json(ss, jsonTree);
-        return ss.str();
-    }
+PersonPipeline::PersonPipeline(){
+    m_impl = std::unique_ptr<Impl>(new Impl(BackendConfig()));
 }
 
-PersonPipeline::PersonPipeline(){
-    m_impl = std::unique_ptr<Impl>(new Impl);
+PersonPipeline::PersonPipeline(const BackendConfig& config){
+    m_impl = std::unique_ptr<Impl>(new Impl(config));
 }
 
 PersonPipeline::~PersonPipeline(){
@@ -612,6 +352,15 @@ bool PersonPipeline::init(){
 }
 
 std::string PersonPipeline::run(const char* input, std::size_t size, const std::string& imageName){
-    return m_impl->run(input, size, imageName);
+    ImageRecord result;
+    if(!m_impl->run(input, size, imageName, result, nullptr) || result.persons.empty()){
+        return "";
+    }
+    return ResultCodec::toJson(ImageRecordVec{result});
+}
+
+bool PersonPipeline::run(const char* input, std::size_t size, const std::string& imageName, ImageRecord& result,
+        StageTimings* timings){
+    return m_impl->run(input, size, imageName, result, timings);
 }
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <vector>
+
+#include <server/PersonPipeline/colorExtraction.hpp>
+#include <server/profiling/trace.hpp>
+
+namespace SISD{
+
+cv::Vec3b GetAvgColor(const cv::Mat& image) {
+    SISD_TRACE_SCOPE("GetAvgColor");
+    int clusterCount = 5;
+    cv::Mat labels;
+    cv::Mat centers;
+    cv::Mat image32f;
+    image.convertTo(image32f, CV_32F);
+    image32f = image32f.reshape(1, image32f.rows*image32f.cols);
+    clusterCount = std::min(clusterCount, image32f.rows);
+    cv::kmeans(image32f, clusterCount, labels, cv::TermCriteria(cv::TermCriteria::EPS+cv::TermCriteria::MAX_ITER, 10, 1.0),
+                10, cv::KMEANS_RANDOM_CENTERS, centers);
+    centers.convertTo(centers, CV_8U);
+    centers = centers.reshape(0, clusterCount);
+    std::vector<int> freq(clusterCount);
+
+    for (int i = 0; i < labels.rows * labels.cols; ++i) {
+        freq[labels.at<int>(i)]++;
+    }
+
+    auto freqArgmax = std::max_element(freq.begin(), freq.end()) - freq.begin();
+
+    return centers.at<cv::Vec3b>(freqArgmax);
+}
+
+}
@@ -0,0 +1,57 @@
+#include <iostream>
+
+#include <server/PersonPipeline/inferenceBackend.hpp>
+#include <server/PersonPipeline/mockBackend.hpp>
+#ifdef SISD_WITH_OPENVINO
+#include <server/PersonPipeline/openvinoBackend.hpp>
+#endif
+
+namespace SISD{
+
+BackendConfig::BackendConfig():
+#ifdef SISD_WITH_OPENVINO
+        type(OpenVino),
+#else
+        type(Mock),
+#endif
+        device("CPU"), mockDetectionDelay(std::chrono::milliseconds(20)), mockAttributesDelay(std::chrono::milliseconds(2)),
+        mockLoadDelay(std::chrono::milliseconds(200)), mockPersons(3u){
+
+}
+
+bool BackendConfig::parseType(const std::string& name, Type& out){
+    if(name == "openvino"){
+        out = OpenVino;
+        return true;
+    }
+    if(name == "mock"){
+        out = Mock;
+        return true;
+    }
+    return false;
+}
+
+std::unique_ptr<InferenceBackend> InferenceBackend::create(const BackendConfig& config){
+    switch(config.type){
+    case BackendConfig::OpenVino:
+#ifdef SISD_WITH_OPENVINO
+        return std::unique_ptr<InferenceBackend>(new OpenVinoBackend(config));
+#else
+        std::cerr << "[ ERROR ] This build has no OpenVINO support, only the mock backend is available" << std::endl;
+        return nullptr;
+#endif
+    case BackendConfig::Mock:
+        return std::unique_ptr<InferenceBackend>(new MockBackend(config));
+    }
+    return nullptr;
+}
+
+InferenceBackend::~InferenceBackend(){
+
+}
+
+void InferenceBackend::accumulatePerformanceCounts(Network){
+
+}
+
+}
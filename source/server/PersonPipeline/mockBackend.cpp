@@ -0,0 +1,114 @@
+#include <thread>
+
+#include <server/PersonPipeline/mockBackend.hpp>
+#include <common/resultCodec.hpp>
+#include <server/profiling/trace.hpp>
+
+namespace SISD{
+
+namespace{
+
+/// values per SSD detection
+constexpr std::size_t ssdObjectSize = 7u;
+
+/// FNV-1a over the image size and a sparse sample of its pixels
+uint32_t imageDigest(const cv::Mat& image){
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](uint32_t value){
+        hash = (hash ^ value) * 16777619u;
+    };
+    mix(static_cast<uint32_t>(image.rows));
+    mix(static_cast<uint32_t>(image.cols));
+    if(!image.empty() && image.type() == CV_8UC3){
+        for(int i = 0; i < 64; ++i){
+            const cv::Vec3b& pixel = image.at<cv::Vec3b>(i * 7919 % image.rows, i * 104729 % image.cols);
+            mix(static_cast<uint32_t>(pixel[0]) | (static_cast<uint32_t>(pixel[1]) << 8u) |
+                    (static_cast<uint32_t>(pixel[2]) << 16u));
+        }
+    }
+    return hash;
+}
+
+void appendDetection(std::vector<float>& data, float imageId, float label, float confidence, float xmin, float ymin,
+        float xmax, float ymax){
+    const float detection[ssdObjectSize] = {imageId, label, confidence, xmin, ymin, xmax, ymax};
+    data.insert(data.end(), detection, detection + ssdObjectSize);
+}
+
+}
+
+MockBackend::MockBackend(const BackendConfig& config): m_loadDelay(config.mockLoadDelay), m_persons(config.mockPersons){
+    m_delay[PersonDetection] = config.mockDetectionDelay;
+    m_delay[PersonAttributes] = config.mockAttributesDelay;
+    for(int i = 0; i < NetworkCount; ++i){
+        m_seed[i] = 0u;
+    }
+}
+
+MockBackend::~MockBackend(){
+
+}
+
+const char* MockBackend::name() const{
+    return "mock";
+}
+
+bool MockBackend::load(bool){
+    // loading is expensive with every real backend; keep it expensive here so that reloading too often shows
+    std::this_thread::sleep_for(m_loadDelay);
+    return true;
+}
+
+void MockBackend::enqueue(Network network, const cv::Mat& image){
+    SISD_TRACE_SCOPE("matU8ToBlob");
+    m_seed[network] = imageDigest(image);
+}
+
+void MockBackend::submitRequest(Network network){
+    SISD_TRACE_SCOPE("submitRequest");
+    m_submitted[network] = std::chrono::steady_clock::now();
+}
+
+void MockBackend::wait(Network network){
+    SISD_TRACE_SCOPE("wait");
+    // spin rather than sleep, so that the mock occupies a core the way inference does
+    const std::chrono::steady_clock::time_point done = m_submitted[network] + m_delay[network];
+    while(std::chrono::steady_clock::now() < done){
+    }
+}
+
+void MockBackend::output(Network network, std::size_t index, Tensor& out){
+    const uint32_t seed = m_seed[network];
+    out.data.clear();
+    if(network == PersonDetection){
+        if(index != 0u){
+            throw std::logic_error("Person detection has a single output");
+        }
+        // persons side by side in columns, their height varying with the image
+        for(unsigned i = 0; i < m_persons; ++i){
+            const float column = 1.0f / m_persons;
+            const float top = 0.05f + static_cast<float>((seed >> (i % 16u)) & 0xfu) / 100.0f;
+            appendDetection(out.data, 0.0f, 1.0f, 0.95f - 0.01f * (i % 8u), column * (i + 0.1f), top, column * (i + 0.9f), 0.95f);
+        }
+        appendDetection(out.data, 0.0f, 2.0f, 0.9f, 0.4f, 0.4f, 0.6f, 0.6f);      // a vehicle
+        appendDetection(out.data, 0.0f, 1.0f, 0.3f, 0.0f, 0.0f, 0.2f, 0.2f);      // below the confidence threshold
+        appendDetection(out.data, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);     // end of detections
+        out.dims = {1u, 1u, out.data.size() / ssdObjectSize, ssdObjectSize};
+    }
+    else if(index == 0u){
+        for(std::size_t i = 0; i < ResultCodec::attributeCount; ++i){
+            out.data.push_back((seed >> i) & 1u ? 0.9f : 0.1f);
+        }
+        out.dims = {1u, ResultCodec::attributeCount};
+    }
+    else if(index == 1u || index == 2u){
+        out.data.push_back(0.5f);
+        out.data.push_back(index == 1u ? 0.25f : 0.75f);
+        out.dims = {1u, 2u};
+    }
+    else{
+        throw std::logic_error("Person attributes recognition has three outputs");
+    }
+}
+
+}
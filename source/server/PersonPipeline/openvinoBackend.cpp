@@ -0,0 +1,330 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <inference_engine.hpp>
+#include <server/PersonPipeline/slog.hpp>
+#include <server/PersonPipeline/ocv_common.hpp>
+
+#include <server/PersonPipeline/openvinoBackend.hpp>
+#include <server/profiling/layerProfile.hpp>
+#include <server/profiling/trace.hpp>
+
+using namespace InferenceEngine;
+
+namespace SISD{
+// -------------------------Generic routines for detection networks-------------------------------------------------
+
+struct BaseDetection {
+    ExecutableNetwork net;
+    InferRequest request;
+    std::string commandLineFlag;
+    std::string topoName;
+    Blob::Ptr inputBlob;
+    std::string inputName;
+    std::string outputName;
+
+    BaseDetection(const std::string &commandLineFlag, const std::string &topoName)
+            : commandLineFlag(commandLineFlag), topoName(topoName) {}
+
+    virtual ~BaseDetection() = default;
+
+    ExecutableNetwork * operator ->() {
+        return &net;
+    }
+    virtual CNNNetwork read(const Core& ie)  = 0;
+
+    virtual void setRoiBlob(const Blob::Ptr &roiBlob) {
+        if (!enabled())
+            return;
+        if (!request)
+            request = net.CreateInferRequest();
+
+        request.SetBlob(inputName, roiBlob);
+    }
+
+    virtual void enqueue(const cv::Mat &person) {
+        if (!enabled())
+            return;
+        if (!request)
+            request = net.CreateInferRequest();
+
+        inputBlob = request.GetBlob(inputName);
+        SISD_TRACE_SCOPE("matU8ToBlob");
+        matU8ToBlob<uint8_t>(person, inputBlob);
+    }
+
+    virtual void submitRequest() {
+        if (!enabled() || !request) return;
+        SISD_TRACE_SCOPE("submitRequest");
+        request.StartAsync();
+    }
+
+    virtual void wait() {
+        if (!enabled()|| !request) return;
+        SISD_TRACE_SCOPE("wait");
+        request.Wait(IInferRequest::WaitMode::RESULT_READY);
+    }
+    mutable bool enablingChecked = false;
+    mutable bool _enabled = false;
+
+    bool enabled() const  {
+        if (!enablingChecked) {
+            _enabled = !commandLineFlag.empty();
+            if (!_enabled) {
+                slog::info << topoName << " detection DISABLED" << slog::endl;
+            }
+            enablingChecked = true;
+        }
+        return _enabled;
+    }
+
+    void printPerformanceCounts(std::string fullDeviceName) const {
+        ::printPerformanceCounts(request, std::cout, fullDeviceName);
+    }
+
+    void accumulatePerformanceCounts() const {
+        if (!enabled() || !request) return;
+        for (const auto & it : request.GetPerformanceCounts()) {
+            if (it.second.status != InferenceEngineProfileInfo::EXECUTED)
+                continue;
+            SISD::LayerProfile::getInstance().accumulate(topoName, it.first, it.second.layer_type,
+                    it.second.exec_type, it.second.realTime_uSec, it.second.cpu_uSec);
+        }
+    }
+
+    /// copy an output blob of the finished request
+    void fetchOutput(const std::string& name, InferenceBackend::Tensor& out) {
+        Blob::Ptr blob = request.GetBlob(name);
+        LockedMemory<const void> blobMapped = as<MemoryBlob>(blob)->rmap();
+        const float* values = blobMapped.as<const float*>();
+        out.dims = blob->getTensorDesc().getDims();
+        out.data.assign(values, values + blob->size());
+    }
+};
+
+struct PersonDetection : BaseDetection{
+    int maxProposalCount;
+    int objectSize;
+
+    PersonDetection() : BaseDetection("person-vehicle-bike-detection-crossroad-0078.xml", "Person Detection"), maxProposalCount(0), objectSize(0) {}
+    CNNNetwork read(const Core& ie) override {
+        slog::info << "Loading network files for PersonDetection" << slog::endl;
+        /** Read network model **/
+        auto network = ie.ReadNetwork("person-vehicle-bike-detection-crossroad-0078.xml");
+        /** Set batch size to 1 **/
+        slog::info << "Batch size is forced to  1" << slog::endl;
+        network.setBatchSize(1);
+        // -----------------------------------------------------------------------------------------------------
+
+        /** SSD-based network should have one input and one output **/
+        // ---------------------------Check inputs ------------------------------------------------------
+        slog::info << "Checking Person Detection inputs" << slog::endl;
+        InputsDataMap inputInfo(network.getInputsInfo());
+        if (inputInfo.size() != 1) {
+            throw std::logic_error("Person Detection network should have only one input");
+        }
+        InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
+        inputInfoFirst->setPrecision(Precision::U8);
+
+
+        inputInfoFirst->getInputData()->setLayout(Layout::NCHW);
+        inputName = inputInfo.begin()->first;
+        // -----------------------------------------------------------------------------------------------------
+
+        // ---------------------------Check outputs ------------------------------------------------------
+        slog::info << "Checking Person Detection outputs" << slog::endl;
+        OutputsDataMap outputInfo(network.getOutputsInfo());
+        if (outputInfo.size() != 1) {
+            throw std::logic_error("Person Detection network should have only one output");
+        }
+        DataPtr& _output = outputInfo.begin()->second;
+        const SizeVector outputDims = _output->getTensorDesc().getDims();
+        outputName = outputInfo.begin()->first;
+        maxProposalCount = outputDims[2];
+        objectSize = outputDims[3];
+        if (objectSize != 7) {
+            throw std::logic_error("Output should have 7 as a last dimension");
+        }
+        if (outputDims.size() != 4) {
+            throw std::logic_error("Incorrect output dimensions for SSD");
+        }
+        _output->setPrecision(Precision::FP32);
+        _output->setLayout(Layout::NCHW);
+
+        slog::info << "Loading Person Detection model to CPU" << slog::endl;
+        return network;
+    }
+};
+
+struct PersonAttribsDetection : BaseDetection {
+    std::string outputNameForAttributes;
+    std::string outputNameForTopColorPoint;
+    std::string outputNameForBottomColorPoint;
+
+
+    PersonAttribsDetection() : BaseDetection("person-attributes-recognition-crossroad-0230.xml", "Person Attributes Recognition") {}
+
+    CNNNetwork read(const Core& ie) override {
+        slog::info << "Loading network files for PersonAttribs" << slog::endl;
+        /** Read network model **/
+        auto network = ie.ReadNetwork("person-attributes-recognition-crossroad-0230.xml");
+        /** Extract model name and load it's weights **/
+        network.setBatchSize(1);
+        slog::info << "Batch size is forced to 1 for Person Attribs" << slog::endl;
+        // -----------------------------------------------------------------------------------------------------
+
+        /** Person Attribs network should have one input two outputs **/
+        // ---------------------------Check inputs ------------------------------------------------------
+        slog::info << "Checking PersonAttribs inputs" << slog::endl;
+        InputsDataMap inputInfo(network.getInputsInfo());
+        if (inputInfo.size() != 1) {
+            throw std::logic_error("Person Attribs topology should have only one input");
+        }
+        InputInfo::Ptr& inputInfoFirst = inputInfo.begin()->second;
+        inputInfoFirst->setPrecision(Precision::U8);
+
+        inputInfoFirst->getInputData()->setLayout(Layout::NCHW);
+        inputName = inputInfo.begin()->first;
+        // -----------------------------------------------------------------------------------------------------
+
+        // ---------------------------Check outputs ------------------------------------------------------
+        slog::info << "Checking Person Attribs outputs" << slog::endl;
+        OutputsDataMap outputInfo(network.getOutputsInfo());
+        if (outputInfo.size() != 3) {
+             throw std::logic_error("Person Attribs Network expects networks having one output");
+        }
+        auto it = outputInfo.begin();
+        outputNameForAttributes = (it++)->second->getName();  // attribute probabilities
+        outputNameForTopColorPoint = (it++)->second->getName();  // top color location
+        outputNameForBottomColorPoint = (it++)->second->getName();  // bottom color location
+        slog::info << "Loading Person Attributes Recognition model to CPU" << slog::endl;
+        _enabled = true;
+        return network;
+    }
+};
+
+struct Load {
+    BaseDetection& detector;
+    explicit Load(BaseDetection& detector) : detector(detector) { }
+
+    void into(Core & ie, const std::string & deviceName, bool perfCount) const {
+        if (detector.enabled()) {
+            std::map<std::string, std::string> config;
+            if (perfCount)
+                config[PluginConfigParams::KEY_PERF_COUNT] = PluginConfigParams::YES;
+            detector.net = ie.LoadNetwork(detector.read(ie), deviceName, config);
+            detector.request = InferRequest();
+        }
+    }
+};
+
+
+class OpenVinoBackend::Impl{
+public:
+    explicit Impl(const BackendConfig& config);
+
+    bool load(bool perfCount);
+
+    BaseDetection& detector(Network network);
+
+    void output(Network network, std::size_t index, Tensor& out);
+
+private:
+    std::string m_device;
+    SISD::PersonDetection m_personDetection;
+    PersonAttribsDetection m_personAttribs;
+};
+
+OpenVinoBackend::Impl::Impl(const BackendConfig& config): m_device(config.device){
+
+}
+
+bool OpenVinoBackend::Impl::load(bool perfCount){
+    try {
+        std::cout << "InferenceEngine: " << GetInferenceEngineVersion() << std::endl;
+
+        // --------------------------- 1. Load inference engine -------------------------------------
+        Core ie;
+
+        slog::info << "Loading device " << m_device << slog::endl;
+
+        /** Printing device version **/
+        std::cout << ie.GetVersions(m_device) << std::endl;
+
+        // --------------------------- 2. Read IR models and load them to devices ------------------------------
+        Load(m_personDetection).into(ie, m_device, perfCount);
+        Load(m_personAttribs).into(ie, m_device, perfCount);
+    }
+    catch (const std::exception& error) {
+        std::cerr << "[ ERROR ] " << error.what() << std::endl;
+        return false;
+    }
+    catch (...) {
+        std::cerr << "[ ERROR ] Unknown/internal exception happened." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+BaseDetection& OpenVinoBackend::Impl::detector(Network network){
+    if (network == PersonDetection)
+        return m_personDetection;
+    return m_personAttribs;
+}
+
+void OpenVinoBackend::Impl::output(Network network, std::size_t index, Tensor& out){
+    if (network == PersonDetection) {
+        if (index != 0)
+            throw std::logic_error("Person detection has a single output");
+        m_personDetection.fetchOutput(m_personDetection.outputName, out);
+        return;
+    }
+    const std::string* names[] = {
+        &m_personAttribs.outputNameForAttributes,
+        &m_personAttribs.outputNameForTopColorPoint,
+        &m_personAttribs.outputNameForBottomColorPoint
+    };
+    if (index >= arraySize(names))
+        throw std::logic_error("Person attributes recognition has three outputs");
+    m_personAttribs.fetchOutput(*names[index], out);
+}
+
+OpenVinoBackend::OpenVinoBackend(const BackendConfig& config){
+    m_impl = std::unique_ptr<Impl>(new Impl(config));
+}
+
+OpenVinoBackend::~OpenVinoBackend(){
+
+}
+
+const char* OpenVinoBackend::name() const{
+    return "openvino";
+}
+
+bool OpenVinoBackend::load(bool perfCount){
+    return m_impl->load(perfCount);
+}
+
+void OpenVinoBackend::enqueue(Network network, const cv::Mat& image){
+    m_impl->detector(network).enqueue(image);
+}
+
+void OpenVinoBackend::submitRequest(Network network){
+    m_impl->detector(network).submitRequest();
+}
+
+void OpenVinoBackend::wait(Network network){
+    m_impl->detector(network).wait();
+}
+
+void OpenVinoBackend::output(Network network, std::size_t index, Tensor& out){
+    m_impl->output(network, index, out);
+}
+
+void OpenVinoBackend::accumulatePerformanceCounts(Network network){
+    m_impl->detector(network).accumulatePerformanceCounts();
+}
+
+}
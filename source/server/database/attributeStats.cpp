@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <server/database/attributeStats.hpp>
+#include <server/profiling/metrics.hpp>
+
+namespace SISD{
+
+namespace{
+
+/// minute of a bucket that is not counting any minute yet
+constexpr int64_t emptyMinute = -1;
+
+/// minute of a bucket while a thread clears it for a new minute
+constexpr int64_t busyMinute = -2;
+
+constexpr int64_t bucketMs = AttributeStats::bucketSeconds * 1000;
+
+/// each thread is assigned a shard round robin the first time it records results
+std::size_t shardIndex(){
+    static std::atomic<std::size_t> nextShard(0u);
+    static thread_local const std::size_t shard = nextShard.fetch_add(1u, std::memory_order_relaxed) % Counter::shardCount;
+    return shard;
+}
+
+int64_t nowMs(){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}
+
+constexpr int64_t AttributeStats::bucketSeconds;
+constexpr std::size_t AttributeStats::bucketCount;
+constexpr std::size_t AttributeStats::personsPerImageBuckets;
+constexpr std::size_t AttributeStats::boxSizeBuckets;
+
+const int AttributeStats::boxSizeBounds[AttributeStats::boxSizeBuckets - 1] = {16, 32, 64, 128, 256, 512};
+
+class AttributeStats::Impl{
+public:
+    Impl();
+
+    void record(const ImageRecordVec& images, int64_t timeMs);
+
+    std::string toJson(std::chrono::seconds window) const;
+
+private:
+    /// the counts of one minute from one shard. All counters belong to the minute stored in minute
+    struct Bucket{
+        std::atomic<int64_t> minute;
+        std::atomic<uint64_t> images;
+        std::atomic<uint64_t> persons;
+        std::atomic<uint64_t> attributes[ResultCodec::attributeCount];
+        std::atomic<uint64_t> personsPerImage[personsPerImageBuckets];
+        std::atomic<uint64_t> boxSizes[boxSizeBuckets];
+    };
+
+    /// the counts of a window, summed over buckets
+    struct Totals{
+        uint64_t images = 0u;
+        uint64_t persons = 0u;
+        uint64_t attributes[ResultCodec::attributeCount] = {};
+        uint64_t personsPerImage[personsPerImageBuckets] = {};
+        uint64_t boxSizes[boxSizeBuckets] = {};
+    };
+
+    static void clear(Bucket& bucket);
+
+    /// the bucket of the calling thread for a minute, cleared first if it still counts an older one
+    Bucket* acquire(int64_t minute);
+
+    // every shard owns a ring of bucketCount buckets in one piece, so the buckets threads of different shards
+    //  write to are far apart and need no padding against false sharing
+    std::unique_ptr<Bucket[]> m_buckets;
+};
+
+AttributeStats::Impl::Impl(): m_buckets(new Bucket[Counter::shardCount * bucketCount]){
+    for(std::size_t i = 0; i < Counter::shardCount * bucketCount; ++i){
+        clear(m_buckets[i]);
+        m_buckets[i].minute.store(emptyMinute, std::memory_order_relaxed);
+    }
+}
+
+void AttributeStats::Impl::clear(Bucket& bucket){
+    bucket.images.store(0u, std::memory_order_relaxed);
+    bucket.persons.store(0u, std::memory_order_relaxed);
+    for(auto& count : bucket.attributes){
+        count.store(0u, std::memory_order_relaxed);
+    }
+    for(auto& count : bucket.personsPerImage){
+        count.store(0u, std::memory_order_relaxed);
+    }
+    for(auto& count : bucket.boxSizes){
+        count.store(0u, std::memory_order_relaxed);
+    }
+}
+
+AttributeStats::Impl::Bucket* AttributeStats::Impl::acquire(int64_t minute){
+    Bucket& bucket = m_buckets[shardIndex() * bucketCount + static_cast<std::size_t>(minute) % bucketCount];
+    int64_t seen = bucket.minute.load(std::memory_order_acquire);
+    while(seen != minute){
+        if(seen > minute){
+            // the bucket already moved on to a later round of the ring
+            return nullptr;
+        }
+        if(seen == busyMinute){
+            // another thread of this shard is clearing the bucket, which takes a few dozen stores
+            std::this_thread::yield();
+            seen = bucket.minute.load(std::memory_order_acquire);
+        }
+        else if(bucket.minute.compare_exchange_weak(seen, busyMinute, std::memory_order_acquire)){
+            clear(bucket);
+            bucket.minute.store(minute, std::memory_order_release);
+            break;
+        }
+    }
+    return &bucket;
+}
+
+void AttributeStats::Impl::record(const ImageRecordVec& images, int64_t timeMs){
+    if(timeMs < 0){
+        return;
+    }
+    Bucket* bucket = acquire(timeMs / bucketMs);
+    if(!bucket){
+        return;
+    }
+    uint64_t persons = 0u;
+    for(const auto& image : images){
+        persons += image.persons.size();
+        bucket->personsPerImage[std::min(image.persons.size(), personsPerImageBuckets - 1)].fetch_add(1u,
+                std::memory_order_relaxed);
+        for(const auto& person : image.persons){
+            for(std::size_t i = 0; i < ResultCodec::attributeCount; ++i){
+                if(person.attributes & (1u << i)){
+                    bucket->attributes[i].fetch_add(1u, std::memory_order_relaxed);
+                }
+            }
+            const int64_t area = static_cast<int64_t>(std::max(person.width, 0)) * std::max(person.height, 0);
+            std::size_t size = 0u;
+            while(size < boxSizeBuckets - 1 &&
+                    area > static_cast<int64_t>(boxSizeBounds[size]) * boxSizeBounds[size]){
+                size++;
+            }
+            bucket->boxSizes[size].fetch_add(1u, std::memory_order_relaxed);
+        }
+    }
+    bucket->images.fetch_add(images.size(), std::memory_order_relaxed);
+    bucket->persons.fetch_add(persons, std::memory_order_relaxed);
+}
+
+std::string AttributeStats::Impl::toJson(std::chrono::seconds window) const{
+    const int64_t toMs = nowMs();
+    const int64_t last = toMs / bucketMs;
+    const int64_t buckets = std::min<int64_t>(std::max<int64_t>((window.count() + bucketSeconds - 1) / bucketSeconds,
+            1), static_cast<int64_t>(bucketCount));
+    const int64_t first = last - buckets + 1;
+
+    Totals totals;
+    for(int64_t minute = first; minute <= last; ++minute){
+        for(std::size_t shard = 0; shard < Counter::shardCount; ++shard){
+            const Bucket& bucket = m_buckets[shard * bucketCount + static_cast<std::size_t>(minute) % bucketCount];
+            // a bucket of another minute is skipped. One that is cleared meanwhile can only move on to a minute a
+            //  day later, which is not worth checking for
+            if(bucket.minute.load(std::memory_order_acquire) != minute){
+                continue;
+            }
+            totals.images += bucket.images.load(std::memory_order_relaxed);
+            totals.persons += bucket.persons.load(std::memory_order_relaxed);
+            for(std::size_t i = 0; i < ResultCodec::attributeCount; ++i){
+                totals.attributes[i] += bucket.attributes[i].load(std::memory_order_relaxed);
+            }
+            for(std::size_t i = 0; i < personsPerImageBuckets; ++i){
+                totals.personsPerImage[i] += bucket.personsPerImage[i].load(std::memory_order_relaxed);
+            }
+            for(std::size_t i = 0; i < boxSizeBuckets; ++i){
+                totals.boxSizes[i] += bucket.boxSizes[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const int64_t fromMs = first * bucketMs;
+    const double hours = static_cast<double>(std::max<int64_t>(toMs - fromMs, 1)) / 3600000.0;
+
+    boost::property_tree::ptree attributesNode;
+    for(std::size_t i = 0; i < ResultCodec::attributeCount; ++i){
+        boost::property_tree::ptree attributeNode;
+        attributeNode.put("persons", totals.attributes[i]);
+        attributeNode.put("percent", totals.persons ? 100.0 * totals.attributes[i] / totals.persons : 0.0);
+        // names are added as keys rather than paths, as put() would split them at dots
+        attributesNode.push_back(std::make_pair(ResultCodec::attributeNames[i], attributeNode));
+    }
+
+    boost::property_tree::ptree personsPerImageNode;
+    for(std::size_t i = 0; i < personsPerImageBuckets; ++i){
+        boost::property_tree::ptree countNode;
+        countNode.put_value(totals.personsPerImage[i]);
+        personsPerImageNode.push_back(std::make_pair(i + 1 < personsPerImageBuckets ? std::to_string(i) :
+                std::to_string(i) + "+", countNode));
+    }
+
+    boost::property_tree::ptree boxSizesNode;
+    for(std::size_t i = 0; i < boxSizeBuckets; ++i){
+        boost::property_tree::ptree countNode;
+        countNode.put_value(totals.boxSizes[i]);
+        boxSizesNode.push_back(std::make_pair(i + 1 < boxSizeBuckets ? "<=" + std::to_string(boxSizeBounds[i]) :
+                ">" + std::to_string(boxSizeBounds[i - 1]), countNode));
+    }
+
+    boost::property_tree::ptree jsonTree;
+    jsonTree.put("window_seconds", buckets * bucketSeconds);
+    jsonTree.put("from_ms", fromMs);
+    jsonTree.put("to_ms", toMs);
+    jsonTree.put("images", totals.images);
+    jsonTree.put("persons", totals.persons);
+    jsonTree.put("persons_per_hour", totals.persons / hours);
+    jsonTree.put("persons_per_image", totals.images ? static_cast<double>(totals.persons) / totals.images : 0.0);
+    jsonTree.add_child("attributes", attributesNode);
+    jsonTree.add_child("persons_per_image_histogram", personsPerImageNode);
+    jsonTree.add_child("box_size_histogram", boxSizesNode);
+
+    std::stringstream ss;
+    boost::property_tree::json_parser::write_json(ss, jsonTree);
+    return ss.str();
+}
+
+AttributeStats::AttributeStats(){
+    m_impl = std::unique_ptr<Impl>(new Impl);
+}
+
+AttributeStats::~AttributeStats(){
+
+}
+
+AttributeStats& AttributeStats::getInstance(){
+    static AttributeStats inst;
+    return inst;
+}
+
+std::chrono::seconds AttributeStats::maxWindow(){
+    return std::chrono::seconds(bucketSeconds * static_cast<int64_t>(bucketCount));
+}
+
+void AttributeStats::record(const ImageRecordVec& images, int64_t timeMs){
+    m_impl->record(images, timeMs);
+}
+
+std::string AttributeStats::toJson(std::chrono::seconds window) const{
+    return m_impl->toJson(window);
+}
+
+}
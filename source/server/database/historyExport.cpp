@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#ifdef SISD_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include <server/database/historyExport.hpp>
+
+namespace SISD{
+
+namespace{
+
+const char columnarMagic[4] = {'S', 'I', 'S', 'C'};
+
+/// magic, version, reserved and length
+constexpr std::size_t columnarHeaderSize = 12u;
+
+void appendU16(std::string& out, uint16_t v){
+    out.push_back(static_cast<char>(v & 0xff));
+    out.push_back(static_cast<char>((v >> 8) & 0xff));
+}
+
+void appendU32(std::string& out, uint32_t v){
+    for(int i = 0; i < 4; ++i){
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+void appendU64(std::string& out, uint64_t v){
+    for(int i = 0; i < 8; ++i){
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+void storeU32(char* p, uint32_t v){
+    for(int i = 0; i < 4; ++i){
+        p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+}
+
+/// decode a stored record, which is a binary frame or json
+bool decodeRecord(const std::string& body, ImageRecordVec& images){
+    if(ResultCodec::isBinary(body)){
+        return ResultCodec::decodeBinary(body.data(), body.length(), images);
+    }
+    return ResultCodec::fromJson(body, images);
+}
+
+}
+
+class HistoryExport::Impl{
+public:
+    Impl(Format format, int64_t fromMs, int64_t toMs, std::size_t pageRecords, bool gzip);
+
+    ~Impl();
+
+    bool next(std::string& chunk);
+
+    bool failed() const;
+
+private:
+    /// append a line per record
+    void encodeNdjson(const HistoryStorage::RecordVec& records, const std::vector<int64_t>& times,
+            std::string& out) const;
+
+    /// append a batch holding all records
+    void encodeColumnar(const HistoryStorage::RecordVec& records, const std::vector<int64_t>& times,
+            std::string& out) const;
+
+    /// feed encoded output to the compressor and append what it produces
+    void compress(const std::string& in, bool finish, std::string& out);
+
+    Format m_format;
+    int64_t m_fromMs;
+    int64_t m_toMs;
+    std::size_t m_pageRecords;
+    std::string m_cursor;
+    bool m_done;
+    bool m_failed;
+    bool m_gzip;
+#ifdef SISD_WITH_ZLIB
+    z_stream m_zstream;
+#endif
+};
+
+HistoryExport::Impl::Impl(Format format, int64_t fromMs, int64_t toMs, std::size_t pageRecords, bool gzip):
+        m_format(format), m_fromMs(fromMs), m_toMs(toMs), m_pageRecords(std::max<std::size_t>(pageRecords, 1u)),
+        m_cursor("0"), m_done(false), m_failed(false), m_gzip(false){
+#ifdef SISD_WITH_ZLIB
+    if(gzip){
+        std::memset(&m_zstream, 0, sizeof(m_zstream));
+        // 16 added to the window bits asks for a gzip header instead of a zlib one
+        m_gzip = deflateInit2(&m_zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+#else
+    (void)gzip;
+#endif
+}
+
+HistoryExport::Impl::~Impl(){
+#ifdef SISD_WITH_ZLIB
+    if(m_gzip){
+        deflateEnd(&m_zstream);
+    }
+#endif
+}
+
+bool HistoryExport::Impl::next(std::string& chunk){
+    if(m_done){
+        return false;
+    }
+    HistoryStorage::RecordVec records;
+    std::vector<int64_t> times;
+    std::string next;
+    if(!HistoryStorage::getInstance().exportRange(m_fromMs, m_toMs, m_cursor, m_pageRecords, records, times,
+            next) || times.size() != records.size()){
+        // the reply is cut short, which the client notices as a malformed or truncated body
+        m_failed = true;
+        m_done = true;
+        return false;
+    }
+    m_cursor = next;
+    const bool last = m_cursor == "0";
+
+    std::string encoded;
+    if(m_format == Columnar){
+        encodeColumnar(records, times, encoded);
+    }
+    else{
+        encodeNdjson(records, times, encoded);
+    }
+    if(m_gzip){
+        compress(encoded, last, chunk);
+    }
+    else{
+        chunk.swap(encoded);
+    }
+    m_done = last;
+    return !last;
+}
+
+bool HistoryExport::Impl::failed() const{
+    return m_failed;
+}
+
+void HistoryExport::Impl::encodeNdjson(const HistoryStorage::RecordVec& records, const std::vector<int64_t>& times,
+        std::string& out) const{
+    for(std::size_t i = 0; i < records.size(); ++i){
+        out += "{\"handle\":";
+        ResultCodec::appendJsonString(out, records[i].first);
+        out += ",\"time\":" + std::to_string(times[i]) + ",\"result\":";
+        ImageRecordVec images;
+        if(!decodeRecord(records[i].second, images)){
+            out += "null}\n";
+            continue;
+        }
+        // the result object of /predict, without its whitespace so that the record fits on one line
+        out.push_back('{');
+        bool firstImage = true;
+        for(const auto& image : images){
+            if(image.persons.empty()){
+                continue;
+            }
+            if(!firstImage){
+                out.push_back(',');
+            }
+            firstImage = false;
+            ResultCodec::appendJsonString(out, image.imageName);
+            out += ":[";
+            for(std::size_t p = 0; p < image.persons.size(); ++p){
+                const PersonRecord& person = image.persons[p];
+                if(p > 0u){
+                    out.push_back(',');
+                }
+                out += "{\"x\":" + std::to_string(person.x) + ",\"y\":" + std::to_string(person.y) +
+                        ",\"width\":" + std::to_string(person.width) + ",\"height\":" + std::to_string(person.height) +
+                        ",\"attributes\":";
+                ResultCodec::appendJsonString(out, ResultCodec::attributeString(person.attributes));
+                out.push_back('}');
+            }
+            out.push_back(']');
+        }
+        out += "}}\n";
+    }
+}
+
+void HistoryExport::Impl::encodeColumnar(const HistoryStorage::RecordVec& records, const std::vector<int64_t>& times,
+        std::string& out) const{
+    if(records.empty()){
+        return;
+    }
+    std::vector<uint32_t> personCounts(records.size(), 0u);
+    std::vector<uint8_t> valid(records.size(), 0u);
+    std::vector<PersonRecord> persons;
+    for(std::size_t i = 0; i < records.size(); ++i){
+        ImageRecordVec images;
+        if(!decodeRecord(records[i].second, images)){
+            continue;
+        }
+        valid[i] = 1u;
+        for(const auto& image : images){
+            persons.insert(persons.end(), image.persons.begin(), image.persons.end());
+            personCounts[i] += static_cast<uint32_t>(image.persons.size());
+        }
+    }
+
+    const std::size_t start = out.size();
+    out.append(columnarMagic, sizeof(columnarMagic));
+    appendU16(out, columnarVersion);
+    appendU16(out, 0u);
+    appendU32(out, 0u);     // length, filled in below
+    appendU32(out, static_cast<uint32_t>(records.size()));
+    appendU32(out, static_cast<uint32_t>(persons.size()));
+    for(int64_t time : times){
+        appendU64(out, static_cast<uint64_t>(time));
+    }
+    for(const auto& record : records){
+        appendU64(out, std::strtoull(record.first.c_str(), nullptr, 10));
+    }
+    for(uint32_t count : personCounts){
+        appendU32(out, count);
+    }
+    for(const auto& person : persons){
+        appendU32(out, static_cast<uint32_t>(person.x));
+    }
+    for(const auto& person : persons){
+        appendU32(out, static_cast<uint32_t>(person.y));
+    }
+    for(const auto& person : persons){
+        appendU32(out, static_cast<uint32_t>(person.width));
+    }
+    for(const auto& person : persons){
+        appendU32(out, static_cast<uint32_t>(person.height));
+    }
+    for(const auto& person : persons){
+        appendU32(out, person.attributes);
+    }
+    out.append(reinterpret_cast<const char*>(valid.data()), valid.size());
+    storeU32(&out[start + columnarHeaderSize - 4u], static_cast<uint32_t>(out.size() - start - columnarHeaderSize));
+}
+
+void HistoryExport::Impl::compress(const std::string& in, bool finish, std::string& out){
+#ifdef SISD_WITH_ZLIB
+    // without a flush per chunk zlib picks the block boundaries, and a chunk may stay empty until it has
+    //  collected enough input
+    m_zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    m_zstream.avail_in = static_cast<uInt>(in.length());
+    char buffer[16384];
+    do{
+        m_zstream.next_out = reinterpret_cast<Bytef*>(buffer);
+        m_zstream.avail_out = sizeof(buffer);
+        deflate(&m_zstream, finish ? Z_FINISH : Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - m_zstream.avail_out);
+    } while(m_zstream.avail_out == 0u);
+#else
+    (void)finish;
+    out += in;
+#endif
+}
+
+bool HistoryExport::parseFormat(const std::string& name, Format& out){
+    if(name == "ndjson"){
+        out = Ndjson;
+        return true;
+    }
+    if(name == "columnar"){
+        out = Columnar;
+        return true;
+    }
+    return false;
+}
+
+const char* HistoryExport::mimeType(Format format){
+    return format == Columnar ? "application/vnd.sisd.history-columnar" : "application/x-ndjson";
+}
+
+bool HistoryExport::gzipAvailable(){
+#ifdef SISD_WITH_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+HistoryExport::HistoryExport(Format format, int64_t fromMs, int64_t toMs, std::size_t pageRecords, bool gzip){
+    m_impl = std::unique_ptr<Impl>(new Impl(format, fromMs, toMs, pageRecords, gzip));
+}
+
+HistoryExport::~HistoryExport(){
+
+}
+
+bool HistoryExport::next(std::string& chunk){
+    return m_impl->next(chunk);
+}
+
+bool HistoryExport::failed() const{
+    return m_impl->failed();
+}
+
+}
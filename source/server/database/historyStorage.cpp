@@ -1,54 +1,708 @@
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
 #include <mutex>
-#include <sw/redis++/redis++.h>
+#include <sstream>
+#include <thread>
 
+#include <server/database/attributeStats.hpp>
+#include <server/database/boundedQueue.hpp>
 #include <server/database/historyStorage.hpp>
+#include <server/database/hotCache.hpp>
+#include <server/database/storageBackend.hpp>
+#include <server/profiling/metrics.hpp>
+#include <server/profiling/trace.hpp>
 
 namespace SISD{
 
+namespace{
+
+HistoryStorage::Options& storageOptions(){
+    static HistoryStorage::Options options;
+    return options;
+}
+
+int64_t nowMs(){
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+* @brief count the records of a spill file
+*
+* @param path the spill file
+* @param nextHandle raised past the handles of the records
+* @return the number of complete records
+*
+*/
+uint64_t countSpilled(const std::string& path, HistoryStorage::JobHandle& nextHandle){
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if(!in){
+        return 0u;
+    }
+    const std::streamoff size = in.tellg();
+    in.seekg(0);
+    uint64_t ret = 0u;
+    std::string line;
+    while(std::getline(in, line)){
+        std::istringstream header(line);
+        HistoryStorage::JobHandle handle;
+        std::size_t length;
+        // a record cut short by a crash is not complete, and is not stored either
+        if(!(header >> handle >> length) ||
+                static_cast<std::streamoff>(in.tellg()) + static_cast<std::streamoff>(length) > size){
+            break;
+        }
+        in.seekg(length, std::ios::cur);
+        nextHandle = std::max(nextHandle, handle + 1u);
+        ++ret;
+    }
+    return ret;
+}
+
+/// a record waiting for the writer
+using PendingRecord = StorageBackend::Record;
+
+}
+
 class HistoryStorage::Impl{
 public:
 
-    Impl();
+    Impl(const Options& options);
 
     ~Impl();
 
     JobHandle generateHandle();
 
-    bool save(JobHandle handle, const std::string& json);
+    bool save(JobHandle handle, const std::string& json, const ImageRecordVec* results);
+
+    bool flush(std::chrono::milliseconds timeout);
 
     bool getAll(std::unordered_map<std::string, std::string>& res);
 
+    bool scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next);
+
+    bool scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count, RecordVec& res,
+            std::string& next);
+
+    bool exportRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count, RecordVec& res,
+            std::vector<int64_t>& times, std::string& next);
+
+    bool filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res);
+
+    bool fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count, RecordVec& res);
+
+    std::string versionTag() const;
+
 private:
-    uint32_t m_ctr;
-    std::unique_ptr<sw::redis::Redis> m_ctxP;
-    std::mutex m_ctrMutex;
+    /// body of the background writer
+    void writerLoop();
+
+    /// hand a batch to the backend and account it as processed
+    void writeBatch(std::vector<PendingRecord>& batch);
+
+    /// append a record to the spill file
+    bool spill(const PendingRecord& record);
+
+    /// move the spill file aside and store its records
+    void drainSpill();
+
+    /// account records as written, or given up on, and wake up flush()
+    void markProcessed(uint64_t count);
+
+    /// reserve the next block of handles, unless another thread did since the given handle was taken
+    void reserveHandles(JobHandle taken);
+
+    /// body of the retention sweeper, which runs one sweep() per sweep interval
+    void sweeperLoop();
+
+    /// remove up to a sweep batch of the records that exceed the retention limits
+    void sweep();
+
+    Options m_options;
+    std::unique_ptr<StorageBackend> m_backend;
+    std::unique_ptr<HotCache> m_cache;      // null if disabled
+
+    // bumped after every change of the stored records, see versionTag()
+    const int64_t m_startMs;
+    std::atomic<uint64_t> m_version;
+
+    // handles are taken from the reserved block [m_handleBegin, m_handleEnd) by incrementing m_nextHandle,
+    //  which never decreases. m_handleMutex is only held to reserve the next block
+    std::atomic<JobHandle> m_nextHandle;
+    std::atomic<JobHandle> m_handleBegin;
+    std::atomic<JobHandle> m_handleEnd;
+    std::mutex m_handleMutex;
+    uint64_t m_borrowedHandles;         // handles used after the last block while the backend failed
+
+    BoundedQueue<PendingRecord> m_queue;
+
+    // records accepted by save() and records the writer is done with. flush() waits for them to meet
+    std::atomic<uint64_t> m_accepted;
+    std::atomic<uint64_t> m_processed;
+
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerWakeup;
+    std::condition_variable m_processedChanged;
+    std::condition_variable m_sweeperWakeup;
+    bool m_stopping;
+    unsigned m_flushWaiters;
+    std::thread m_writer;
+    std::thread m_sweeper;
+
+    std::mutex m_spillMutex;
+    std::ofstream m_spillOut;
+    std::atomic<bool> m_spillPending;
 };
 
-HistoryStorage::Impl::Impl():m_ctr(0u){
-    m_ctxP = std::unique_ptr<sw::redis::Redis>(new sw::redis::Redis("tcp://127.0.0.1:6379"));
+HistoryStorage::Impl::Impl(const Options& options): m_options(options), m_startMs(nowMs()), m_version(0u),
+        m_nextHandle(0u), m_handleBegin(0u), m_handleEnd(0u), m_borrowedHandles(0u),
+        m_queue(std::max<std::size_t>(options.queueCapacity, 2u)), m_accepted(0u), m_processed(0u), m_stopping(false),
+        m_flushWaiters(0u), m_spillPending(false){
+    m_options.batchSize = std::max<std::size_t>(m_options.batchSize, 1u);
+    m_options.handleBlock = std::max<std::size_t>(m_options.handleBlock, 1u);
+    m_backend = StorageBackend::create(m_options);
+    if(!m_backend){
+        throw std::runtime_error("The history storage backend is not available in this build");
+    }
+    // the first block is reserved up front, as there is no handle known to be free to fall back to
+    const JobHandle first = m_backend->reserveHandles(m_options.handleBlock);
+    m_handleBegin = first;
+    m_handleEnd = first + m_options.handleBlock;
+
+    // records spilled by a previous run are stored once the writer starts. They count as accepted, so
+    //  that flush() does not take them for records of this run. The backend does not know their handles
+    //  before, so new handles start after them
+    JobHandle next = first;
+    const uint64_t previous = countSpilled(m_options.spillPath, next);
+    m_nextHandle = next;
+    m_accepted = previous;
+    m_spillPending = previous > 0u;
+
+    // the writer reports to Metrics until it is joined at exit, so Metrics has to be destroyed after this
+    Metrics::getInstance();
+    if(m_options.cacheRecords > 0u && m_options.backend != Log){
+        std::cout << "[ INFO ] The history cache is disabled, as other servers may write to the same "
+                << m_backend->name() << std::endl;
+    }
+    else if(m_options.cacheRecords > 0u){
+        // the cache only holds the records of this server, so it is only complete while no other server
+        //  writes to the backend, which the log backend guarantees. Records retention removed are not served
+        //  from the cache either. Records removed for the count and byte limits are evicted by sweep()
+        std::chrono::milliseconds window = m_options.cacheWindow;
+        const std::chrono::milliseconds retention = m_options.retentionAge;
+        if(retention.count() > 0 && (window.count() <= 0 || window > retention)){
+            window = retention;
+        }
+        m_cache = std::unique_ptr<HotCache>(new HotCache(m_options.cacheRecords, m_options.cacheBytes, window,
+                m_startMs));
+    }
+    m_writer = std::thread(&Impl::writerLoop, this);
+    if(m_options.retentionAge.count() > 0 || m_options.retentionRecords > 0u || m_options.retentionBytes > 0u){
+        m_options.sweepBatch = std::max<std::size_t>(m_options.sweepBatch, 1u);
+        m_sweeper = std::thread(&Impl::sweeperLoop, this);
+    }
 }
 
 HistoryStorage::Impl::~Impl(){
-
+    {
+        std::lock_guard<std::mutex> lg(m_writerMutex);
+        m_stopping = true;
+    }
+    m_writerWakeup.notify_one();
+    m_sweeperWakeup.notify_one();
+    if(m_sweeper.joinable()){
+        m_sweeper.join();
+    }
+    if(m_writer.joinable()){
+        m_writer.join();
+    }
 }
 
 HistoryStorage::JobHandle HistoryStorage::Impl::generateHandle(){
-    std::lock_guard<std::mutex> lg(m_ctrMutex);
-    JobHandle ret = m_ctr++;
-    return ret;
+    while(true){
+        const JobHandle handle = m_nextHandle.fetch_add(1u);
+        // a new block's begin is published before its end, so the end read here comes with its own begin or
+        //  a later one, and a handle outside every reserved block is never returned. A handle that only
+        //  loses such a race is skipped, which leaves a harmless gap
+        if(handle < m_handleEnd.load() && handle >= m_handleBegin.load()){
+            return handle;
+        }
+        reserveHandles(handle);
+    }
+}
+
+void HistoryStorage::Impl::reserveHandles(JobHandle taken){
+    std::lock_guard<std::mutex> lg(m_handleMutex);
+    const JobHandle end = m_handleEnd.load();
+    if(taken < end){
+        return;
+    }
+    JobHandle first;
+    try{
+        // handles borrowed during a failure directly follow the last block, and so start the next one
+        first = m_backend->reserveHandles(m_options.handleBlock + m_borrowedHandles) + m_borrowedHandles;
+        m_borrowedHandles = 0u;
+    }
+    catch(const std::exception& e){
+        // rather than failing /predict, continue after the last block. These handles are reserved with
+        //  the next block, which keeps them unique unless another server shares the database
+        std::cerr << "[ ERROR ] Unable to reserve history handles, continuing locally: " << e.what() << std::endl;
+        first = end;
+        m_borrowedHandles += m_options.handleBlock;
+    }
+    if(first != end){
+        // the backend gave out the handles in between to someone else. m_nextHandle is only raised, so that
+        //  no handle is taken twice
+        m_handleBegin = first;
+        JobHandle next = m_nextHandle.load();
+        while(next < first && !m_nextHandle.compare_exchange_weak(next, first)){
+        }
+    }
+    m_handleEnd = first + m_options.handleBlock;
 }
 
-bool HistoryStorage::Impl::save(JobHandle handle, const std::string& json){
-    m_ctxP->hset("history", std::make_pair(std::to_string(handle), json));
+bool HistoryStorage::Impl::save(JobHandle handle, const std::string& json, const ImageRecordVec* results){
+    Metrics& metrics = Metrics::getInstance();
+    PendingRecord record{handle, nowMs(), std::string(), std::vector<uint32_t>()};
+    if(results){
+        AttributeStats::getInstance().record(*results, record.timeMs);
+        for(const auto& image : *results){
+            for(const auto& person : image.persons){
+                record.persons.push_back(person.attributes);
+            }
+        }
+    }
+    if(results && m_options.format == Binary){
+        ResultCodec::encodeBinary(*results, record.body);
+    }
+    else{
+        record.body = json;
+    }
+    const std::size_t storedBytes = record.body.length();
+    if(m_cache){
+        m_cache->add(handle, record.timeMs, record.body, record.persons);
+        std::size_t cachedRecords;
+        std::size_t cachedBytes;
+        m_cache->usage(cachedRecords, cachedBytes);
+        metrics.historyCacheRecords.set(static_cast<int64_t>(cachedRecords));
+        metrics.historyCacheBytes.set(static_cast<int64_t>(cachedBytes));
+    }
+    while(!m_queue.tryPush(std::move(record))){
+        if(m_options.overflow == Drop){
+            metrics.historyDropped.add();
+            if(m_cache){
+                m_cache->remove(handle);
+            }
+            return false;
+        }
+        if(m_options.overflow == Spill){
+            if(!spill(record)){
+                if(m_cache){
+                    m_cache->remove(handle);
+                }
+                return false;
+            }
+            metrics.historyJsonBytes.add(json.length());
+            metrics.historyStoredBytes.add(storedBytes);
+            m_version.fetch_add(1u);
+            return true;
+        }
+        // block until the writer makes room
+        m_writerWakeup.notify_one();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    m_accepted.fetch_add(1u, std::memory_order_relaxed);
+    // after the record is accepted, so that a reader that sees the new version also flushes the record
+    m_version.fetch_add(1u);
+    metrics.historyQueueDepth.add();
+    metrics.historyJsonBytes.add(json.length());
+    metrics.historyStoredBytes.add(storedBytes);
+    if(m_queue.size() >= m_options.batchSize){
+        m_writerWakeup.notify_one();
+    }
     return true;
 }
 
+bool HistoryStorage::Impl::spill(const PendingRecord& record){
+    std::lock_guard<std::mutex> lg(m_spillMutex);
+    if(!m_spillOut.is_open()){
+        m_spillOut.open(m_options.spillPath, std::ios::binary | std::ios::app);
+    }
+    // "<handle> <length> <time> <person attributes>*\n<body>"
+    m_spillOut << record.handle << ' ' << record.body.length() << ' ' << record.timeMs;
+    for(uint32_t person : record.persons){
+        m_spillOut << ' ' << person;
+    }
+    m_spillOut << '\n';
+    m_spillOut.write(record.body.data(), record.body.length());
+    m_spillOut.flush();
+    if(!m_spillOut){
+        std::cerr << "[ ERROR ] Unable to spill a history record to " << m_options.spillPath << std::endl;
+        m_spillOut.close();
+        Metrics::getInstance().historyDropped.add();
+        return false;
+    }
+    m_accepted.fetch_add(1u, std::memory_order_relaxed);
+    m_spillPending.store(true, std::memory_order_release);
+    Metrics::getInstance().historySpilled.add();
+    return true;
+}
+
+void HistoryStorage::Impl::drainSpill(){
+    const std::string drainingPath = m_options.spillPath + ".draining";
+    {
+        std::lock_guard<std::mutex> lg(m_spillMutex);
+        if(m_spillOut.is_open()){
+            m_spillOut.close();
+        }
+        m_spillPending.store(false, std::memory_order_relaxed);
+        if(std::rename(m_options.spillPath.c_str(), drainingPath.c_str()) != 0){
+            return;
+        }
+    }
+
+    std::ifstream in(drainingPath, std::ios::binary);
+    std::vector<PendingRecord> batch;
+    std::string line;
+    while(std::getline(in, line)){
+        std::istringstream header(line);
+        JobHandle handle;
+        std::size_t length;
+        if(!(header >> handle >> length)){
+            break;
+        }
+        // spill files written before records had a time are indexed at the time they are drained
+        int64_t timeMs;
+        if(!(header >> timeMs)){
+            timeMs = nowMs();
+        }
+        std::vector<uint32_t> persons;
+        uint32_t person;
+        while(header >> person){
+            persons.push_back(person);
+        }
+        std::string body(length, '\0');
+        if(!in.read(&body[0], length)){
+            break;
+        }
+        batch.push_back(PendingRecord{handle, timeMs, std::move(body), std::move(persons)});
+        if(batch.size() >= m_options.batchSize){
+            writeBatch(batch);
+        }
+    }
+    if(!batch.empty()){
+        writeBatch(batch);
+    }
+    in.close();
+    std::remove(drainingPath.c_str());
+    m_version.fetch_add(1u);
+}
+
+void HistoryStorage::Impl::writeBatch(std::vector<PendingRecord>& batch){
+    SISD_TRACE_SCOPE("HistoryStorage::writeBatch");
+    Metrics& metrics = Metrics::getInstance();
+    StageTimings::Clock::time_point start = StageTimings::Clock::now();
+    try{
+        m_backend->write(batch);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to store " << batch.size() << " history records: " << e.what() << std::endl;
+        metrics.historyWriteErrors.add(batch.size());
+        // records the backend does not hold are not served from the cache either
+        if(m_cache){
+            for(const auto& record : batch){
+                m_cache->remove(record.handle);
+            }
+        }
+    }
+    metrics.storageSaveLatency.observe(StageTimings::Clock::now() - start);
+    metrics.historyBatches.add();
+    metrics.historyRecords.add(batch.size());
+    const uint64_t count = batch.size();
+    batch.clear();
+    markProcessed(count);
+}
+
+void HistoryStorage::Impl::markProcessed(uint64_t count){
+    {
+        std::lock_guard<std::mutex> lg(m_writerMutex);
+        m_processed.fetch_add(count, std::memory_order_relaxed);
+    }
+    m_processedChanged.notify_all();
+}
+
+void HistoryStorage::Impl::writerLoop(){
+    Metrics& metrics = Metrics::getInstance();
+    std::vector<PendingRecord> batch;
+    batch.reserve(m_options.batchSize);
+    PendingRecord record;
+    StageTimings::Clock::time_point deadline;
+    while(true){
+        if(batch.size() < m_options.batchSize && m_queue.tryPop(record)){
+            if(batch.empty()){
+                deadline = StageTimings::Clock::now() + m_options.flushInterval;
+            }
+            batch.push_back(std::move(record));
+            metrics.historyQueueDepth.sub();
+            continue;
+        }
+
+        // a batch is written once it is full, once its first record waited flushInterval, or right away
+        //  when someone waits in flush() or the storage shuts down
+        if(!batch.empty()){
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            if(batch.size() < m_options.batchSize && !m_stopping && m_flushWaiters == 0u &&
+                    m_writerWakeup.wait_until(lock, deadline) == std::cv_status::no_timeout){
+                continue;
+            }
+            lock.unlock();
+            writeBatch(batch);
+            continue;
+        }
+
+        // spilled records are stored once the queue has drained, so they do not hold up newer ones
+        if(m_spillPending.load(std::memory_order_acquire)){
+            drainSpill();
+            continue;
+        }
+
+        try{
+            m_backend->idle();
+        }
+        catch(const std::exception& e){
+            std::cerr << "[ ERROR ] History storage failed while idle: " << e.what() << std::endl;
+        }
+
+        std::unique_lock<std::mutex> lock(m_writerMutex);
+        if(m_stopping){
+            break;
+        }
+        // producers only wake the writer for a full batch, so it also checks the queue every flushInterval
+        m_writerWakeup.wait_for(lock, m_options.flushInterval);
+    }
+}
+
+void HistoryStorage::Impl::sweeperLoop(){
+    std::unique_lock<std::mutex> lock(m_writerMutex);
+    while(!m_sweeperWakeup.wait_for(lock, m_options.sweepInterval, [this](){ return m_stopping; })){
+        lock.unlock();
+        sweep();
+        lock.lock();
+    }
+}
+
+void HistoryStorage::Impl::sweep(){
+    // a step removes at most sweepBatch records, so that a large excess, e.g. after lowering a limit, is
+    //  removed at a bounded rate instead of in one burst that would hold up the writer and readers
+    Metrics& metrics = Metrics::getInstance();
+    try{
+        uint64_t records = 0u;
+        uint64_t bytes = 0u;
+        m_backend->usage(records, bytes);
+        uint64_t excess = 0u;
+        if(m_options.retentionRecords > 0u && records > m_options.retentionRecords){
+            excess = records - m_options.retentionRecords;
+        }
+        if(m_options.retentionBytes > 0u && bytes > m_options.retentionBytes && records > 0u){
+            // the records removed are taken to have the average size, later steps correct the estimate
+            const uint64_t average = std::max<uint64_t>(bytes / records, 1u);
+            excess = std::max<uint64_t>(excess, (bytes - m_options.retentionBytes + average - 1u) / average);
+        }
+
+        std::size_t removed = 0u;
+        uint64_t removedBytes = 0u;
+        if(excess > 0u){
+            removed = m_backend->removeOldest(static_cast<std::size_t>(std::min<uint64_t>(excess,
+                    m_options.sweepBatch)), std::numeric_limits<int64_t>::max(), removedBytes);
+        }
+        if(m_options.retentionAge.count() > 0 && removed < m_options.sweepBatch){
+            const int64_t cutoff = nowMs() - std::chrono::duration_cast<std::chrono::milliseconds>(
+                    m_options.retentionAge).count();
+            uint64_t expiredBytes = 0u;
+            removed += m_backend->removeOldest(m_options.sweepBatch - removed, cutoff, expiredBytes);
+            removedBytes += expiredBytes;
+        }
+        if(removed > 0u){
+            // the backend removed its oldest records and holds at least the remaining ones, the newest. The
+            //  byte limit is applied by an estimate, so the cache is trimmed by count rather than by its own
+            //  limits to stay within what the backend still serves
+            if(m_cache){
+                m_cache->trim(static_cast<std::size_t>(records - std::min<uint64_t>(records, removed)));
+                std::size_t cachedRecords;
+                std::size_t cachedBytes;
+                m_cache->usage(cachedRecords, cachedBytes);
+                metrics.historyCacheRecords.set(static_cast<int64_t>(cachedRecords));
+                metrics.historyCacheBytes.set(static_cast<int64_t>(cachedBytes));
+            }
+            m_version.fetch_add(1u);
+        }
+        metrics.historyExpired.add(removed);
+        metrics.historyKeptRecords.set(static_cast<int64_t>(records - std::min<uint64_t>(records, removed)));
+        metrics.historyKeptBytes.set(static_cast<int64_t>(bytes - std::min(bytes, removedBytes)));
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] History retention failed: " << e.what() << std::endl;
+    }
+}
+
+bool HistoryStorage::Impl::flush(std::chrono::milliseconds timeout){
+    const uint64_t target = m_accepted.load(std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(m_writerMutex);
+    ++m_flushWaiters;
+    m_writerWakeup.notify_one();
+    bool ret = m_processedChanged.wait_for(lock, timeout, [&](){
+        return m_processed.load(std::memory_order_relaxed) >= target;
+    });
+    --m_flushWaiters;
+    return ret;
+}
+
 bool HistoryStorage::Impl::getAll(std::unordered_map<std::string, std::string>& res){
     res.clear();
-    m_ctxP->hgetall("history", std::inserter(res, res.begin()));
+    RecordVec page;
+    std::string cursor = "0";
+    do{
+        if(!scan(cursor, 1024u, page, cursor)){
+            return false;
+        }
+        for(auto& record : page){
+            if(ResultCodec::isBinary(record.second)){
+                ImageRecordVec images;
+                ResultCodec::decodeBinary(record.second.data(), record.second.length(), images);
+                record.second = ResultCodec::toJson(images);
+            }
+            res[record.first] = std::move(record.second);
+        }
+    } while(cursor != "0");
+    return true;
+}
+
+bool HistoryStorage::Impl::scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next){
+    if(cursor == "0"){
+        flush(std::chrono::milliseconds(5000));
+    }
+    res.clear();
+    try{
+        m_backend->scan(cursor, count, res, next);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to scan history: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HistoryStorage::Impl::scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+        RecordVec& res, std::string& next){
+    res.clear();
+    // the cache pages a range with the same cursors as the backend, the key of the last record returned. A
+    //  page the cache no longer covers is read from the backend, which continues after the same record
+    HotCache::Key after;
+    bool resume = false;
+    try{
+        resume = StorageBackend::rangeKey(cursor, after.first, after.second);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to scan history by time: " << e.what() << std::endl;
+        return false;
+    }
+    if(m_cache){
+        Metrics& metrics = Metrics::getInstance();
+        HotCache::Key last;
+        bool more = false;
+        if(m_cache->range(fromMs, toMs, resume ? &after : nullptr, count, res, last, more)){
+            metrics.historyCacheHits.add();
+            next = !more ? "0" : res.empty() ? cursor : StorageBackend::rangeCursor(last.first, last.second);
+            return true;
+        }
+        metrics.historyCacheMisses.add();
+    }
+    // the records the cache returned for earlier pages may still be queued, so a page of the backend can only
+    //  follow them once they are written
+    if(!resume || m_cache){
+        flush(std::chrono::milliseconds(5000));
+    }
+    try{
+        m_backend->scanRange(fromMs, toMs, cursor, count, res, next, nullptr);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to scan history by time: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HistoryStorage::Impl::exportRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+        RecordVec& res, std::vector<int64_t>& times, std::string& next){
+    if(cursor == "0"){
+        flush(std::chrono::milliseconds(5000));
+    }
+    res.clear();
+    times.clear();
+    try{
+        m_backend->scanRange(fromMs, toMs, cursor, count, res, next, &times);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to export history: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HistoryStorage::Impl::filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res){
+    if(attributes == 0u){
+        return false;
+    }
+    res.handles.clear();
+    res.persons = 0u;
+    if(m_cache){
+        Metrics& metrics = Metrics::getInstance();
+        if(m_cache->filter(attributes, fromMs, toMs, res)){
+            metrics.historyCacheHits.add();
+            return true;
+        }
+        metrics.historyCacheMisses.add();
+    }
+    flush(std::chrono::milliseconds(5000));
+    try{
+        m_backend->filter(attributes, fromMs, toMs, res);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to filter history: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HistoryStorage::Impl::fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+        RecordVec& res){
+    res.clear();
+    if(m_cache && offset < handles.size()){
+        Metrics& metrics = Metrics::getInstance();
+        if(m_cache->find(handles, offset, offset + std::min(count, handles.size() - offset), res)){
+            metrics.historyCacheHits.add();
+            return true;
+        }
+        metrics.historyCacheMisses.add();
+    }
+    try{
+        m_backend->fetch(handles, offset, count, res);
+    }
+    catch(const std::exception& e){
+        std::cerr << "[ ERROR ] Unable to fetch history records: " << e.what() << std::endl;
+        return false;
+    }
     return true;
 }
 
+std::string HistoryStorage::Impl::versionTag() const{
+    return std::to_string(m_startMs) + "-" + std::to_string(m_version.load());
+}
+
 HistoryStorage::~HistoryStorage(){
 
 }
@@ -58,20 +712,128 @@ HistoryStorage& HistoryStorage::getInstance(){
     return inst;
 }
 
+void HistoryStorage::configure(const Options& options){
+    storageOptions() = options;
+}
+
+bool HistoryStorage::parseOverflowPolicy(const std::string& name, OverflowPolicy& out){
+    if(name == "block"){
+        out = Block;
+        return true;
+    }
+    if(name == "drop"){
+        out = Drop;
+        return true;
+    }
+    if(name == "spill"){
+        out = Spill;
+        return true;
+    }
+    return false;
+}
+
+bool HistoryStorage::parseBackendType(const std::string& name, BackendType& out){
+    if(name == "redis"){
+        out = Redis;
+        return true;
+    }
+    if(name == "log"){
+        out = Log;
+        return true;
+    }
+    return false;
+}
+
+bool HistoryStorage::parseRecordFormat(const std::string& name, RecordFormat& out){
+    if(name == "json"){
+        out = Json;
+        return true;
+    }
+    if(name == "binary"){
+        out = Binary;
+        return true;
+    }
+    return false;
+}
+
+bool HistoryStorage::isCursor(const std::string& cursor){
+    const auto isNumber = [](const std::string& text){
+        return !text.empty() && text.size() <= 20u && text.find_first_not_of("0123456789") == std::string::npos;
+    };
+    if(isNumber(cursor)){
+        return true;
+    }
+    const std::size_t dash = cursor.find('-');
+    if(dash != std::string::npos){
+        return isNumber(cursor.substr(0, dash)) && isNumber(cursor.substr(dash + 1u));
+    }
+    std::istringstream in(cursor);
+    std::string pair;
+    while(std::getline(in, pair, '.')){
+        const std::size_t colon = pair.find(':');
+        if(colon == std::string::npos || !isNumber(pair.substr(0, colon)) || !isNumber(pair.substr(colon + 1u))){
+            return false;
+        }
+    }
+    return !cursor.empty() && cursor.back() != '.';
+}
+
 HistoryStorage::JobHandle HistoryStorage::generateHandle(){
     return m_impl->generateHandle();
 }
 
+std::string HistoryStorage::versionTag() const{
+    return m_impl->versionTag();
+}
+
 bool HistoryStorage::save(JobHandle handle, const std::string& json){
-    return m_impl->save(handle, json);
+    SISD_TRACE_SCOPE("HistoryStorage::save");
+    return m_impl->save(handle, json, nullptr);
+}
+
+bool HistoryStorage::save(JobHandle handle, const std::string& json, const ImageRecordVec& results){
+    SISD_TRACE_SCOPE("HistoryStorage::save");
+    return m_impl->save(handle, json, &results);
+}
+
+bool HistoryStorage::flush(std::chrono::milliseconds timeout){
+    return m_impl->flush(timeout);
 }
 
 bool HistoryStorage::getAll(std::unordered_map<std::string, std::string>& res){
     return m_impl->getAll(res);
 }
 
+bool HistoryStorage::scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next){
+    SISD_TRACE_SCOPE("HistoryStorage::scan");
+    return m_impl->scan(cursor, count, res, next);
+}
+
+bool HistoryStorage::scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+        RecordVec& res, std::string& next){
+    SISD_TRACE_SCOPE("HistoryStorage::scanRange");
+    return m_impl->scanRange(fromMs, toMs, cursor, count, res, next);
+}
+
+bool HistoryStorage::exportRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+        RecordVec& res, std::vector<int64_t>& times, std::string& next){
+    SISD_TRACE_SCOPE("HistoryStorage::exportRange");
+    return m_impl->exportRange(fromMs, toMs, cursor, count, res, times, next);
+}
+
+bool HistoryStorage::filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res){
+    SISD_TRACE_SCOPE("HistoryStorage::filter");
+    return m_impl->filter(attributes, fromMs, toMs, res);
+}
+
+bool HistoryStorage::fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+        RecordVec& res){
+    SISD_TRACE_SCOPE("HistoryStorage::fetch");
+    return m_impl->fetch(handles, offset, count, res);
+}
+
 HistoryStorage::HistoryStorage(){
-    m_impl = std::unique_ptr<Impl>(new Impl);
+    m_impl = std::unique_ptr<Impl>(new Impl(storageOptions()));
 }
 
-}
\ No newline at end of file
+}
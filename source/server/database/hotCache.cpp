@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include <server/database/hotCache.hpp>
+
+namespace SISD{
+
+namespace{
+
+/// bytes a record costs besides its body and attributes: the hash node, the order entry and allocations
+constexpr std::size_t itemOverhead = 96u;
+
+}
+
+HotCache::HotCache(std::size_t capacity, std::size_t maxBytes, std::chrono::milliseconds window, int64_t startMs):
+        m_capacity(capacity), m_maxBytes(maxBytes), m_window(window), m_bytes(0u), m_coveredFrom(startMs){
+
+}
+
+std::size_t HotCache::sizeOf(const Item& item) const{
+    return item.body.length() + 4u * item.persons.size() + itemOverhead;
+}
+
+void HotCache::add(HistoryStorage::JobHandle handle, int64_t timeMs, const std::string& body,
+        const std::vector<uint32_t>& persons){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    auto inserted = m_items.emplace(handle, Item{body, persons});
+    if(!inserted.second){
+        return;
+    }
+    m_bytes += sizeOf(inserted.first->second);
+    // save() takes the time before it adds the record, so concurrent ones may come slightly out of order
+    const Key key(timeMs, handle);
+    m_order.insert(std::upper_bound(m_order.begin(), m_order.end(), key), key);
+    evict(m_order.back().first);
+}
+
+void HotCache::remove(HistoryStorage::JobHandle handle){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    const auto it = m_items.find(handle);
+    if(it == m_items.end()){
+        return;
+    }
+    // the record was added last, so it is found close to the back
+    for(auto order = m_order.end(); order != m_order.begin();){
+        --order;
+        if(order->second == handle){
+            m_order.erase(order);
+            break;
+        }
+    }
+    m_bytes -= sizeOf(it->second);
+    m_items.erase(it);
+}
+
+void HotCache::evict(int64_t nowMs){
+    const int64_t oldest = m_window.count() > 0 ? nowMs - static_cast<int64_t>(m_window.count()) :
+            std::numeric_limits<int64_t>::min();
+    while(!m_order.empty() && (m_order.size() > m_capacity || m_bytes > m_maxBytes || m_order.front().first < oldest)){
+        evictOldest();
+    }
+}
+
+void HotCache::trim(std::size_t records){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    while(m_order.size() > records){
+        evictOldest();
+    }
+}
+
+void HotCache::evictOldest(){
+    // records saved at the same time as the evicted one may still be cached, but not all of them
+    m_coveredFrom = std::max(m_coveredFrom, m_order.front().first + 1);
+    const auto it = m_items.find(m_order.front().second);
+    m_bytes -= sizeOf(it->second);
+    m_items.erase(it);
+    m_order.pop_front();
+}
+
+int64_t HotCache::coveredFrom() const{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    return m_coveredFrom;
+}
+
+bool HotCache::range(int64_t fromMs, int64_t toMs, const Key* after, std::size_t count, RecordVec& res, Key& last,
+        bool& more) const{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    // a page continues after the key of the previous one, so it only needs the records from the time of that key
+    const bool resume = after && after->first >= fromMs;
+    if((resume ? after->first : fromMs) < m_coveredFrom){
+        return false;
+    }
+    auto it = resume ? std::upper_bound(m_order.begin(), m_order.end(), *after) :
+            std::lower_bound(m_order.begin(), m_order.end(), Key(fromMs, HistoryStorage::JobHandle(0u)));
+    for(std::size_t taken = 0u; it != m_order.end() && it->first <= toMs && taken < count; ++it, ++taken){
+        res.emplace_back(std::to_string(it->second), m_items.at(it->second).body);
+        last = *it;
+    }
+    more = it != m_order.end() && it->first <= toMs;
+    return true;
+}
+
+bool HotCache::filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res) const{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    if(fromMs < m_coveredFrom){
+        return false;
+    }
+    auto it = std::lower_bound(m_order.begin(), m_order.end(), std::make_pair(fromMs, HistoryStorage::JobHandle(0u)));
+    for(; it != m_order.end() && it->first <= toMs; ++it){
+        uint64_t persons = 0u;
+        for(uint32_t person : m_items.at(it->second).persons){
+            if((person & attributes) == attributes){
+                persons++;
+            }
+        }
+        if(persons > 0u){
+            res.handles.push_back(std::to_string(it->second));
+            res.persons += persons;
+        }
+    }
+    return true;
+}
+
+bool HotCache::find(const std::vector<std::string>& handles, std::size_t first, std::size_t last,
+        RecordVec& res) const{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    RecordVec found;
+    found.reserve(last - first);
+    for(std::size_t i = first; i < last; ++i){
+        const auto it = m_items.find(static_cast<HistoryStorage::JobHandle>(std::strtoull(handles[i].c_str(),
+                nullptr, 10)));
+        if(it == m_items.end()){
+            return false;
+        }
+        found.emplace_back(handles[i], it->second.body);
+    }
+    res.insert(res.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    return true;
+}
+
+void HotCache::usage(std::size_t& records, std::size_t& bytes) const{
+    std::lock_guard<std::mutex> lg(m_mutex);
+    records = m_items.size();
+    bytes = m_bytes;
+}
+
+}
@@ -0,0 +1,563 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+#include <server/database/logBackend.hpp>
+
+namespace SISD{
+
+namespace{
+
+const char segmentMagic[7] = {'S', 'I', 'S', 'D', 'L', 'O', 'G'};
+
+constexpr uint8_t segmentVersion = 1u;
+
+constexpr std::size_t segmentHeaderSize = 8u;
+
+/// length and checksum in front of every record
+constexpr std::size_t recordPrefixSize = 8u;
+
+/// handle, time and person count
+constexpr std::size_t recordFixedSize = 20u;
+
+/// records are indexed by 32 bit offsets into their segment
+constexpr std::size_t maxSegmentBytes = 0xffffffffu;
+
+void storeU32(char* p, uint32_t v){
+    for(int i = 0; i < 4; ++i){
+        p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+}
+
+void storeU64(char* p, uint64_t v){
+    for(int i = 0; i < 8; ++i){
+        p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    }
+}
+
+uint32_t loadU32(const char* p){
+    uint32_t v = 0u;
+    for(int i = 0; i < 4; ++i){
+        v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+uint64_t loadU64(const char* p){
+    uint64_t v = 0u;
+    for(int i = 0; i < 8; ++i){
+        v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+/// FNV-1a, enough to tell a record torn by a crash from a complete one
+uint32_t checksum(const char* data, std::size_t size){
+    uint32_t hash = 2166136261u;
+    for(std::size_t i = 0; i < size; ++i){
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+std::string segmentPath(const std::string& dir, std::size_t index){
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%06u.log", static_cast<unsigned>(index));
+    return (boost::filesystem::path(dir) / name).string();
+}
+
+std::string headPath(const std::string& dir){
+    return (boost::filesystem::path(dir) / "head").string();
+}
+
+std::runtime_error systemError(const std::string& what, const std::string& path){
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+}
+
+/// a mapped segment file. Only the writer changes used and synced
+struct LogBackend::Segment{
+    std::string path;
+    int fd = -1;
+    char* data = nullptr;
+    std::size_t capacity = 0u;
+    std::size_t used = 0u;
+    std::size_t synced = 0u;
+
+    ~Segment(){
+        if(data){
+            munmap(data, capacity);
+        }
+        if(fd >= 0){
+            close(fd);
+        }
+    }
+};
+
+LogBackend::LogBackend(const HistoryStorage::Options& options): m_dir(options.logDir),
+        m_segmentBytes(std::max<std::size_t>(options.logSegmentBytes, 4096u)), m_syncInterval(options.logSyncInterval),
+        m_lastSync(std::chrono::steady_clock::now()), m_unsynced(0u), m_firstSegment(0u), m_dropped(0u),
+        m_entryBase(0u), m_persons(0u), m_bytes(0u), m_headSegment(0u), m_headOffset(segmentHeaderSize),
+        m_nextHandle(0u){
+    if(m_segmentBytes > maxSegmentBytes){
+        throw std::runtime_error("History log segments must be smaller than 4 GB");
+    }
+    boost::filesystem::create_directories(m_dir);
+    std::ifstream head(headPath(m_dir));
+    if(head && !(head >> m_headSegment >> m_headOffset >> m_nextHandle)){
+        throw std::runtime_error(headPath(m_dir) + " is damaged");
+    }
+    const std::size_t headSegment = m_headSegment;
+    // segments before the head are left over if the server stopped before deleting them
+    for(std::size_t i = headSegment; i > 0u && boost::filesystem::exists(segmentPath(m_dir, i - 1u)); --i){
+        boost::filesystem::remove(segmentPath(m_dir, i - 1u));
+    }
+    m_segments.resize(headSegment);
+    m_firstSegment = headSegment;
+    m_dropped = headSegment;
+    for(std::size_t i = headSegment; boost::filesystem::exists(segmentPath(m_dir, i)); ++i){
+        openSegment(segmentPath(m_dir, i), 0u);
+        recover(static_cast<uint32_t>(i), i == headSegment ? m_headOffset : segmentHeaderSize);
+    }
+    if(m_segments.size() == headSegment){
+        openSegment(segmentPath(m_dir, headSegment), m_segmentBytes);
+    }
+    m_unsynced = m_segments.size() - 1u;
+    std::cout << "[ INFO ] History log " << m_dir << " holds " << m_entries.size() << " records in "
+            << m_segments.size() - headSegment << " segments" << std::endl;
+}
+
+LogBackend::~LogBackend(){
+    if(m_syncInterval.count() >= 0){
+        try{
+            sync();
+        }
+        catch(const std::exception& e){
+            std::cerr << "[ ERROR ] " << e.what() << std::endl;
+        }
+    }
+}
+
+const char* LogBackend::name() const{
+    return "log";
+}
+
+HistoryStorage::JobHandle LogBackend::reserveHandles(uint64_t count){
+    HistoryStorage::JobHandle ret;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        ret = m_nextHandle;
+        m_nextHandle += count;
+    }
+    // the end of the block is on disk before any of its handles is handed out, so that a restart continues
+    //  after it even if none of them was stored, e.g. for a job that failed or was still queued
+    writeHead();
+    return ret;
+}
+
+void LogBackend::openSegment(const std::string& path, std::size_t capacity){
+    std::unique_ptr<Segment> segment(new Segment);
+    segment->path = path;
+    segment->fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(segment->fd < 0){
+        throw systemError("Unable to open", path);
+    }
+    struct stat st;
+    if(fstat(segment->fd, &st) != 0){
+        throw systemError("Unable to stat", path);
+    }
+    const bool created = st.st_size == 0;
+    if(created){
+        // an empty file is also left by a crash before its blocks were allocated. It is opened without a
+        //  capacity at startup and started over as a new segment
+        capacity = std::max(capacity, m_segmentBytes);
+        // the blocks are allocated up front, so that a full disk fails the write here instead of raising SIGBUS
+        //  when a record is copied to a page of the mapping without a block behind it
+        const int error = posix_fallocate(segment->fd, 0, static_cast<off_t>(capacity));
+        if(error != 0){
+            ::unlink(path.c_str());
+            errno = error;
+            throw systemError("Unable to allocate", path);
+        }
+        segment->capacity = capacity;
+    }
+    else if(static_cast<std::size_t>(st.st_size) < segmentHeaderSize){
+        throw std::runtime_error(path + " is not a history log segment");
+    }
+    else{
+        segment->capacity = static_cast<std::size_t>(st.st_size);
+    }
+
+    void* data = mmap(nullptr, segment->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    if(data == MAP_FAILED){
+        throw systemError("Unable to map", path);
+    }
+    segment->data = static_cast<char*>(data);
+
+    if(created){
+        std::memcpy(segment->data, segmentMagic, sizeof(segmentMagic));
+        segment->data[sizeof(segmentMagic)] = static_cast<char>(segmentVersion);
+        segment->used = segmentHeaderSize;
+        // the new file has to be in the directory for its records to survive a crash
+        int dirFd = ::open(m_dir.c_str(), O_RDONLY);
+        if(dirFd >= 0){
+            fsync(dirFd);
+            close(dirFd);
+        }
+    }
+    else if(std::memcmp(segment->data, segmentMagic, sizeof(segmentMagic)) != 0 ||
+            static_cast<uint8_t>(segment->data[sizeof(segmentMagic)]) != segmentVersion){
+        throw std::runtime_error(path + " is not a history log segment of a supported version");
+    }
+    m_segments.push_back(std::move(segment));
+}
+
+void LogBackend::recover(uint32_t segmentIndex, std::size_t offset){
+    Segment& segment = *m_segments[segmentIndex];
+    std::size_t pos = std::max(offset, segmentHeaderSize);
+    std::vector<uint32_t> persons;
+    while(pos + recordPrefixSize <= segment.capacity){
+        const uint32_t length = loadU32(segment.data + pos);
+        if(length == 0u){
+            break;
+        }
+        const char* record = segment.data + pos + recordPrefixSize;
+        bool valid = length >= recordFixedSize && length <= segment.capacity - pos - recordPrefixSize &&
+                checksum(record, length) == loadU32(segment.data + pos + 4);
+        const uint32_t personCount = valid ? loadU32(record + 16) : 0u;
+        valid = valid && (length - recordFixedSize) / 4u >= personCount;
+        if(!valid){
+            std::cerr << "[ WARNING ] History log " << segment.path << " is damaged at offset " << pos
+                    << ", the rest of the segment is discarded" << std::endl;
+            // clear the damaged record so that it is not mistaken for one once the space is reused
+            std::memset(segment.data + pos, 0, std::min<std::size_t>(recordPrefixSize + length,
+                    segment.capacity - pos));
+            break;
+        }
+
+        persons.resize(personCount);
+        for(uint32_t p = 0; p < personCount; ++p){
+            persons[p] = loadU32(record + recordFixedSize + 4u * p);
+        }
+        index(segmentIndex, static_cast<uint32_t>(pos), length - recordFixedSize - 4u * personCount,
+                static_cast<HistoryStorage::JobHandle>(loadU64(record)), static_cast<int64_t>(loadU64(record + 8)),
+                persons);
+        pos += recordPrefixSize + length;
+    }
+    segment.used = pos;
+    segment.synced = pos;
+}
+
+void LogBackend::index(uint32_t segment, uint32_t offset, uint32_t bodyLength, HistoryStorage::JobHandle handle,
+        int64_t timeMs, const std::vector<uint32_t>& persons){
+    const std::size_t position = m_entryBase + m_entries.size();
+    const uint32_t bodyOffset = offset + static_cast<uint32_t>(recordPrefixSize + recordFixedSize +
+            4u * persons.size());
+    m_entries.push_back(Entry{handle, timeMs, segment, offset, bodyOffset, bodyLength, m_persons});
+    m_byHandle[handle] = position;
+    m_bytes += bodyLength;
+
+    // records come in the order they were saved, apart from spilled ones, so this is usually an append
+    const auto time = std::make_tuple(timeMs, handle, position);
+    m_byTime.insert(std::upper_bound(m_byTime.begin(), m_byTime.end(), time), time);
+
+    for(std::size_t p = 0; p < persons.size(); ++p){
+        for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+            if(persons[p] & (1u << a)){
+                m_postings[a].push_back(m_persons + p);
+            }
+        }
+    }
+    m_persons += persons.size();
+    m_nextHandle = std::max<HistoryStorage::JobHandle>(m_nextHandle, handle + 1u);
+}
+
+void LogBackend::append(const Record& record){
+    const std::size_t length = recordFixedSize + 4u * record.persons.size() + record.body.length();
+    if(segmentHeaderSize + recordPrefixSize + length > maxSegmentBytes){
+        throw std::runtime_error("History record too large for the log");
+    }
+    const std::size_t size = recordPrefixSize + length;
+    if(m_segments.back()->used + size > m_segments.back()->capacity){
+        openSegment(segmentPath(m_dir, m_segments.size()), std::max(m_segmentBytes, segmentHeaderSize + size));
+    }
+    Segment& segment = *m_segments.back();
+
+    char* prefix = segment.data + segment.used;
+    char* out = prefix + recordPrefixSize;
+    storeU64(out, record.handle);
+    storeU64(out + 8, static_cast<uint64_t>(record.timeMs));
+    storeU32(out + 16, static_cast<uint32_t>(record.persons.size()));
+    for(std::size_t p = 0; p < record.persons.size(); ++p){
+        storeU32(out + recordFixedSize + 4u * p, record.persons[p]);
+    }
+    std::memcpy(out + recordFixedSize + 4u * record.persons.size(), record.body.data(), record.body.length());
+    storeU32(prefix + 4, checksum(out, length));
+    storeU32(prefix, static_cast<uint32_t>(length));
+    const std::size_t offset = segment.used;
+    segment.used += size;
+
+    index(static_cast<uint32_t>(m_segments.size() - 1u), static_cast<uint32_t>(offset),
+            static_cast<uint32_t>(record.body.length()), record.handle, record.timeMs, record.persons);
+}
+
+void LogBackend::sync(){
+    static const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    for(std::size_t i = m_unsynced; i < m_segments.size(); ++i){
+        Segment& segment = *m_segments[i];
+        if(segment.used > segment.synced){
+            const std::size_t start = segment.synced / pageSize * pageSize;
+            if(msync(segment.data + start, segment.used - start, MS_SYNC) != 0){
+                throw systemError("Unable to sync", segment.path);
+            }
+            segment.synced = segment.used;
+        }
+    }
+    m_unsynced = m_segments.size() - 1u;
+}
+
+void LogBackend::write(std::vector<Record>& batch){
+    std::vector<std::unique_ptr<Segment>> dropped;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        // segments before the head only hold removed records. The writer is the only one using m_segments
+        //  without the lock, so it takes them out itself
+        for(; m_dropped < m_firstSegment; ++m_dropped){
+            if(m_segments[m_dropped]){
+                dropped.push_back(std::move(m_segments[m_dropped]));
+            }
+        }
+        m_unsynced = std::max(m_unsynced, m_dropped);
+        for(const auto& record : batch){
+            append(record);
+        }
+    }
+    for(auto& segment : dropped){
+        const std::string path = segment->path;
+        segment.reset();
+        if(::unlink(path.c_str()) != 0){
+            std::cerr << "[ WARNING ] Unable to delete " << path << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    // group commit: one sync covers every record of the batch, and the batches of a whole interval. Only
+    //  the writer appends, so the segments can be synced without holding up readers
+    idle();
+}
+
+void LogBackend::idle(){
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(m_syncInterval.count() >= 0 && now - m_lastSync >= m_syncInterval){
+        sync();
+        m_lastSync = now;
+    }
+}
+
+std::string LogBackend::body(const Entry& entry) const{
+    return std::string(m_segments[entry.segment]->data + entry.bodyOffset, entry.bodyLength);
+}
+
+void LogBackend::scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next){
+    // the cursor is the position in the log, so a scan reads the segments sequentially
+    //  and removed records are skipped
+    const uint64_t start = position(cursor);
+    std::lock_guard<std::mutex> lg(m_mutex);
+    next = "0";
+    const uint64_t end = m_entryBase + m_entries.size();
+    const uint64_t first = std::max<uint64_t>(start, m_entryBase);
+    const uint64_t last = std::min<uint64_t>(first + count, end);
+    for(uint64_t i = first; i < last; ++i){
+        const Entry& entry = m_entries[i - m_entryBase];
+        res.emplace_back(std::to_string(entry.handle), body(entry));
+    }
+    if(last < end){
+        next = std::to_string(last);
+    }
+}
+
+void LogBackend::scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+        RecordVec& res, std::string& next, std::vector<int64_t>* times){
+    // the cursor is the key of the last record returned, so records removed by retention meanwhile do not
+    //  shift the pages
+    int64_t afterMs = 0;
+    HistoryStorage::JobHandle afterHandle = 0u;
+    const bool resume = rangeKey(cursor, afterMs, afterHandle) && afterMs >= fromMs;
+    std::lock_guard<std::mutex> lg(m_mutex);
+    next = "0";
+    auto it = resume ? std::upper_bound(m_byTime.begin(), m_byTime.end(), std::make_tuple(afterMs, afterHandle,
+            std::numeric_limits<std::size_t>::max())) : std::lower_bound(m_byTime.begin(), m_byTime.end(),
+            std::make_tuple(fromMs, HistoryStorage::JobHandle(0u), std::size_t(0u)));
+    const Entry* last = nullptr;
+    for(std::size_t taken = 0u; it != m_byTime.end() && std::get<0>(*it) <= toMs && taken < count; ++it, ++taken){
+        const Entry& entry = m_entries[std::get<2>(*it) - m_entryBase];
+        res.emplace_back(std::to_string(entry.handle), body(entry));
+        if(times){
+            times->push_back(entry.timeMs);
+        }
+        last = &entry;
+    }
+    if(it != m_byTime.end() && std::get<0>(*it) <= toMs){
+        next = last ? rangeCursor(last->timeMs, last->handle) : cursor;
+    }
+}
+
+void LogBackend::filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    std::vector<const std::vector<uint64_t>*> postings;
+    for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+        if(attributes & (1u << a)){
+            postings.push_back(&m_postings[a]);
+        }
+    }
+    if(postings.empty()){
+        return;
+    }
+    // intersect the shortest lists first so that the intermediate results stay small
+    std::sort(postings.begin(), postings.end(), [](const std::vector<uint64_t>* a, const std::vector<uint64_t>* b){
+        return a->size() < b->size();
+    });
+    std::vector<uint64_t> persons(*postings[0]);
+    std::vector<uint64_t> intersection;
+    for(std::size_t i = 1; i < postings.size() && !persons.empty(); ++i){
+        intersection.clear();
+        std::set_intersection(persons.begin(), persons.end(), postings[i]->begin(), postings[i]->end(),
+                std::back_inserter(intersection));
+        persons.swap(intersection);
+    }
+
+    // persons and records are both numbered in the order of the log, so the records come out in that order
+    std::size_t last = m_entries.size();
+    for(uint64_t person : persons){
+        const auto entry = std::upper_bound(m_entries.begin(), m_entries.end(), person,
+                [](uint64_t id, const Entry& e){
+                    return id < e.firstPerson;
+                }) - 1;
+        if(entry->timeMs < fromMs || entry->timeMs > toMs){
+            continue;
+        }
+        res.persons++;
+        const std::size_t position = static_cast<std::size_t>(entry - m_entries.begin());
+        if(position != last){
+            res.handles.push_back(std::to_string(entry->handle));
+            last = position;
+        }
+    }
+}
+
+void LogBackend::fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+        RecordVec& res){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    const std::size_t last = std::min(handles.size(), offset + std::min(count, handles.size()));
+    for(std::size_t i = offset; i < last; ++i){
+        const auto it = m_byHandle.find(static_cast<HistoryStorage::JobHandle>(std::strtoull(handles[i].c_str(),
+                nullptr, 10)));
+        if(it != m_byHandle.end()){
+            res.emplace_back(handles[i], body(m_entries[it->second - m_entryBase]));
+        }
+    }
+}
+
+void LogBackend::usage(uint64_t& records, uint64_t& bytes){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    records = m_entries.size();
+    bytes = m_bytes;
+}
+
+std::size_t LogBackend::removeOldest(std::size_t count, int64_t beforeMs, uint64_t& bytes){
+    bytes = 0u;
+    std::size_t removed = 0u;
+    std::size_t headSegment;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        // records are removed in the order of the log, which is the order they were saved apart from spilled ones
+        while(removed < count && !m_entries.empty() && m_entries.front().timeMs < beforeMs){
+            const Entry& entry = m_entries.front();
+            const auto it = m_byHandle.find(entry.handle);
+            if(it != m_byHandle.end() && it->second == m_entryBase){
+                m_byHandle.erase(it);
+            }
+            bytes += entry.bodyLength;
+            m_entries.pop_front();
+            m_entryBase++;
+            removed++;
+        }
+        if(removed == 0u){
+            return 0u;
+        }
+        m_bytes -= bytes;
+
+        // the time and attribute indexes drop what points to removed records. Each step of the sweeper pays
+        //  for one pass over them, which keeps readers from having to skip removed records
+        const std::size_t base = m_entryBase;
+        m_byTime.erase(std::remove_if(m_byTime.begin(), m_byTime.end(),
+                [base](const std::tuple<int64_t, HistoryStorage::JobHandle, std::size_t>& time){
+                    return std::get<2>(time) < base;
+                }), m_byTime.end());
+        const uint64_t firstPerson = m_entries.empty() ? m_persons : m_entries.front().firstPerson;
+        for(auto& postings : m_postings){
+            postings.erase(postings.begin(), std::lower_bound(postings.begin(), postings.end(), firstPerson));
+        }
+
+        if(m_entries.empty()){
+            m_headSegment = m_segments.size() - 1u;
+            m_headOffset = m_segments.back()->used;
+        }
+        else{
+            m_headSegment = m_entries.front().segment;
+            m_headOffset = m_entries.front().offset;
+        }
+        headSegment = m_headSegment;
+    }
+
+    // the segments before the head are only deleted once the head is on disk
+    writeHead();
+    std::lock_guard<std::mutex> lg(m_mutex);
+    m_firstSegment = std::max<std::size_t>(m_firstSegment, headSegment);
+    return removed;
+}
+
+void LogBackend::writeHead(){
+    // the sweeper and handle reservations both write the head. Whoever writes last takes the latest values of
+    //  both under the lock, so that neither the head nor the next handle goes back on disk
+    std::lock_guard<std::mutex> headLock(m_headMutex);
+    std::string text;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        text = std::to_string(m_headSegment) + " " + std::to_string(m_headOffset) + " " +
+                std::to_string(m_nextHandle) + "\n";
+    }
+    const std::string path = headPath(m_dir);
+    const std::string temporary = path + ".tmp";
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        throw systemError("Unable to open", temporary);
+    }
+    const bool written = ::write(fd, text.data(), text.length()) == static_cast<ssize_t>(text.length()) &&
+            fsync(fd) == 0;
+    close(fd);
+    if(!written){
+        throw systemError("Unable to write", temporary);
+    }
+    if(std::rename(temporary.c_str(), path.c_str()) != 0){
+        throw systemError("Unable to replace", path);
+    }
+    int dirFd = ::open(m_dir.c_str(), O_RDONLY);
+    if(dirFd >= 0){
+        fsync(dirFd);
+        close(dirFd);
+    }
+}
+
+}
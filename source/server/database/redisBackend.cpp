@@ -0,0 +1,697 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <sw/redis++/redis++.h>
+
+#include <server/database/redisBackend.hpp>
+
+namespace SISD{
+
+namespace{
+
+/// prefix of the keys of earlier versions, which stored the whole history unsharded
+const std::string legacyPrefix = "history";
+
+/// the end of the handles reserved so far
+const std::string handleKey = "history:handle";
+
+sw::redis::BoundedInterval<double> timeInterval(int64_t fromMs, int64_t toMs){
+    return sw::redis::BoundedInterval<double>(static_cast<double>(fromMs), static_cast<double>(toMs),
+            sw::redis::BoundType::CLOSED);
+}
+
+/// a pipeline for the keys of the slot of a key. A plain Redis runs any key on any connection
+sw::redis::Pipeline slotPipeline(sw::redis::Redis& redis, const std::string&){
+    return redis.pipeline();
+}
+
+sw::redis::Pipeline slotPipeline(sw::redis::RedisCluster& cluster, const std::string& key){
+    return cluster.pipeline(key);
+}
+
+/// where the scan of every shard not done with yet stands
+using Positions = std::vector<std::pair<std::size_t, uint64_t>>;
+
+/**
+* @brief read a cursor, which is "0" to start every shard, the position of the only shard, or
+*       "<shard>:<position>" pairs separated by dots
+*
+* @param cursor the cursor
+* @param shards the number of shards
+* @return the positions. Throws std::invalid_argument if the cursor does not match the shards
+*
+*/
+Positions parseCursor(const std::string& cursor, std::size_t shards){
+    if(!HistoryStorage::isCursor(cursor)){
+        throw std::invalid_argument("Invalid history cursor " + cursor);
+    }
+    Positions ret;
+    if(cursor.find(':') == std::string::npos){
+        const uint64_t position = std::strtoull(cursor.c_str(), nullptr, 10);
+        if(position != 0u && shards != 1u){
+            throw std::invalid_argument("The history cursor " + cursor + " is not one of a sharded history");
+        }
+        for(std::size_t s = 0; s < shards; ++s){
+            ret.emplace_back(s, position);
+        }
+        return ret;
+    }
+    std::istringstream in(cursor);
+    std::string pair;
+    while(std::getline(in, pair, '.')){
+        const std::size_t shard = std::strtoull(pair.c_str(), nullptr, 10);
+        if(shard >= shards || (!ret.empty() && shard <= ret.back().first)){
+            throw std::invalid_argument("The history cursor " + cursor + " does not match the shards");
+        }
+        ret.emplace_back(shard, std::strtoull(pair.c_str() + pair.find(':') + 1u, nullptr, 10));
+    }
+    return ret;
+}
+
+/// the cursor of the given positions, see parseCursor()
+std::string formatCursor(const Positions& positions, std::size_t shards){
+    if(positions.empty()){
+        return "0";
+    }
+    if(shards == 1u){
+        return std::to_string(positions[0].second);
+    }
+    std::string ret;
+    for(const auto& position : positions){
+        if(!ret.empty()){
+            ret += '.';
+        }
+        ret += std::to_string(position.first) + ":" + std::to_string(position.second);
+    }
+    return ret;
+}
+
+/// records of a shard written in one round-trip, as hash fields, time index entries and attribute index entries
+struct RecordBatch{
+    std::vector<std::pair<std::string, std::string>> fields;
+    std::vector<std::pair<std::string, double>> times;
+    std::vector<std::string> postings[ResultCodec::attributeCount];
+    long long bytes = 0;
+
+    void add(StorageBackend::Record& record){
+        const std::string handle = std::to_string(record.handle);
+        bytes += static_cast<long long>(record.body.length());
+        fields.emplace_back(handle, std::move(record.body));
+        times.emplace_back(handle, static_cast<double>(record.timeMs));
+        for(std::size_t p = 0; p < record.persons.size(); ++p){
+            for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+                if(record.persons[p] & (1u << a)){
+                    postings[a].push_back(handle + "." + std::to_string(p));
+                }
+            }
+        }
+    }
+};
+
+}
+
+/**
+* @brief runs the per-shard parts of a read or write in parallel on threads started with the backend, so that
+*       no request pays for starting threads. The calling thread takes part, and a part is run by whichever
+*       thread claims it first, so concurrent callers share the threads and never wait for idle ones
+*
+* @param
+* @return
+*
+*/
+class ShardPool{
+public:
+    explicit ShardPool(std::size_t threads);
+
+    ~ShardPool();
+
+    /**
+    * @brief run task(i) for every i below count in parallel, and wait for all of them
+    *
+    * @param count the number of tasks
+    * @param task the function to run
+    * @return void. The first exception thrown by a task is rethrown once all are done
+    *
+    */
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+    /// the tasks of one run() call
+    struct Group{
+        const std::function<void(std::size_t)>* task;
+        std::size_t count;
+        std::atomic<std::size_t> next;      // the first task not claimed yet
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::size_t done;
+        std::exception_ptr error;
+    };
+
+    /// claim and run tasks of a group until all are claimed
+    static void work(Group& group);
+
+    void workerLoop();
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<std::shared_ptr<Group>> m_groups;    // with tasks left to claim, oldest first
+    bool m_stop;
+    std::vector<std::thread> m_threads;
+};
+
+ShardPool::ShardPool(std::size_t threads): m_stop(false){
+    for(std::size_t i = 0; i < threads; ++i){
+        m_threads.emplace_back(&ShardPool::workerLoop, this);
+    }
+}
+
+ShardPool::~ShardPool(){
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    for(auto& thread : m_threads){
+        thread.join();
+    }
+}
+
+void ShardPool::run(std::size_t count, const std::function<void(std::size_t)>& task){
+    if(count == 0u){
+        return;
+    }
+    const std::shared_ptr<Group> group = std::make_shared<Group>();
+    group->task = &task;
+    group->count = count;
+    group->next = 0u;
+    group->done = 0u;
+    if(count > 1u && !m_threads.empty()){
+        {
+            std::lock_guard<std::mutex> lg(m_mutex);
+            m_groups.push_back(group);
+        }
+        m_wakeup.notify_all();
+    }
+    work(*group);
+    {
+        std::unique_lock<std::mutex> lk(group->mutex);
+        group->finished.wait(lk, [&group](){
+            return group->done == group->count;
+        });
+    }
+    {
+        // every task is claimed, a worker that still finds the group only drops it
+        std::lock_guard<std::mutex> lg(m_mutex);
+        const auto it = std::find(m_groups.begin(), m_groups.end(), group);
+        if(it != m_groups.end()){
+            m_groups.erase(it);
+        }
+    }
+    if(group->error){
+        std::rethrow_exception(group->error);
+    }
+}
+
+void ShardPool::work(Group& group){
+    for(std::size_t i = group.next.fetch_add(1u); i < group.count; i = group.next.fetch_add(1u)){
+        std::exception_ptr error;
+        try{
+            (*group.task)(i);
+        }
+        catch(...){
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lg(group.mutex);
+        if(error && !group.error){
+            group.error = error;
+        }
+        if(++group.done == group.count){
+            group.finished.notify_all();
+        }
+    }
+}
+
+void ShardPool::workerLoop(){
+    while(true){
+        std::shared_ptr<Group> group;
+        {
+            std::unique_lock<std::mutex> lk(m_mutex);
+            m_wakeup.wait(lk, [this](){
+                return m_stop || !m_groups.empty();
+            });
+            if(m_stop){
+                return;
+            }
+            group = m_groups.front();
+            if(group->next.load() >= group->count){
+                m_groups.pop_front();
+                continue;
+            }
+        }
+        work(*group);
+    }
+}
+
+template<class Client>
+RedisBackend<Client>::RedisBackend(const HistoryStorage::Options& options): m_handleKeyChecked(false){
+    sw::redis::ConnectionOptions connection(options.uri);
+    connection.connect_timeout = options.redisConnectTimeout;
+    connection.socket_timeout = options.redisSocketTimeout;
+    connection.keep_alive = options.redisKeepAlive;
+    sw::redis::ConnectionPoolOptions pool;
+    pool.size = std::max<std::size_t>(options.redisPoolSize, 1u);
+    pool.wait_timeout = options.redisPoolWait;
+    m_ctxP = std::unique_ptr<Client>(new Client(connection, pool));
+
+    const bool cluster = std::is_same<Client, sw::redis::RedisCluster>::value;
+    const std::size_t shards = std::max<std::size_t>(options.redisShards, 1u);
+    for(std::size_t s = 0; s < shards; ++s){
+        const std::string prefix = (shards == 1u && !cluster) ? legacyPrefix : "history:{" + std::to_string(s) + "}";
+        Shard shard;
+        shard.records = prefix;
+        shard.times = prefix + ":time";
+        shard.bytes = prefix + ":bytes";
+        for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+            shard.attributes.push_back(prefix + ":attr:" + std::to_string(a));
+        }
+        m_shards.push_back(std::move(shard));
+    }
+    // a pipeline only reaches the node of one slot on a cluster, on a plain Redis it takes every shard
+    m_writePipes.resize(cluster ? shards : 1u);
+    m_sweepPipes.resize(m_writePipes.size());
+    // the calling thread runs one shard itself
+    m_pool = std::unique_ptr<ShardPool>(new ShardPool(shards - 1u));
+}
+
+template<class Client>
+RedisBackend<Client>::~RedisBackend(){
+
+}
+
+template<class Client>
+const char* RedisBackend<Client>::name() const{
+    return std::is_same<Client, sw::redis::RedisCluster>::value ? "redis cluster" : "redis";
+}
+
+template<class Client>
+std::size_t RedisBackend<Client>::shardOf(HistoryStorage::JobHandle handle) const{
+    return static_cast<std::size_t>(handle % m_shards.size());
+}
+
+template<class Client>
+HistoryStorage::JobHandle RedisBackend<Client>::reserveHandles(uint64_t count){
+    if(!m_handleKeyChecked){
+        // earlier versions started every run at handle 0 and kept no counter, so the records they stored
+        //  have the handles below the size of the hash
+        if(m_shards[0].records == legacyPrefix){
+            m_ctxP->setnx(handleKey, std::to_string(m_ctxP->hlen(legacyPrefix)));
+        }
+        m_handleKeyChecked = true;
+    }
+    const long long end = m_ctxP->incrby(handleKey, static_cast<long long>(count));
+    return static_cast<HistoryStorage::JobHandle>(end) - count;
+}
+
+template<class Client>
+template<class Queue>
+void RedisBackend<Client>::pipelined(std::vector<std::unique_ptr<sw::redis::Pipeline>>& pipes,
+        const std::vector<bool>& shards, const Queue& queue){
+    // pipeline p runs the commands of the shards p, p + pipelines, ...
+    const std::size_t pipelines = pipes.size();
+    std::vector<std::size_t> used;
+    for(std::size_t p = 0; p < pipelines; ++p){
+        for(std::size_t s = p; s < m_shards.size(); s += pipelines){
+            if(shards[s]){
+                used.push_back(p);
+                break;
+            }
+        }
+    }
+    m_pool->run(used.size(), [&](std::size_t i){
+        std::unique_ptr<sw::redis::Pipeline>& pipe = pipes[used[i]];
+        try{
+            // a pipeline keeps its own connection, which is replaced after an error
+            if(!pipe){
+                pipe = std::unique_ptr<sw::redis::Pipeline>(new sw::redis::Pipeline(
+                        slotPipeline(*m_ctxP, m_shards[used[i]].records)));
+            }
+            for(std::size_t s = used[i]; s < m_shards.size(); s += pipelines){
+                if(shards[s]){
+                    queue(*pipe, s);
+                }
+            }
+            pipe->exec();
+        }
+        catch(...){
+            pipe.reset();
+            throw;
+        }
+    });
+}
+
+template<class Client>
+void RedisBackend<Client>::write(std::vector<Record>& batch){
+    std::vector<RecordBatch> commands(m_shards.size());
+    std::vector<bool> shards(m_shards.size(), false);
+    for(auto& record : batch){
+        const std::size_t s = shardOf(record.handle);
+        commands[s].add(record);
+        shards[s] = true;
+    }
+    pipelined(m_writePipes, shards, [&](sw::redis::Pipeline& pipe, std::size_t s){
+        RecordBatch& shard = commands[s];
+        pipe.hset(m_shards[s].records, shard.fields.begin(), shard.fields.end())
+                .zadd(m_shards[s].times, shard.times.begin(), shard.times.end())
+                .incrby(m_shards[s].bytes, shard.bytes);
+        for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+            if(!shard.postings[a].empty()){
+                pipe.sadd(m_shards[s].attributes[a], shard.postings[a].begin(), shard.postings[a].end());
+            }
+        }
+    });
+}
+
+template<class Client>
+void RedisBackend<Client>::scan(const std::string& cursor, std::size_t count, RecordVec& res, std::string& next){
+    // every shard not done yet contributes its share of the page
+    const Positions positions = parseCursor(cursor, m_shards.size());
+    const std::size_t share = std::max<std::size_t>((count + positions.size() - 1u) / positions.size(), 1u);
+    std::vector<RecordVec> pages(positions.size());
+    std::vector<long long> nexts(positions.size());
+    m_pool->run(positions.size(), [&](std::size_t i){
+        nexts[i] = m_ctxP->hscan(m_shards[positions[i].first].records, static_cast<long long>(positions[i].second),
+                static_cast<long long>(share), std::back_inserter(pages[i]));
+    });
+    Positions rest;
+    for(std::size_t i = 0; i < positions.size(); ++i){
+        res.insert(res.end(), std::make_move_iterator(pages[i].begin()), std::make_move_iterator(pages[i].end()));
+        if(nexts[i] != 0){
+            rest.emplace_back(positions[i].first, static_cast<uint64_t>(nexts[i]));
+        }
+    }
+    next = formatCursor(rest, m_shards.size());
+}
+
+template<class Client>
+void RedisBackend<Client>::scanRange(int64_t fromMs, int64_t toMs, const std::string& cursor, std::size_t count,
+        RecordVec& res, std::string& next, std::vector<int64_t>* times){
+    // the cursor is the key of the last record returned, time and handle, and every shard continues after
+    //  it. Records removed by retention meanwhile do not shift the pages, as they would with offsets
+    int64_t afterMs = 0;
+    HistoryStorage::JobHandle afterHandle = 0u;
+    const bool resume = rangeKey(cursor, afterMs, afterHandle) && afterMs >= fromMs;
+    const std::string afterMember = std::to_string(afterHandle);
+    const auto isAfter = [&](const std::pair<std::string, double>& entry){
+        return !resume || entry.second > static_cast<double>(afterMs) ||
+                (entry.second == static_cast<double>(afterMs) && entry.first > afterMember);
+    };
+    std::vector<std::vector<std::pair<std::string, double>>> ranges(m_shards.size());
+    std::vector<char> more(m_shards.size(), 0);
+    m_pool->run(m_shards.size(), [&](std::size_t s){
+        // records saved in the millisecond of the key come first, the ones up to its handle were returned.
+        //  Their number is rarely more than a page, so this is usually a single query
+        sw::redis::LimitOptions limit;
+        limit.offset = 0;
+        limit.count = static_cast<long long>(count);
+        while(true){
+            std::vector<std::pair<std::string, double>> page;
+            m_ctxP->zrangebyscore(m_shards[s].times, timeInterval(resume ? afterMs : fromMs, toMs), limit,
+                    std::back_inserter(page));
+            for(auto& entry : page){
+                if(isAfter(entry)){
+                    ranges[s].push_back(std::move(entry));
+                }
+            }
+            more[s] = page.size() == count;
+            if(!more[s] || ranges[s].size() >= count){
+                break;
+            }
+            limit.offset += limit.count;
+        }
+    });
+
+    // the ranges are merged in the order Redis sorts each of them, by time and then by handle as a string,
+    //  so the records a page takes from a shard are always the first of its range
+    using Entry = std::pair<const std::pair<std::string, double>*, std::size_t>;     // entry and its range
+    std::vector<Entry> merged;
+    for(std::size_t i = 0; i < ranges.size(); ++i){
+        for(const auto& entry : ranges[i]){
+            merged.emplace_back(&entry, i);
+        }
+    }
+    const std::size_t taken = std::min(count, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + taken, merged.end(), [](const Entry& a, const Entry& b){
+        if(a.first->second != b.first->second){
+            return a.first->second < b.first->second;
+        }
+        return a.first->first < b.first->first;
+    });
+    std::vector<std::string> handles;
+    handles.reserve(taken);
+    for(std::size_t k = 0; k < taken; ++k){
+        handles.push_back(merged[k].first->first);
+    }
+
+    // the range goes on if a page was left over, or a shard may have records after the ones it returned
+    next = "0";
+    if(taken < merged.size() || std::find(more.begin(), more.end(), 1) != more.end()){
+        next = taken == 0u ? cursor : rangeCursor(static_cast<int64_t>(merged[taken - 1u].first->second),
+                std::strtoull(merged[taken - 1u].first->first.c_str(), nullptr, 10));
+    }
+    const std::size_t first = res.size();
+    fetch(handles, 0u, handles.size(), res);
+    if(times){
+        // fetch() skips records removed meanwhile, the others keep the order of handles
+        std::size_t j = first;
+        for(std::size_t k = 0; k < taken && j < res.size(); ++k){
+            if(res[j].first == handles[k]){
+                times->push_back(static_cast<int64_t>(merged[k].first->second));
+                ++j;
+            }
+        }
+    }
+}
+
+template<class Client>
+void RedisBackend<Client>::filter(uint32_t attributes, int64_t fromMs, int64_t toMs, FilterResult& res){
+    // a time range is applied by intersecting with the handles the time index has for it
+    const bool byTime = fromMs != std::numeric_limits<int64_t>::min() ||
+            toMs != std::numeric_limits<int64_t>::max();
+    std::vector<std::vector<uint64_t>> found(m_shards.size());
+    std::vector<uint64_t> persons(m_shards.size(), 0u);
+    m_pool->run(m_shards.size(), [&](std::size_t s){
+        std::vector<std::string> keys;
+        for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+            if(attributes & (1u << a)){
+                keys.push_back(m_shards[s].attributes[a]);
+            }
+        }
+        std::vector<std::string> members;
+        m_ctxP->sinter(keys.begin(), keys.end(), std::back_inserter(members));
+
+        std::unordered_set<std::string> inRange;
+        if(byTime && !members.empty()){
+            std::vector<std::string> handles;
+            m_ctxP->zrangebyscore(m_shards[s].times, timeInterval(fromMs, toMs), std::back_inserter(handles));
+            inRange.insert(handles.begin(), handles.end());
+        }
+        for(const auto& member : members){
+            const std::string handle = member.substr(0, member.find('.'));
+            if(byTime && !inRange.count(handle)){
+                continue;
+            }
+            persons[s]++;
+            found[s].push_back(std::strtoull(handle.c_str(), nullptr, 10));
+        }
+    });
+
+    std::vector<uint64_t> handles;
+    for(std::size_t s = 0; s < m_shards.size(); ++s){
+        res.persons += persons[s];
+        handles.insert(handles.end(), found[s].begin(), found[s].end());
+    }
+    // handles grow with every record, so sorting them gives a stable, oldest first order across pages
+    std::sort(handles.begin(), handles.end());
+    handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+    res.handles.reserve(handles.size());
+    for(uint64_t handle : handles){
+        res.handles.push_back(std::to_string(handle));
+    }
+}
+
+template<class Client>
+void RedisBackend<Client>::fetch(const std::vector<std::string>& handles, std::size_t offset, std::size_t count,
+        RecordVec& res){
+    if(offset >= handles.size()){
+        return;
+    }
+    const std::size_t first = offset;
+    const std::size_t last = first + std::min(count, handles.size() - offset);
+
+    // the handles of a shard are fetched with one HMGET, and the shards in parallel
+    std::vector<std::vector<std::size_t>> byShard(m_shards.size());
+    for(std::size_t i = first; i < last; ++i){
+        byShard[shardOf(std::strtoull(handles[i].c_str(), nullptr, 10))].push_back(i);
+    }
+    std::vector<std::size_t> shards;
+    for(std::size_t s = 0; s < m_shards.size(); ++s){
+        if(!byShard[s].empty()){
+            shards.push_back(s);
+        }
+    }
+    std::vector<sw::redis::OptionalString> bodies(last - first);
+    m_pool->run(shards.size(), [&](std::size_t k){
+        const std::vector<std::size_t>& indices = byShard[shards[k]];
+        std::vector<std::string> keys;
+        keys.reserve(indices.size());
+        for(std::size_t i : indices){
+            keys.push_back(handles[i]);
+        }
+        std::vector<sw::redis::OptionalString> found;
+        found.reserve(keys.size());
+        m_ctxP->hmget(m_shards[shards[k]].records, keys.begin(), keys.end(), std::back_inserter(found));
+        for(std::size_t j = 0; j < found.size() && j < indices.size(); ++j){
+            bodies[indices[j] - first] = std::move(found[j]);
+        }
+    });
+
+    res.reserve(res.size() + bodies.size());
+    for(std::size_t i = 0; i < bodies.size(); ++i){
+        if(bodies[i]){
+            res.emplace_back(handles[first + i], *bodies[i]);
+        }
+    }
+}
+
+template<class Client>
+void RedisBackend<Client>::usage(uint64_t& records, uint64_t& bytes){
+    std::vector<long long> counts(m_shards.size(), 0);
+    std::vector<long long> sizes(m_shards.size(), 0);
+    m_pool->run(m_shards.size(), [&](std::size_t s){
+        counts[s] = m_ctxP->hlen(m_shards[s].records);
+        const sw::redis::OptionalString size = m_ctxP->get(m_shards[s].bytes);
+        if(size){
+            sizes[s] = std::strtoll(size->c_str(), nullptr, 10);
+        }
+    });
+    records = 0u;
+    bytes = 0u;
+    for(std::size_t s = 0; s < m_shards.size(); ++s){
+        records += static_cast<uint64_t>(std::max<long long>(counts[s], 0));
+        bytes += static_cast<uint64_t>(std::max<long long>(sizes[s], 0));
+    }
+}
+
+template<class Client>
+std::size_t RedisBackend<Client>::removeOldest(std::size_t count, int64_t beforeMs, uint64_t& bytes){
+    bytes = 0u;
+    if(count == 0u || beforeMs == std::numeric_limits<int64_t>::min()){
+        return 0u;
+    }
+    // the oldest records of every shard compete for the count, merged like the pages of scanRange()
+    std::vector<std::vector<std::pair<std::string, double>>> oldest(m_shards.size());
+    m_pool->run(m_shards.size(), [&](std::size_t s){
+        sw::redis::LimitOptions limit;
+        limit.offset = 0;
+        limit.count = static_cast<long long>(count);
+        m_ctxP->zrangebyscore(m_shards[s].times, timeInterval(std::numeric_limits<int64_t>::min(), beforeMs - 1),
+                limit, std::back_inserter(oldest[s]));
+    });
+    using Entry = std::pair<const std::pair<std::string, double>*, std::size_t>;     // entry and its shard
+    std::vector<Entry> merged;
+    for(std::size_t s = 0; s < oldest.size(); ++s){
+        for(const auto& entry : oldest[s]){
+            merged.emplace_back(&entry, s);
+        }
+    }
+    const std::size_t taken = std::min(count, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + taken, merged.end(), [](const Entry& a, const Entry& b){
+        if(a.first->second != b.first->second){
+            return a.first->second < b.first->second;
+        }
+        return a.first->first < b.first->first;
+    });
+    std::vector<std::vector<std::string>> handles(m_shards.size());
+    std::vector<bool> shards(m_shards.size(), false);
+    for(std::size_t k = 0; k < taken; ++k){
+        handles[merged[k].second].push_back(merged[k].first->first);
+        shards[merged[k].second] = true;
+    }
+    std::vector<std::size_t> used;
+    for(std::size_t s = 0; s < m_shards.size(); ++s){
+        if(shards[s]){
+            used.push_back(s);
+        }
+    }
+
+    // the attribute index entries of a record are found by decoding its persons from the body
+    std::vector<RecordBatch> removals(m_shards.size());
+    m_pool->run(used.size(), [&](std::size_t k){
+        const std::size_t s = used[k];
+        std::vector<sw::redis::OptionalString> found;
+        found.reserve(handles[s].size());
+        m_ctxP->hmget(m_shards[s].records, handles[s].begin(), handles[s].end(), std::back_inserter(found));
+        for(std::size_t j = 0; j < found.size() && j < handles[s].size(); ++j){
+            if(!found[j]){
+                continue;
+            }
+            const std::string& body = *found[j];
+            removals[s].bytes += static_cast<long long>(body.length());
+            ImageRecordVec images;
+            if(ResultCodec::isBinary(body) ? !ResultCodec::decodeBinary(body.data(), body.length(), images) :
+                    !ResultCodec::fromJson(body, images)){
+                continue;
+            }
+            std::size_t p = 0;
+            for(const auto& image : images){
+                for(const auto& person : image.persons){
+                    for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+                        if(person.attributes & (1u << a)){
+                            removals[s].postings[a].push_back(handles[s][j] + "." + std::to_string(p));
+                        }
+                    }
+                    ++p;
+                }
+            }
+        }
+    });
+    pipelined(m_sweepPipes, shards, [&](sw::redis::Pipeline& pipe, std::size_t s){
+        pipe.hdel(m_shards[s].records, handles[s].begin(), handles[s].end())
+                .zrem(m_shards[s].times, handles[s].begin(), handles[s].end());
+        for(std::size_t a = 0; a < ResultCodec::attributeCount; ++a){
+            if(!removals[s].postings[a].empty()){
+                pipe.srem(m_shards[s].attributes[a], removals[s].postings[a].begin(), removals[s].postings[a].end());
+            }
+        }
+    });
+    for(std::size_t s : used){
+        if(removals[s].bytes == 0){
+            continue;
+        }
+        const long long left = m_ctxP->decrby(m_shards[s].bytes, removals[s].bytes);
+        if(left < 0){
+            // records of earlier versions were never counted. Counting is additive, so adding back what went
+            //  below zero is right even if the writer added to the counter in between
+            m_ctxP->incrby(m_shards[s].bytes, -left);
+        }
+        bytes += static_cast<uint64_t>(removals[s].bytes);
+    }
+    return taken;
+}
+
+template class RedisBackend<sw::redis::Redis>;
+template class RedisBackend<sw::redis::RedisCluster>;
+
+}
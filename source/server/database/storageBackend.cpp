@@ -0,0 +1,59 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <server/database/storageBackend.hpp>
+#include <server/database/logBackend.hpp>
+#ifdef SISD_WITH_REDIS
+#include <server/database/redisBackend.hpp>
+#endif
+
+namespace SISD{
+
+std::unique_ptr<StorageBackend> StorageBackend::create(const HistoryStorage::Options& options){
+    switch(options.backend){
+    case HistoryStorage::Redis:
+#ifdef SISD_WITH_REDIS
+        if(options.redisCluster){
+            return std::unique_ptr<StorageBackend>(new RedisBackend<sw::redis::RedisCluster>(options));
+        }
+        return std::unique_ptr<StorageBackend>(new RedisBackend<sw::redis::Redis>(options));
+#else
+        std::cerr << "[ ERROR ] This build has no Redis support, only the log history storage is available" << std::endl;
+        return nullptr;
+#endif
+    case HistoryStorage::Log:
+        return std::unique_ptr<StorageBackend>(new LogBackend(options));
+    }
+    return nullptr;
+}
+
+StorageBackend::~StorageBackend(){
+
+}
+
+uint64_t StorageBackend::position(const std::string& cursor){
+    if(cursor.empty() || cursor.size() > 20u || cursor.find_first_not_of("0123456789") != std::string::npos){
+        throw std::invalid_argument("Invalid history cursor " + cursor);
+    }
+    return std::strtoull(cursor.c_str(), nullptr, 10);
+}
+
+bool StorageBackend::rangeKey(const std::string& cursor, int64_t& timeMs, HistoryStorage::JobHandle& handle){
+    if(cursor == "0"){
+        return false;
+    }
+    const std::size_t dash = cursor.find('-');
+    if(dash == std::string::npos){
+        throw std::invalid_argument("Invalid history range cursor " + cursor);
+    }
+    timeMs = static_cast<int64_t>(position(cursor.substr(0, dash)));
+    handle = position(cursor.substr(dash + 1u));
+    return true;
+}
+
+std::string StorageBackend::rangeCursor(int64_t timeMs, HistoryStorage::JobHandle handle){
+    return std::to_string(timeMs) + "-" + std::to_string(handle);
+}
+
+}
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <common/utility/base64.h>
+#include <server/jobs/jobQueue.hpp>
+#include <server/PersonPipeline/PersonPipeline.hpp>
+#include <server/profiling/metrics.hpp>
+#include <server/profiling/trace.hpp>
+
+namespace SISD{
+
+namespace{
+
+JobQueue::Options& queueOptions(){
+    static JobQueue::Options options;
+    return options;
+}
+
+}
+
+class JobQueue::Impl{
+public:
+    explicit Impl(const Options& options);
+
+    ~Impl();
+
+    bool submit(ImageMap& images, JobHandle& handle);
+
+    bool lookup(JobHandle handle, Status& status, ImageRecordVec& results);
+
+    bool watch(JobHandle handle, const std::function<void()>& finished);
+
+private:
+    struct Job{
+        Status status;
+        ImageMap images;                                // until a worker takes the job
+        ImageRecordVec results;
+        std::chrono::steady_clock::time_point finishedAt;
+        std::vector<std::function<void()>> watchers;
+    };
+
+    void workerLoop();
+
+    /// run the images of a job through the pipeline of the calling worker, loading it first if needed
+    bool run(std::unique_ptr<PersonPipeline>& pipeline, const ImageMap& images, ImageRecordVec& results);
+
+    /// drop finished jobs beyond the limits of the options. Expects m_mutex to be held
+    void evict();
+
+    const Options m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::unordered_map<JobHandle, Job> m_jobs;          // queued, running and kept finished jobs
+    std::deque<JobHandle> m_queue;                      // queued jobs in submission order
+    std::deque<JobHandle> m_finished;                   // kept finished jobs, oldest first
+    bool m_stop;
+    std::vector<std::thread> m_workers;
+};
+
+JobQueue::Impl::Impl(const Options& options): m_options(options), m_stop(false){
+    for(std::size_t i = 0; i < std::max<std::size_t>(m_options.workers, 1u); ++i){
+        m_workers.emplace_back(&Impl::workerLoop, this);
+    }
+}
+
+JobQueue::Impl::~Impl(){
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    for(auto& worker : m_workers){
+        worker.join();
+    }
+}
+
+bool JobQueue::Impl::submit(ImageMap& images, JobHandle& handle){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    if(m_queue.size() >= m_options.capacity){
+        Metrics::getInstance().jobsRejected.add();
+        return false;
+    }
+    handle = HistoryStorage::getInstance().generateHandle();
+    Job& job = m_jobs[handle];
+    job.status = Queued;
+    job.images.swap(images);
+    m_queue.push_back(handle);
+    Metrics::getInstance().jobQueueDepth.add();
+    m_wakeup.notify_one();
+    return true;
+}
+
+bool JobQueue::Impl::lookup(JobHandle handle, Status& status, ImageRecordVec& results){
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        const auto it = m_jobs.find(handle);
+        if(it != m_jobs.end()){
+            status = it->second.status;
+            if(status == Done){
+                results = it->second.results;
+            }
+            return true;
+        }
+    }
+
+    // a job that left memory, or one of an earlier run of the server, has its results in the history
+    HistoryStorage::RecordVec records;
+    if(!HistoryStorage::getInstance().fetch(std::vector<std::string>(1, std::to_string(handle)), 0, 1, records) ||
+            records.empty()){
+        return false;
+    }
+    const std::string& body = records.front().second;
+    const bool decoded = ResultCodec::isBinary(body) ? ResultCodec::decodeBinary(body.data(), body.length(), results) :
+            ResultCodec::fromJson(body, results);
+    status = decoded ? Done : Failed;
+    return true;
+}
+
+bool JobQueue::Impl::watch(JobHandle handle, const std::function<void()>& finished){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    const auto it = m_jobs.find(handle);
+    if(it == m_jobs.end() || it->second.status == Done || it->second.status == Failed){
+        return false;
+    }
+    it->second.watchers.push_back(finished);
+    return true;
+}
+
+void JobQueue::Impl::workerLoop(){
+    Metrics& metrics = Metrics::getInstance();
+    // loaded by the first job, so that a server without jobs does not load the networks twice
+    std::unique_ptr<PersonPipeline> pipeline;
+    while(true){
+        JobHandle handle;
+        ImageMap images;
+        {
+            std::unique_lock<std::mutex> lk(m_mutex);
+            m_wakeup.wait(lk, [this](){
+                return m_stop || !m_queue.empty();
+            });
+            if(m_stop){
+                return;
+            }
+            handle = m_queue.front();
+            m_queue.pop_front();
+            Job& job = m_jobs.at(handle);
+            job.status = Running;
+            images.swap(job.images);
+            metrics.jobQueueDepth.sub();
+        }
+
+        ImageRecordVec results;
+        const bool success = run(pipeline, images, results);
+        if(success){
+            HistoryStorage::getInstance().save(handle, ResultCodec::toJson(results), results);
+            metrics.jobsCompleted.add();
+        }
+        else{
+            metrics.jobsFailed.add();
+        }
+
+        std::vector<std::function<void()>> watchers;
+        {
+            std::lock_guard<std::mutex> lg(m_mutex);
+            Job& job = m_jobs.at(handle);
+            job.status = success ? Done : Failed;
+            job.results.swap(results);
+            job.finishedAt = std::chrono::steady_clock::now();
+            watchers.swap(job.watchers);
+            m_finished.push_back(handle);
+            evict();
+        }
+        for(const auto& watcher : watchers){
+            watcher();
+        }
+    }
+}
+
+bool JobQueue::Impl::run(std::unique_ptr<PersonPipeline>& pipeline, const ImageMap& images,
+        ImageRecordVec& results){
+    SISD_TRACE_SCOPE("job");
+    if(!pipeline){
+        std::unique_ptr<PersonPipeline> loaded(new PersonPipeline(m_options.backend));
+        if(!loaded->init()){
+            std::cerr << "[ ERROR ] Unable to load the pipeline of a job worker" << std::endl;
+            return false;
+        }
+        pipeline = std::move(loaded);
+    }
+
+    Metrics& metrics = Metrics::getInstance();
+    metrics.inferenceQueueDepth.add();
+    bool success = true;
+    results.reserve(images.size());
+    for(const auto& iter : images){
+        std::string decoded;
+        try{
+            decoded = base64_decode(iter.second, true);
+        }
+        catch(...){
+            // the decoder throws a string literal on malformed input
+            success = false;
+            break;
+        }
+        ImageRecord result;
+        pipeline->run(decoded.data(), decoded.length(), iter.first, result);
+        metrics.imagesProcessed.add();
+        metrics.personsDetected.add(result.persons.size());
+        results.push_back(std::move(result));
+    }
+    metrics.inferenceQueueDepth.sub();
+    return success;
+}
+
+void JobQueue::Impl::evict(){
+    const auto oldest = std::chrono::steady_clock::now() - m_options.keepTime;
+    while(!m_finished.empty() && (m_finished.size() > m_options.keepJobs ||
+            m_jobs.at(m_finished.front()).finishedAt < oldest)){
+        m_jobs.erase(m_finished.front());
+        m_finished.pop_front();
+    }
+}
+
+JobQueue::JobQueue(){
+    m_impl = std::unique_ptr<Impl>(new Impl(queueOptions()));
+}
+
+JobQueue::~JobQueue(){
+
+}
+
+JobQueue& JobQueue::getInstance(){
+    static JobQueue inst;
+    return inst;
+}
+
+void JobQueue::configure(const Options& options){
+    queueOptions() = options;
+}
+
+const char* JobQueue::statusName(Status status){
+    switch(status){
+    case Queued:
+        return "queued";
+    case Running:
+        return "running";
+    case Done:
+        return "done";
+    default:
+        return "failed";
+    }
+}
+
+bool JobQueue::submit(ImageMap& images, JobHandle& handle){
+    return m_impl->submit(images, handle);
+}
+
+bool JobQueue::lookup(JobHandle handle, Status& status, ImageRecordVec& results){
+    return m_impl->lookup(handle, status, results);
+}
+
+bool JobQueue::watch(JobHandle handle, const std::function<void()>& finished){
+    return m_impl->watch(handle, finished);
+}
+
+}
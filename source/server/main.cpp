@@ -1,20 +1,219 @@
 #include <fstream>
 #include <iostream>
+#include <boost/program_options.hpp>
+#include <server/database/historyStorage.hpp>
+#include <server/jobs/jobQueue.hpp>
+#include <server/profiling/trafficCapture.hpp>
 #include <server/server/server.hpp>
 
+struct serverOption{
+    std::string address;
+    std::string port;
+    SISD::HistoryStorage::Options storage;
+    SISD::TrafficCapture::Options capture;
+    SISD::JobQueue::Options jobs;
+    SISD::BackendConfig backend;
+};
+
+serverOption parseArguments(int argc, char* argv[])
+{
+    using namespace boost::program_options;
+
+    variables_map vm;
+    options_description opt_desc("This is a Simple Inference Service Demo (SISD) server.\n\n"
+            "Example usages:\n  SISDServer\n  SISDServer -p 8080 -b mock --mock-delay-ms 30\n\nOptions");
+    opt_desc.add_options()
+        ("help,h", "Produce this help message")
+        ("address,a", value<std::string>()->default_value("localhost"), "Address to listen on")
+        ("port,p", value<std::string>()->default_value("80"), "Port to listen on")
+#ifdef SISD_WITH_REDIS
+        ("history-backend", value<std::string>()->default_value("redis"), "Database the history is stored to. Value could be redis or log")
+#else
+        ("history-backend", value<std::string>()->default_value("log"), "Database the history is stored to. Value could be redis or log")
+#endif
+        ("redis", value<std::string>()->default_value("tcp://127.0.0.1:6379"), "Redis the history is stored to with --history-backend redis")
+        ("redis-cluster", bool_switch(), "--redis is a node of a Redis Cluster")
+        ("redis-shards", value<std::size_t>()->default_value(1), "Hashes the history is spread over in Redis. Records stored with another number of shards are not found")
+        ("redis-pool", value<std::size_t>()->default_value(4), "Connections to Redis shared by history readers")
+        ("redis-connect-timeout-ms", value<unsigned>()->default_value(0), "Longest a connection to Redis may take to open. 0 for no limit")
+        ("redis-socket-timeout-ms", value<unsigned>()->default_value(0), "Longest a Redis command may take. 0 for no limit")
+        ("redis-pool-wait-ms", value<unsigned>()->default_value(0), "Longest a history reader waits for a free Redis connection. 0 for no limit")
+        ("redis-keepalive", value<bool>()->default_value(true), "Enable TCP keepalive on the Redis connections")
+        ("history-handle-block", value<std::size_t>()->default_value(1024), "History handles reserved from the database at a time")
+        ("history-log-dir", value<std::string>()->default_value("history.log"), "Directory of the log with --history-backend log")
+        ("history-log-segment-mb", value<std::size_t>()->default_value(64), "Size of a log segment, below 4096")
+        ("history-log-sync-ms", value<int>()->default_value(0), "Least time between syncs of the log to disk. 0 syncs every batch, negative never syncs explicitly")
+        ("history-cache-records", value<std::size_t>()->default_value(10000), "Recent history records kept in memory to answer queries for recent time ranges, with the log storage only. 0 disables the cache")
+        ("history-cache-mb", value<double>()->default_value(64.0), "Most memory the history cache takes")
+        ("history-cache-seconds", value<double>()->default_value(300.0), "History records saved longer ago leave the cache. 0 for no limit")
+        ("history-retention-hours", value<double>()->default_value(0.0), "History records saved longer ago are removed. 0 keeps them")
+        ("history-max-records", value<uint64_t>()->default_value(0), "Most history records kept, the oldest are removed first. 0 for no limit")
+        ("history-max-mb", value<double>()->default_value(0.0), "Most history kept in MB of records, the oldest are removed first. 0 for no limit")
+        ("history-sweep-ms", value<unsigned>()->default_value(1000), "Time between two steps of the history retention sweeper")
+        ("history-sweep-batch", value<std::size_t>()->default_value(1000), "Most history records one step of the retention sweeper removes")
+        ("history-queue", value<std::size_t>()->default_value(4096), "History records that may wait for the background writer")
+        ("history-batch", value<std::size_t>()->default_value(128), "History records stored per database round-trip")
+        ("history-flush-ms", value<unsigned>()->default_value(5), "Longest a history record waits for its batch to fill up")
+        ("history-overflow", value<std::string>()->default_value("block"), "What to do with history records when the queue is full. Value could be block, drop or spill")
+        ("history-spill", value<std::string>()->default_value("history.spill"), "File records are spilled to with --history-overflow spill")
+        ("history-format", value<std::string>()->default_value("binary"), "Form history records are stored in. Value could be binary or json")
+        ("backend,b", value<std::string>(), "Inference backend. Value could be openvino or mock. Defaults to openvino if built with it")
+        ("device", value<std::string>()->default_value("CPU"), "OpenVINO device the networks are loaded to")
+        ("mock-delay-ms", value<double>()->default_value(20.0), "Time the mock backend spends per person detection")
+        ("mock-attributes-delay-ms", value<double>()->default_value(2.0), "Time the mock backend spends per person attributes recognition")
+        ("mock-load-delay-ms", value<double>()->default_value(200.0), "Time the mock backend spends loading its networks")
+        ("mock-persons", value<unsigned>()->default_value(3), "Persons the mock backend finds in every image")
+        ("job-workers", value<std::size_t>()->default_value(1), "Threads running the jobs submitted to /jobs, each with its own copy of the networks")
+        ("job-queue", value<std::size_t>()->default_value(256), "Jobs that may wait for a worker. Further jobs are refused with 503")
+        ("job-keep", value<std::size_t>()->default_value(1024), "Finished jobs kept in memory. Older ones are read back from the history")
+        ("job-keep-seconds", value<unsigned>()->default_value(600), "Finished jobs leave memory after this time")
+        ("capture", value<std::string>(), "Append incoming /predict requests to this capture file for SISDReplay")
+        ("capture-sample", value<double>()->default_value(1.0), "Fraction of requests captured")
+        ("capture-max-request-mb", value<double>()->default_value(64.0), "Requests with larger bodies are not captured")
+        ("capture-max-file-mb", value<double>()->default_value(1024.0), "Capturing stops once the file reaches this size");
+
+    store(parse_command_line(argc, argv, opt_desc), vm);
+    notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << opt_desc << std::endl;
+        exit(0);
+    }
+
+    serverOption ret;
+    ret.address = vm["address"].as<std::string>();
+    ret.port = vm["port"].as<std::string>();
+    if (!SISD::HistoryStorage::parseBackendType(vm["history-backend"].as<std::string>(), ret.storage.backend)) {
+        std::cerr << "Invalid history backend. Value could be redis or log. Exit" << std::endl;
+        exit(1);
+    }
+    ret.storage.uri = vm["redis"].as<std::string>();
+    ret.storage.redisCluster = vm["redis-cluster"].as<bool>();
+    ret.storage.redisShards = vm["redis-shards"].as<std::size_t>();
+    ret.storage.redisPoolSize = vm["redis-pool"].as<std::size_t>();
+    ret.storage.redisConnectTimeout = std::chrono::milliseconds(vm["redis-connect-timeout-ms"].as<unsigned>());
+    ret.storage.redisSocketTimeout = std::chrono::milliseconds(vm["redis-socket-timeout-ms"].as<unsigned>());
+    ret.storage.redisPoolWait = std::chrono::milliseconds(vm["redis-pool-wait-ms"].as<unsigned>());
+    ret.storage.redisKeepAlive = vm["redis-keepalive"].as<bool>();
+    ret.storage.handleBlock = vm["history-handle-block"].as<std::size_t>();
+    ret.storage.logDir = vm["history-log-dir"].as<std::string>();
+    ret.storage.logSegmentBytes = vm["history-log-segment-mb"].as<std::size_t>() << 20u;
+    ret.storage.logSyncInterval = std::chrono::milliseconds(vm["history-log-sync-ms"].as<int>());
+    double cacheMb = vm["history-cache-mb"].as<double>();
+    double cacheSeconds = vm["history-cache-seconds"].as<double>();
+    if (cacheMb < 0.0 || cacheSeconds < 0.0) {
+        std::cerr << "History cache limits cannot be negative. Exit" << std::endl;
+        exit(1);
+    }
+    ret.storage.cacheRecords = vm["history-cache-records"].as<std::size_t>();
+    ret.storage.cacheBytes = static_cast<std::size_t>(cacheMb * 1024.0 * 1024.0);
+    ret.storage.cacheWindow = std::chrono::milliseconds(static_cast<int64_t>(cacheSeconds * 1000.0));
+    double retentionHours = vm["history-retention-hours"].as<double>();
+    double maxMb = vm["history-max-mb"].as<double>();
+    if (retentionHours < 0.0 || maxMb < 0.0) {
+        std::cerr << "History retention limits cannot be negative. Exit" << std::endl;
+        exit(1);
+    }
+    ret.storage.retentionAge = std::chrono::seconds(static_cast<int64_t>(retentionHours * 3600.0));
+    ret.storage.retentionRecords = vm["history-max-records"].as<uint64_t>();
+    ret.storage.retentionBytes = static_cast<uint64_t>(maxMb * 1024.0 * 1024.0);
+    ret.storage.sweepInterval = std::chrono::milliseconds(vm["history-sweep-ms"].as<unsigned>());
+    ret.storage.sweepBatch = vm["history-sweep-batch"].as<std::size_t>();
+    ret.storage.queueCapacity = vm["history-queue"].as<std::size_t>();
+    ret.storage.batchSize = vm["history-batch"].as<std::size_t>();
+    ret.storage.flushInterval = std::chrono::milliseconds(vm["history-flush-ms"].as<unsigned>());
+    ret.storage.spillPath = vm["history-spill"].as<std::string>();
+    if (!SISD::HistoryStorage::parseOverflowPolicy(vm["history-overflow"].as<std::string>(), ret.storage.overflow)) {
+        std::cerr << "Invalid history overflow policy. Value could be block, drop or spill. Exit" << std::endl;
+        exit(1);
+    }
+    if (!SISD::HistoryStorage::parseRecordFormat(vm["history-format"].as<std::string>(), ret.storage.format)) {
+        std::cerr << "Invalid history format. Value could be binary or json. Exit" << std::endl;
+        exit(1);
+    }
+    if (ret.storage.queueCapacity == 0u || ret.storage.batchSize == 0u || ret.storage.logSegmentBytes == 0u ||
+            ret.storage.redisPoolSize == 0u || ret.storage.handleBlock == 0u || ret.storage.redisShards == 0u ||
+            ret.storage.sweepBatch == 0u || ret.storage.sweepInterval.count() == 0) {
+        std::cerr << "The history queue, batch, log segment, Redis pool, shard, handle block and sweep sizes must be positive. Exit" << std::endl;
+        exit(1);
+    }
+    if (vm["history-log-segment-mb"].as<std::size_t>() >= 4096u) {
+        std::cerr << "The log segment size must be below 4096 MB, as records are indexed by 32 bit offsets. Exit" << std::endl;
+        exit(1);
+    }
+    if (vm.count("backend") && !SISD::BackendConfig::parseType(vm["backend"].as<std::string>(), ret.backend.type)) {
+        std::cerr << "Invalid backend. Value could be openvino or mock. Exit" << std::endl;
+        exit(1);
+    }
+    ret.backend.device = vm["device"].as<std::string>();
+    double detectionDelayMs = vm["mock-delay-ms"].as<double>();
+    double attributesDelayMs = vm["mock-attributes-delay-ms"].as<double>();
+    double loadDelayMs = vm["mock-load-delay-ms"].as<double>();
+    if (detectionDelayMs < 0.0 || attributesDelayMs < 0.0 || loadDelayMs < 0.0) {
+        std::cerr << "Mock delays cannot be negative. Exit" << std::endl;
+        exit(1);
+    }
+    ret.backend.mockDetectionDelay = std::chrono::microseconds(static_cast<long long>(detectionDelayMs * 1000.0));
+    ret.backend.mockAttributesDelay = std::chrono::microseconds(static_cast<long long>(attributesDelayMs * 1000.0));
+    ret.backend.mockLoadDelay = std::chrono::microseconds(static_cast<long long>(loadDelayMs * 1000.0));
+    ret.backend.mockPersons = vm["mock-persons"].as<unsigned>();
+    ret.jobs.backend = ret.backend;
+    ret.jobs.workers = vm["job-workers"].as<std::size_t>();
+    ret.jobs.capacity = vm["job-queue"].as<std::size_t>();
+    ret.jobs.keepJobs = vm["job-keep"].as<std::size_t>();
+    ret.jobs.keepTime = std::chrono::seconds(vm["job-keep-seconds"].as<unsigned>());
+    if (ret.jobs.workers == 0u || ret.jobs.capacity == 0u) {
+        std::cerr << "The job workers and queue must be positive. Exit" << std::endl;
+        exit(1);
+    }
+    if (vm.count("capture")) {
+        ret.capture.path = vm["capture"].as<std::string>();
+    }
+    ret.capture.sampleRate = vm["capture-sample"].as<double>();
+    double maxRequestMb = vm["capture-max-request-mb"].as<double>();
+    double maxFileMb = vm["capture-max-file-mb"].as<double>();
+    if (ret.capture.sampleRate <= 0.0 || ret.capture.sampleRate > 1.0 || maxRequestMb <= 0.0 || maxFileMb <= 0.0) {
+        std::cerr << "The capture sample rate must be within (0, 1] and its size caps positive. Exit" << std::endl;
+        exit(1);
+    }
+    ret.capture.maxRequestBytes = static_cast<uint64_t>(maxRequestMb * 1024.0 * 1024.0);
+    ret.capture.maxFileBytes = static_cast<uint64_t>(maxFileMb * 1024.0 * 1024.0);
+    return ret;
+}
+
 /**
-* @brief start the server's executable. Make sure you have redis available.
-*       This will start a http server on local host port 80 
-*  
-* @param void
-* @return void
-* 
+* @brief start the server's executable. Make sure you have redis available, unless the history is stored
+*       to the embedded log. By default this will start a http server on local host port 80
+*
+* @param argc number of command line arguments, see --help
+* @param argv the command line arguments
+* @return exit code
+*
 */
-int main(){
+int main(int argc, char* argv[]){
+    serverOption opt = parseArguments(argc, argv);
+    SISD::HistoryStorage::configure(opt.storage);
+    try
+    {
+        // open the history storage up front, so that a log that cannot be opened stops the server right away
+        SISD::HistoryStorage::getInstance();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Unable to open the history storage: " << e.what() << ". Exit" << std::endl;
+        return 1;
+    }
+    // the workers start after the history storage, so that they are stopped before it
+    SISD::JobQueue::configure(opt.jobs);
+    SISD::JobQueue::getInstance();
+    if (!opt.capture.path.empty() && !SISD::TrafficCapture::getInstance().start(opt.capture)) {
+        return 1;
+    }
+
     try
     {
         // Initialise the server.
-        http::server::server s("localhost", "80", ".");
+        http::server::server s(opt.address, opt.port, ".", opt.backend);
 
         // Run the server until stopped.
         s.run();
@@ -25,4 +224,4 @@ int main(){
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <server/profiling/layerProfile.hpp>
+
+namespace SISD{
+
+class LayerProfile::Impl{
+public:
+    struct Layer{
+        std::string layerType;
+        std::string execType;
+        unsigned long long calls;
+        long long realTimeUs;
+        long long cpuTimeUs;
+    };
+
+    using LayerKey = std::pair<std::string, std::string>;   // network, layer
+
+    void reset();
+
+    void accumulate(const std::string& network, const std::string& layer, const std::string& layerType,
+            const std::string& execType, long long realTimeUs, long long cpuTimeUs);
+
+    std::string toJson(bool enabled) const;
+
+private:
+    std::map<LayerKey, Layer> m_layers;
+    mutable std::mutex m_mutex;
+};
+
+void LayerProfile::Impl::reset(){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    m_layers.clear();
+}
+
+void LayerProfile::Impl::accumulate(const std::string& network, const std::string& layer, const std::string& layerType,
+        const std::string& execType, long long realTimeUs, long long cpuTimeUs){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    Layer& entry = m_layers[LayerKey(network, layer)];
+    entry.layerType = layerType;
+    entry.execType = execType;
+    entry.calls++;
+    entry.realTimeUs += std::max(realTimeUs, 0ll);
+    entry.cpuTimeUs += std::max(cpuTimeUs, 0ll);
+}
+
+std::string LayerProfile::Impl::toJson(bool enabled) const{
+    using Entry = std::pair<LayerKey, Layer>;
+    std::vector<Entry> sorted;
+    {
+        std::lock_guard<std::mutex> lg(m_mutex);
+        sorted.assign(m_layers.begin(), m_layers.end());
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Entry& l, const Entry& r){
+        return l.second.realTimeUs > r.second.realTimeUs;
+    });
+
+    long long totalUs = 0;
+    for(const auto& entry : sorted){
+        totalUs += entry.second.realTimeUs;
+    }
+
+    boost::property_tree::ptree layersNode;
+    for(const auto& entry : sorted){
+        boost::property_tree::ptree layerNode;
+        layerNode.put("network", entry.first.first);
+        layerNode.put("layer", entry.first.second);
+        layerNode.put("layer_type", entry.second.layerType);
+        layerNode.put("exec_type", entry.second.execType);
+        layerNode.put("calls", entry.second.calls);
+        layerNode.put("real_time_us", entry.second.realTimeUs);
+        layerNode.put("cpu_time_us", entry.second.cpuTimeUs);
+        layerNode.put("avg_real_time_us", entry.second.calls ?
+                static_cast<double>(entry.second.realTimeUs) / entry.second.calls : 0.0);
+        layerNode.put("share", totalUs ? static_cast<double>(entry.second.realTimeUs) / totalUs : 0.0);
+        layersNode.push_back(std::make_pair("", layerNode));
+    }
+
+    boost::property_tree::ptree jsonTree;
+    jsonTree.put("enabled", enabled);
+    jsonTree.put("total_real_time_us", totalUs);
+    jsonTree.add_child("layers", layersNode);
+
+    std::stringstream ss;
+    boost::property_tree::json_parser::write_json(ss, jsonTree);
+    return ss.str();
+}
+
+LayerProfile::LayerProfile(): m_enabled(false){
+    m_impl = std::unique_ptr<Impl>(new Impl);
+}
+
+LayerProfile::~LayerProfile(){
+
+}
+
+LayerProfile& LayerProfile::getInstance(){
+    static LayerProfile inst;
+    return inst;
+}
+
+bool LayerProfile::enabled() const{
+    return m_enabled.load(std::memory_order_relaxed);
+}
+
+void LayerProfile::setEnabled(bool enable){
+    m_enabled.store(enable, std::memory_order_relaxed);
+}
+
+void LayerProfile::reset(){
+    m_impl->reset();
+}
+
+void LayerProfile::accumulate(const std::string& network, const std::string& layer, const std::string& layerType,
+        const std::string& execType, long long realTimeUs, long long cpuTimeUs){
+    m_impl->accumulate(network, layer, layerType, execType, realTimeUs, cpuTimeUs);
+}
+
+std::string LayerProfile::toJson() const{
+    return m_impl->toJson(enabled());
+}
+
+}
@@ -0,0 +1,288 @@
+#include <cstdio>
+#include <sstream>
+
+#include <server/profiling/metrics.hpp>
+
+namespace SISD{
+
+namespace{
+
+const char* const routeNames[Metrics::RouteCount] = {
+    "/predict", "/history", "/history/export", "/stats", "/jobs", "/metrics", "/debug", "other"
+};
+
+/// each thread is assigned a shard round robin the first time it updates a metric
+std::size_t shardIndex(){
+    static std::atomic<std::size_t> nextShard(0u);
+    static thread_local const std::size_t shard = nextShard.fetch_add(1u, std::memory_order_relaxed) % Counter::shardCount;
+    return shard;
+}
+
+void writeHistogram(std::ostream& os, const char* name, const std::string& labels, const Histogram::Snapshot& snapshot){
+    char bound[32];
+    uint64_t cumulative = 0u;
+    for(std::size_t i = 0; i < Histogram::bucketCount; ++i){
+        cumulative += snapshot.buckets[i];
+        if(i + 1 < Histogram::bucketCount){
+            std::snprintf(bound, sizeof(bound), "%g", Histogram::bucketBounds[i]);
+        }
+        else{
+            std::snprintf(bound, sizeof(bound), "+Inf");
+        }
+        os << name << "_bucket{" << labels << (labels.empty() ? "" : ",") << "le=\"" << bound << "\"} "
+                << cumulative << "\n";
+    }
+    const std::string braced = labels.empty() ? "" : "{" + labels + "}";
+    os << name << "_sum" << braced << " " << snapshot.sum << "\n";
+    os << name << "_count" << braced << " " << snapshot.count << "\n";
+}
+
+}
+
+constexpr std::size_t Counter::shardCount;
+
+Counter::Counter(){
+    for(auto& shard : m_shards){
+        shard.value.store(0u, std::memory_order_relaxed);
+    }
+}
+
+void Counter::add(uint64_t value){
+    m_shards[shardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const{
+    uint64_t ret = 0u;
+    for(const auto& shard : m_shards){
+        ret += shard.value.load(std::memory_order_relaxed);
+    }
+    return ret;
+}
+
+Gauge::Gauge(): m_value(0){
+
+}
+
+void Gauge::add(int64_t value){
+    m_value.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Gauge::sub(int64_t value){
+    m_value.fetch_sub(value, std::memory_order_relaxed);
+}
+
+void Gauge::set(int64_t value){
+    m_value.store(value, std::memory_order_relaxed);
+}
+
+int64_t Gauge::value() const{
+    return m_value.load(std::memory_order_relaxed);
+}
+
+constexpr std::size_t Histogram::bucketCount;
+
+const double Histogram::bucketBounds[Histogram::bucketCount - 1] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 10.0
+};
+
+Histogram::Histogram(){
+    for(auto& shard : m_shards){
+        for(auto& bucket : shard.buckets){
+            bucket.store(0u, std::memory_order_relaxed);
+        }
+        shard.sumNanoseconds.store(0u, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(StageTimings::Clock::duration duration){
+    const double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+    std::size_t bucket = 0;
+    while(bucket + 1 < bucketCount && seconds > bucketBounds[bucket]){
+        ++bucket;
+    }
+    Shard& shard = m_shards[shardIndex()];
+    shard.buckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+    shard.sumNanoseconds.fetch_add(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()), std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const{
+    Snapshot ret;
+    uint64_t sumNanoseconds = 0u;
+    ret.count = 0u;
+    for(std::size_t i = 0; i < bucketCount; ++i){
+        ret.buckets[i] = 0u;
+    }
+    for(const auto& shard : m_shards){
+        for(std::size_t i = 0; i < bucketCount; ++i){
+            uint64_t value = shard.buckets[i].load(std::memory_order_relaxed);
+            ret.buckets[i] += value;
+            ret.count += value;
+        }
+        sumNanoseconds += shard.sumNanoseconds.load(std::memory_order_relaxed);
+    }
+    ret.sum = static_cast<double>(sumNanoseconds) / 1e9;
+    return ret;
+}
+
+constexpr std::size_t Metrics::statusCount;
+
+const int Metrics::statusCodes[Metrics::statusCount - 1] = {
+    200, 202, 204, 304, 400, 404, 500, 503
+};
+
+Metrics::Metrics(){
+
+}
+
+Metrics::~Metrics(){
+
+}
+
+Metrics& Metrics::getInstance(){
+    static Metrics inst;
+    return inst;
+}
+
+void Metrics::countRequest(Route route, int status, StageTimings::Clock::duration duration){
+    std::size_t statusIdx = 0;
+    while(statusIdx + 1 < statusCount && statusCodes[statusIdx] != status){
+        ++statusIdx;
+    }
+    m_requests[route][statusIdx].add();
+    m_requestLatency[route].observe(duration);
+}
+
+void Metrics::observeStages(const StageTimings& timings){
+    for(int i = 0; i < StageTimings::StageCount; ++i){
+        m_stageLatency[i].observe(timings.duration(static_cast<StageTimings::Stage>(i)));
+    }
+}
+
+std::string Metrics::exposition() const{
+    std::ostringstream os;
+
+    os << "# HELP sisd_requests_total Requests handled, by route and status.\n";
+    os << "# TYPE sisd_requests_total counter\n";
+    for(int route = 0; route < RouteCount; ++route){
+        for(std::size_t statusIdx = 0; statusIdx < statusCount; ++statusIdx){
+            uint64_t value = m_requests[route][statusIdx].value();
+            if(value == 0u){
+                continue;
+            }
+            os << "sisd_requests_total{route=\"" << routeNames[route] << "\",status=\"";
+            if(statusIdx + 1 < statusCount){
+                os << statusCodes[statusIdx];
+            }
+            else{
+                os << "other";
+            }
+            os << "\"} " << value << "\n";
+        }
+    }
+
+    os << "# HELP sisd_request_duration_seconds Time spent handling a request, by route.\n";
+    os << "# TYPE sisd_request_duration_seconds histogram\n";
+    for(int route = 0; route < RouteCount; ++route){
+        writeHistogram(os, "sisd_request_duration_seconds", std::string("route=\"") + routeNames[route] + "\"",
+                m_requestLatency[route].snapshot());
+    }
+
+    os << "# HELP sisd_stage_duration_seconds Time spent per prediction in each pipeline stage.\n";
+    os << "# TYPE sisd_stage_duration_seconds histogram\n";
+    for(int stage = 0; stage < StageTimings::StageCount; ++stage){
+        writeHistogram(os, "sisd_stage_duration_seconds",
+                std::string("stage=\"") + StageTimings::name(static_cast<StageTimings::Stage>(stage)) + "\"",
+                m_stageLatency[stage].snapshot());
+    }
+
+    os << "# HELP sisd_storage_save_duration_seconds Time spent storing a batch of records to history storage.\n";
+    os << "# TYPE sisd_storage_save_duration_seconds histogram\n";
+    writeHistogram(os, "sisd_storage_save_duration_seconds", "", storageSaveLatency.snapshot());
+
+    os << "# HELP sisd_images_processed_total Images run through the pipeline.\n";
+    os << "# TYPE sisd_images_processed_total counter\n";
+    os << "sisd_images_processed_total " << imagesProcessed.value() << "\n";
+    os << "# HELP sisd_persons_detected_total Persons found in processed images.\n";
+    os << "# TYPE sisd_persons_detected_total counter\n";
+    os << "sisd_persons_detected_total " << personsDetected.value() << "\n";
+    os << "# HELP sisd_received_bytes_total Bytes read from client connections.\n";
+    os << "# TYPE sisd_received_bytes_total counter\n";
+    os << "sisd_received_bytes_total " << bytesReceived.value() << "\n";
+    os << "# HELP sisd_sent_bytes_total Bytes written to client connections.\n";
+    os << "# TYPE sisd_sent_bytes_total counter\n";
+    os << "sisd_sent_bytes_total " << bytesSent.value() << "\n";
+    os << "# HELP sisd_inference_queue_depth Predictions waiting for or running in the pipeline.\n";
+    os << "# TYPE sisd_inference_queue_depth gauge\n";
+    os << "sisd_inference_queue_depth " << inferenceQueueDepth.value() << "\n";
+    os << "# HELP sisd_connections_in_flight Open client connections.\n";
+    os << "# TYPE sisd_connections_in_flight gauge\n";
+    os << "sisd_connections_in_flight " << connectionsInFlight.value() << "\n";
+    os << "# HELP sisd_history_queue_depth History records waiting for the background writer.\n";
+    os << "# TYPE sisd_history_queue_depth gauge\n";
+    os << "sisd_history_queue_depth " << historyQueueDepth.value() << "\n";
+    os << "# HELP sisd_history_batches_total Batches stored by the history writer.\n";
+    os << "# TYPE sisd_history_batches_total counter\n";
+    os << "sisd_history_batches_total " << historyBatches.value() << "\n";
+    os << "# HELP sisd_history_records_total History records stored by the history writer, including failed ones.\n";
+    os << "# TYPE sisd_history_records_total counter\n";
+    os << "sisd_history_records_total " << historyRecords.value() << "\n";
+    os << "# HELP sisd_history_dropped_total History records discarded because the write queue was full.\n";
+    os << "# TYPE sisd_history_dropped_total counter\n";
+    os << "sisd_history_dropped_total " << historyDropped.value() << "\n";
+    os << "# HELP sisd_history_spilled_total History records spilled to disk because the write queue was full.\n";
+    os << "# TYPE sisd_history_spilled_total counter\n";
+    os << "sisd_history_spilled_total " << historySpilled.value() << "\n";
+    os << "# HELP sisd_history_write_errors_total History records the database failed to store.\n";
+    os << "# TYPE sisd_history_write_errors_total counter\n";
+    os << "sisd_history_write_errors_total " << historyWriteErrors.value() << "\n";
+    os << "# HELP sisd_history_json_bytes_total Size of the history records queued for storage in json form.\n";
+    os << "# TYPE sisd_history_json_bytes_total counter\n";
+    os << "sisd_history_json_bytes_total " << historyJsonBytes.value() << "\n";
+    os << "# HELP sisd_history_stored_bytes_total Size of the history records queued for storage in the stored form.\n";
+    os << "# TYPE sisd_history_stored_bytes_total counter\n";
+    os << "sisd_history_stored_bytes_total " << historyStoredBytes.value() << "\n";
+    os << "# HELP sisd_history_expired_total History records removed by retention.\n";
+    os << "# TYPE sisd_history_expired_total counter\n";
+    os << "sisd_history_expired_total " << historyExpired.value() << "\n";
+    os << "# HELP sisd_history_kept_records History records stored, as last seen by the retention sweeper.\n";
+    os << "# TYPE sisd_history_kept_records gauge\n";
+    os << "sisd_history_kept_records " << historyKeptRecords.value() << "\n";
+    os << "# HELP sisd_history_kept_bytes Size of the history records stored, as last seen by the retention sweeper.\n";
+    os << "# TYPE sisd_history_kept_bytes gauge\n";
+    os << "sisd_history_kept_bytes " << historyKeptBytes.value() << "\n";
+    os << "# HELP sisd_history_cache_hits_total History queries answered from the hot cache.\n";
+    os << "# TYPE sisd_history_cache_hits_total counter\n";
+    os << "sisd_history_cache_hits_total " << historyCacheHits.value() << "\n";
+    os << "# HELP sisd_history_cache_misses_total History queries the hot cache could not answer.\n";
+    os << "# TYPE sisd_history_cache_misses_total counter\n";
+    os << "sisd_history_cache_misses_total " << historyCacheMisses.value() << "\n";
+    os << "# HELP sisd_history_cache_records History records in the hot cache.\n";
+    os << "# TYPE sisd_history_cache_records gauge\n";
+    os << "sisd_history_cache_records " << historyCacheRecords.value() << "\n";
+    os << "# HELP sisd_history_cache_bytes Memory taken by the hot cache.\n";
+    os << "# TYPE sisd_history_cache_bytes gauge\n";
+    os << "sisd_history_cache_bytes " << historyCacheBytes.value() << "\n";
+    os << "# HELP sisd_job_queue_depth Jobs submitted to /jobs and waiting for a worker.\n";
+    os << "# TYPE sisd_job_queue_depth gauge\n";
+    os << "sisd_job_queue_depth " << jobQueueDepth.value() << "\n";
+    os << "# HELP sisd_jobs_completed_total Jobs whose results were computed.\n";
+    os << "# TYPE sisd_jobs_completed_total counter\n";
+    os << "sisd_jobs_completed_total " << jobsCompleted.value() << "\n";
+    os << "# HELP sisd_jobs_failed_total Jobs that failed to load the pipeline or to decode an image.\n";
+    os << "# TYPE sisd_jobs_failed_total counter\n";
+    os << "sisd_jobs_failed_total " << jobsFailed.value() << "\n";
+    os << "# HELP sisd_jobs_rejected_total Jobs refused because the job queue was full.\n";
+    os << "# TYPE sisd_jobs_rejected_total counter\n";
+    os << "sisd_jobs_rejected_total " << jobsRejected.value() << "\n";
+    os << "# HELP sisd_captured_requests_total Requests written to the traffic capture file.\n";
+    os << "# TYPE sisd_captured_requests_total counter\n";
+    os << "sisd_captured_requests_total " << capturedRequests.value() << "\n";
+    os << "# HELP sisd_captured_bytes_total Bytes written to the traffic capture file.\n";
+    os << "# TYPE sisd_captured_bytes_total counter\n";
+    os << "sisd_captured_bytes_total " << capturedBytes.value() << "\n";
+
+    return os.str();
+}
+
+}
@@ -0,0 +1,82 @@
+#include <cstdio>
+
+#include <server/profiling/stageTimings.hpp>
+
+namespace SISD{
+
+namespace{
+
+const char* const stageNames[StageTimings::StageCount] = {
+    "receive", "parse", "base64_decode", "image_decode", "preprocess", "detection", "attributes",
+    "color_extraction", "serialization", "storage"
+};
+
+}
+
+StageTimings::Scope::Scope(StageTimings* timings, Stage stage): m_timings(timings), m_stage(stage),
+        m_start(timings ? Clock::now() : Clock::time_point()){
+
+}
+
+StageTimings::Scope::~Scope(){
+    if(m_timings){
+        m_timings->add(m_stage, Clock::now() - m_start);
+    }
+}
+
+StageTimings::StageTimings(){
+    reset();
+}
+
+void StageTimings::add(Stage stage, Clock::duration duration){
+    m_durations[stage] += duration;
+}
+
+void StageTimings::merge(const StageTimings& other){
+    for(int i = 0; i < StageCount; ++i){
+        m_durations[i] += other.m_durations[i];
+    }
+}
+
+void StageTimings::reset(){
+    for(int i = 0; i < StageCount; ++i){
+        m_durations[i] = Clock::duration::zero();
+    }
+}
+
+StageTimings::Clock::duration StageTimings::duration(Stage stage) const{
+    return m_durations[stage];
+}
+
+double StageTimings::milliseconds(Stage stage) const{
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(m_durations[stage]).count();
+}
+
+const char* StageTimings::name(Stage stage){
+    return stageNames[stage];
+}
+
+std::string StageTimings::toServerTiming() const{
+    std::string ret;
+    char buffer[64];
+    for(int i = 0; i < StageCount; ++i){
+        std::snprintf(buffer, sizeof(buffer), "%s%s;dur=%.3f", i == 0 ? "" : ", ", stageNames[i],
+                milliseconds(static_cast<Stage>(i)));
+        ret += buffer;
+    }
+    return ret;
+}
+
+std::string StageTimings::toJson() const{
+    std::string ret = "{";
+    char buffer[64];
+    for(int i = 0; i < StageCount; ++i){
+        std::snprintf(buffer, sizeof(buffer), "%s\"%s\": %.3f", i == 0 ? "" : ", ", stageNames[i],
+                milliseconds(static_cast<Stage>(i)));
+        ret += buffer;
+    }
+    ret += "}";
+    return ret;
+}
+
+}
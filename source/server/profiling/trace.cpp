@@ -0,0 +1,126 @@
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <server/profiling/trace.hpp>
+
+namespace SISD{
+
+namespace{
+
+struct Span{
+    const char* name;
+    Trace::Clock::time_point begin;
+    Trace::Clock::time_point end;
+};
+
+/// spans of a single thread. The mutex is only contended while a dump is running
+struct ThreadBuffer{
+    unsigned tid;
+    std::mutex mutex;
+    std::vector<Span> spans;
+};
+
+struct Registry{
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    Trace::Clock::time_point epoch;
+    std::atomic<Trace::Clock::rep> deadline;
+
+    Registry(): epoch(Trace::Clock::now()), deadline(0){
+
+    }
+};
+
+Registry& registry(){
+    static Registry inst;
+    return inst;
+}
+
+ThreadBuffer& threadBuffer(){
+    static thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if(!buffer){
+        Registry& reg = registry();
+        buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lg(reg.mutex);
+        buffer->tid = static_cast<unsigned>(reg.buffers.size() + 1);
+        reg.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+long long microseconds(Trace::Clock::duration d){
+    return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+}
+
+}
+
+constexpr std::size_t Trace::maxSpansPerThread;
+
+std::atomic<bool> Trace::s_enabled(false);
+
+void Trace::start(std::chrono::seconds duration){
+    Registry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lg(reg.mutex);
+        for(const auto& buffer : reg.buffers){
+            std::lock_guard<std::mutex> bufferLg(buffer->mutex);
+            buffer->spans.clear();
+        }
+    }
+    reg.deadline.store((Clock::now() + duration).time_since_epoch().count(), std::memory_order_relaxed);
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop(){
+    s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Trace::record(const char* name, Clock::time_point begin, Clock::time_point end){
+    if(end.time_since_epoch().count() > registry().deadline.load(std::memory_order_relaxed)){
+        stop();
+        return;
+    }
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lg(buffer.mutex);
+    if(buffer.spans.size() < maxSpansPerThread){
+        buffer.spans.push_back(Span{name, begin, end});
+    }
+}
+
+std::string Trace::dumpJson(){
+    Registry& reg = registry();
+    std::ostringstream os;
+    os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    os << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"SISDServer\"}}";
+
+    std::lock_guard<std::mutex> lg(reg.mutex);
+    for(const auto& buffer : reg.buffers){
+        std::lock_guard<std::mutex> bufferLg(buffer->mutex);
+        if(buffer->spans.empty()){
+            continue;
+        }
+        os << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+                << ", \"args\": {\"name\": \"thread " << buffer->tid << "\"}}";
+        for(const auto& span : buffer->spans){
+            os << ",\n{\"name\": \"" << span.name << "\", \"cat\": \"sisd\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                    << buffer->tid << ", \"ts\": " << microseconds(span.begin - reg.epoch)
+                    << ", \"dur\": " << microseconds(span.end - span.begin) << "}";
+        }
+    }
+    os << "\n]}\n";
+    return os.str();
+}
+
+bool Trace::dumpToFile(const std::string& path){
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if(!out){
+        return false;
+    }
+    out << dumpJson();
+    return static_cast<bool>(out);
+}
+
+}
@@ -0,0 +1,142 @@
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+
+#include <common/captureFile.hpp>
+#include <server/profiling/metrics.hpp>
+#include <server/profiling/trafficCapture.hpp>
+#include <server/server/request.hpp>
+
+namespace SISD{
+
+class TrafficCapture::Impl{
+public:
+    Impl();
+
+    bool start(const Options& options);
+
+    void stop();
+
+    /// returns false once the file is full and recording should stop
+    bool record(const http::server::request& req);
+
+private:
+    std::mutex m_mutex;
+    Options m_options;
+    std::ofstream m_out;
+    uint64_t m_fileBytes;
+    std::mt19937 m_rng;
+    std::uniform_real_distribution<double> m_sampleDist;
+
+    /// reused to encode records
+    CapturedRequest m_record;
+    std::string m_buffer;
+};
+
+TrafficCapture::Impl::Impl(): m_fileBytes(0u), m_rng(std::random_device{}()), m_sampleDist(0.0, 1.0){
+
+}
+
+bool TrafficCapture::Impl::start(const Options& options){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    if(m_out.is_open()){
+        m_out.close();
+    }
+    m_options = options;
+    m_out.open(options.path, std::ios::binary | std::ios::app);
+    if(!m_out){
+        std::cerr << "[ ERROR ] Unable to open capture file " << options.path << std::endl;
+        return false;
+    }
+    m_out.seekp(0, std::ios::end);
+    m_fileBytes = static_cast<uint64_t>(m_out.tellp());
+    if(m_fileBytes == 0u){
+        m_buffer.clear();
+        CaptureFile::encodeHeader(m_buffer);
+        m_out.write(m_buffer.data(), m_buffer.length());
+        m_fileBytes += m_buffer.length();
+    }
+    return static_cast<bool>(m_out.flush());
+}
+
+void TrafficCapture::Impl::stop(){
+    std::lock_guard<std::mutex> lg(m_mutex);
+    if(m_out.is_open()){
+        m_out.close();
+    }
+}
+
+bool TrafficCapture::Impl::record(const http::server::request& req){
+    if(req.jsonData.length() > m_options.maxRequestBytes){
+        return true;
+    }
+    std::lock_guard<std::mutex> lg(m_mutex);
+    if(!m_out.is_open()){
+        return false;
+    }
+    if(m_options.sampleRate < 1.0 && m_sampleDist(m_rng) >= m_options.sampleRate){
+        return true;
+    }
+
+    m_record.arrivalUs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(req.arrival.time_since_epoch()).count());
+    m_record.method = req.method;
+    m_record.uri = req.uri;
+    m_record.headers.clear();
+    for(const auto& header : req.headers){
+        m_record.headers.emplace_back(header.name, header.value);
+    }
+    m_record.body = req.jsonData;
+    m_buffer.clear();
+    CaptureFile::encodeRecord(m_record, m_buffer);
+    if(m_fileBytes + m_buffer.length() > m_options.maxFileBytes){
+        std::cout << "[ INFO ] Capture file " << m_options.path << " is full, recording stopped" << std::endl;
+        m_out.close();
+        return false;
+    }
+
+    // flushed per record so the file stays readable if the server dies
+    m_out.write(m_buffer.data(), m_buffer.length());
+    m_out.flush();
+    m_fileBytes += m_buffer.length();
+    Metrics& metrics = Metrics::getInstance();
+    metrics.capturedRequests.add();
+    metrics.capturedBytes.add(m_buffer.length());
+    return true;
+}
+
+TrafficCapture::~TrafficCapture(){
+
+}
+
+TrafficCapture& TrafficCapture::getInstance(){
+    static TrafficCapture inst;
+    return inst;
+}
+
+bool TrafficCapture::start(const Options& options){
+    bool ret = m_impl->start(options);
+    m_enabled.store(ret, std::memory_order_relaxed);
+    return ret;
+}
+
+void TrafficCapture::stop(){
+    m_enabled.store(false, std::memory_order_relaxed);
+    m_impl->stop();
+}
+
+void TrafficCapture::record(const http::server::request& req){
+    if(!enabled()){
+        return;
+    }
+    if(!m_impl->record(req)){
+        m_enabled.store(false, std::memory_order_relaxed);
+    }
+}
+
+TrafficCapture::TrafficCapture(): m_enabled(false){
+    m_impl = std::unique_ptr<Impl>(new Impl);
+}
+
+}
@@ -11,9 +11,12 @@
 #include "server/server/connection.hpp"
 #include <vector>
 #include <boost/bind/bind.hpp>
+#include <boost/weak_ptr.hpp>
 #include "server/server/connection_manager.hpp"
 #include "server/server/request_handler.hpp"
 #include <iostream>
+#include <server/profiling/metrics.hpp>
+#include <server/profiling/trace.hpp>
 
 namespace http {
 namespace server {
@@ -22,7 +25,8 @@ connection::connection(boost::asio::io_context& io_context,
     connection_manager& manager, request_handler& handler)
   : socket_(io_context),
     connection_manager_(manager),
-    request_handler_(handler)
+    request_handler_(handler),
+    wait_timer_(io_context)
 {
 }
 
@@ -33,6 +37,8 @@ boost::asio::ip::tcp::socket& connection::socket()
 
 void connection::start()
 {
+  start_time_ = SISD::StageTimings::Clock::now();
+  request_.arrival = std::chrono::system_clock::now();
   socket_.async_read_some(boost::asio::buffer(buffer_), //to-do : check here
       boost::bind(&connection::handle_read, shared_from_this(),
         boost::asio::placeholders::error,
@@ -42,6 +48,7 @@ void connection::start()
 void connection::stop()
 {
   socket_.close();
+  wait_timer_.cancel();
 }
 
 void connection::handle_read(const boost::system::error_code& e,
@@ -51,27 +58,45 @@ void connection::handle_read(const boost::system::error_code& e,
   // std::cout<<"Handle read receives "<<bytes_transferred<<std::endl;
   if (!e)
   {
+    SISD::Metrics::getInstance().bytesReceived.add(bytes_transferred);
+
     boost::tribool result;
-    boost::tie(result, boost::tuples::ignore) = request_parser_.parse(
-        request_, buffer_.data(), buffer_.data() + bytes_transferred);
+    {
+      SISD_TRACE_SCOPE("connection read");
+      SISD::StageTimings::Scope scope(&request_.timings, SISD::StageTimings::Parse);
+      boost::tie(result, boost::tuples::ignore) = request_parser_.parse(
+          request_, buffer_.data(), buffer_.data() + bytes_transferred);
+    }
 
     if (result)
     {
+      // everything between accepting the connection and the complete request
+      // which was not spent parsing is accounted as receiving
+      SISD::StageTimings::Clock::duration elapsed =
+        SISD::StageTimings::Clock::now() - start_time_;
+      request_.timings.add(SISD::StageTimings::Receive,
+          elapsed - request_.timings.duration(SISD::StageTimings::Parse));
+
       // std::cout<<"\r\n\r\nbody received"<<std::endl;
       // std::cout<<request_.jsonData<<std::endl;
       // std::cout<<"end\r\n\r\n"<<std::endl;
 
       request_handler_.handle_request(request_, reply_);
-      boost::asio::async_write(socket_, reply_.to_buffers(),
-          boost::bind(&connection::handle_write, shared_from_this(),
-            boost::asio::placeholders::error));
+      if (reply_.wait)
+      {
+        start_wait();
+      }
+      else
+      {
+        start_write();
+      }
     }
     else if (!result)
     {
       reply_ = reply::stock_reply(reply::bad_request);
-      boost::asio::async_write(socket_, reply_.to_buffers(),
-          boost::bind(&connection::handle_write, shared_from_this(),
-            boost::asio::placeholders::error));
+      SISD::Metrics::getInstance().countRequest(SISD::Metrics::Other,
+          reply_.status, SISD::StageTimings::Clock::now() - start_time_);
+      start_write();
     }
     else
     {
@@ -87,8 +112,34 @@ void connection::handle_read(const boost::system::error_code& e,
   }
 }
 
-void connection::handle_write(const boost::system::error_code& e)
+void connection::handle_write(const boost::system::error_code& e,
+    std::size_t bytes_transferred)
 {
+  SISD::Metrics::getInstance().bytesSent.add(bytes_transferred);
+
+  if (!e && reply_.next_chunk)
+  {
+    // Keep writing a streamed reply until its producer runs dry.
+    chunk_.clear();
+    bool more = true;
+    while (more && chunk_.empty())
+    {
+      more = reply_.next_chunk(chunk_);
+    }
+    if (!more)
+    {
+      reply_.next_chunk = nullptr;
+    }
+    if (!chunk_.empty())
+    {
+      boost::asio::async_write(socket_, boost::asio::buffer(chunk_),
+          boost::bind(&connection::handle_write, shared_from_this(),
+            boost::asio::placeholders::error,
+            boost::asio::placeholders::bytes_transferred));
+      return;
+    }
+  }
+
   if (!e)
   {
     // Initiate graceful connection closure.
@@ -102,5 +153,57 @@ void connection::handle_write(const boost::system::error_code& e)
   }
 }
 
+void connection::start_write()
+{
+  boost::asio::async_write(socket_, reply_.to_buffers(),
+      boost::bind(&connection::handle_write, shared_from_this(),
+        boost::asio::placeholders::error,
+        boost::asio::placeholders::bytes_transferred));
+}
+
+void connection::start_wait()
+{
+  // The pending timer keeps the connection alive while it waits. The waited
+  // for event only gets a weak reference, so that one that comes late, or
+  // never, does not hold on to connections which timed out long ago.
+  wait_timer_.expires_after(reply_.wait_timeout);
+  wait_timer_.async_wait(boost::bind(&connection::handle_wait_timeout,
+        shared_from_this(), boost::asio::placeholders::error));
+
+  boost::weak_ptr<connection> weak_self(shared_from_this());
+  auto executor = socket_.get_executor();
+  std::function<void(const std::function<void()>&)> wait;
+  wait.swap(reply_.wait);
+  wait([weak_self, executor]()
+  {
+    if (connection_ptr self = weak_self.lock())
+    {
+      boost::asio::post(executor,
+          boost::bind(&connection::finish_wait, self));
+    }
+  });
+}
+
+void connection::finish_wait()
+{
+  if (!reply_.complete || !socket_.is_open())
+  {
+    return;
+  }
+  wait_timer_.cancel();
+  std::function<void(reply&)> complete;
+  complete.swap(reply_.complete);
+  complete(reply_);
+  start_write();
+}
+
+void connection::handle_wait_timeout(const boost::system::error_code& e)
+{
+  if (e != boost::asio::error::operation_aborted)
+  {
+    finish_wait();
+  }
+}
+
 } // namespace server
 } // namespace http
@@ -11,19 +11,26 @@
 #include "server/server/connection_manager.hpp"
 #include <algorithm>
 #include <boost/bind/bind.hpp>
+#include <server/profiling/metrics.hpp>
 
 namespace http {
 namespace server {
 
 void connection_manager::start(connection_ptr c)
 {
-  connections_.insert(c);
+  if (connections_.insert(c).second)
+  {
+    SISD::Metrics::getInstance().connectionsInFlight.add();
+  }
   c->start();
 }
 
 void connection_manager::stop(connection_ptr c)
 {
-  connections_.erase(c);
+  if (connections_.erase(c))
+  {
+    SISD::Metrics::getInstance().connectionsInFlight.sub();
+  }
   c->stop();
 }
 
@@ -31,6 +38,7 @@ void connection_manager::stop_all()
 {
   std::for_each(connections_.begin(), connections_.end(),
       boost::bind(&connection::stop, boost::placeholders::_1));
+  SISD::Metrics::getInstance().connectionsInFlight.sub(connections_.size());
   connections_.clear();
 }
 
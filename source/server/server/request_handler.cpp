@@ -14,32 +14,346 @@
 #include <sstream>
 #include <string>
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include "server/server/mime_types.hpp"
 #include "server/server/reply.hpp"
 #include "server/server/request.hpp"
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <stdlib.h>
+#include <limits>
 #include <thread>
 #include <memory>
 
 #include <server/PersonPipeline/PersonPipeline.hpp>
 #include <common/utility/base64.h>
+#include <server/database/attributeStats.hpp>
+#include <server/database/historyExport.hpp>
 #include <server/database/historyStorage.hpp>
+#include <server/jobs/jobQueue.hpp>
+#include <server/profiling/layerProfile.hpp>
+#include <server/profiling/metrics.hpp>
+#include <server/profiling/trace.hpp>
+#include <server/profiling/trafficCapture.hpp>
 
 namespace http {
 namespace server {
 
-request_handler::request_handler(const std::string& doc_root)
-  : doc_root_(doc_root)
+namespace {
+
+/// Accounts a request to its route once the handler returns, whichever branch
+/// produced the reply.
+class request_accounting
+  : private boost::noncopyable
+{
+public:
+  explicit request_accounting(const reply& rep)
+    : rep_(rep),
+      route_(SISD::Metrics::Other),
+      start_(SISD::StageTimings::Clock::now())
+  {
+  }
+
+  ~request_accounting()
+  {
+    SISD::Metrics::getInstance().countRequest(route_, rep_.status,
+        SISD::StageTimings::Clock::now() - start_);
+  }
+
+  void set_route(SISD::Metrics::Route route)
+  {
+    route_ = route;
+  }
+
+private:
+  const reply& rep_;
+  SISD::Metrics::Route route_;
+  SISD::StageTimings::Clock::time_point start_;
+};
+
+/// Records fetched from history storage per chunk of a streamed /history reply.
+const std::size_t history_stream_chunk = 256;
+
+/// Records read from history storage per chunk of a /history/export reply.
+/// Larger than for /history, as export clients read the whole range anyway.
+const std::size_t history_export_chunk = 1024;
+
+/// Render history records in the reply format the client asked for. Records
+/// already stored in that format are copied as they are and only the others
+/// are converted, so binary clients of binary records decode nothing. Binary
+/// replies are a sequence of frames, which clients decode as a whole.
+void append_history(const SISD::HistoryStorage::RecordVec& records,
+    bool binary, std::string& out)
+{
+  if (binary)
+  {
+    // json records are parsed back and packed together in a single frame
+    const std::size_t start = out.size();
+    SISD::ImageRecordVec images;
+    for (const auto& record : records)
+    {
+      if (SISD::ResultCodec::isBinary(record.second))
+      {
+        out.append(record.second);
+      }
+      else
+      {
+        SISD::ResultCodec::fromJson(record.second, images);
+      }
+    }
+    if (!images.empty() || out.size() == start)
+    {
+      SISD::ResultCodec::encodeBinary(images, out);
+    }
+  }
+  else
+  {
+    for (const auto& record : records)
+    {
+      if (SISD::ResultCodec::isBinary(record.second))
+      {
+        SISD::ImageRecordVec images;
+        SISD::ResultCodec::decodeBinary(record.second.data(), record.second.size(), images);
+        out.append(SISD::ResultCodec::toJson(images));
+      }
+      else
+      {
+        out.append(record.second);
+      }
+    }
+  }
+}
+
+/// Parse a comma-separated list of attribute names into a bitmask.
+bool parse_attributes(const std::string& in, uint32_t& mask)
+{
+  mask = 0;
+  std::string::size_type start = 0;
+  while (start <= in.size())
+  {
+    std::string::size_type end = in.find(',', start);
+    if (end == std::string::npos)
+    {
+      end = in.size();
+    }
+    uint32_t attribute = SISD::ResultCodec::attributeMask(in.substr(start, end - start));
+    if (attribute == 0)
+    {
+      return false;
+    }
+    mask |= attribute;
+    start = end + 1;
+  }
+  return true;
+}
+
+/// Check whether the entity tag is listed in an If-None-Match header of the
+/// request, or the header is "*". Weak tags compare like strong ones, as the
+/// comparison for GET requests is the weak one.
+bool if_none_match(const request& req, const std::string& etag)
+{
+  for (const auto& h : req.headers)
+  {
+    if (!boost::algorithm::iequals(h.name, "If-None-Match"))
+    {
+      continue;
+    }
+    std::string::size_type start = 0;
+    while (start <= h.value.size())
+    {
+      std::string::size_type end = h.value.find(',', start);
+      if (end == std::string::npos)
+      {
+        end = h.value.size();
+      }
+      std::string tag = h.value.substr(start, end - start);
+      tag.erase(0, tag.find_first_not_of(" \t"));
+      tag.erase(tag.find_last_not_of(" \t") + 1);
+      if (tag.compare(0, 2, "W/") == 0)
+      {
+        tag.erase(0, 2);
+      }
+      if (tag == "*" || tag == etag)
+      {
+        return true;
+      }
+      start = end + 1;
+    }
+  }
+  return false;
+}
+
+/// Check whether an Accept-Encoding header of the request lists gzip, and
+/// does not give it a quality of zero.
+bool accepts_gzip(const request& req)
+{
+  for (const auto& h : req.headers)
+  {
+    if (!boost::algorithm::iequals(h.name, "Accept-Encoding"))
+    {
+      continue;
+    }
+    std::string::size_type start = 0;
+    while (start <= h.value.size())
+    {
+      std::string::size_type end = h.value.find(',', start);
+      if (end == std::string::npos)
+      {
+        end = h.value.size();
+      }
+      std::string coding = h.value.substr(start, end - start);
+      std::string::size_type params = coding.find(';');
+      std::string quality = params == std::string::npos ? "" : coding.substr(params + 1);
+      coding = coding.substr(0, params);
+      coding.erase(0, coding.find_first_not_of(" \t"));
+      coding.erase(coding.find_last_not_of(" \t") + 1);
+      quality.erase(0, quality.find_first_not_of(" \t"));
+      if (boost::algorithm::iequals(coding, "gzip")
+          && (quality.compare(0, 2, "q=") != 0 || strtod(quality.c_str() + 2, nullptr) > 0.0))
+      {
+        return true;
+      }
+      start = end + 1;
+    }
+  }
+  return false;
+}
+
+/// Parse a /stats window: a number of seconds, or of minutes, hours or days
+/// when followed by m, h or d. Zero and negative lengths are rejected.
+bool parse_window(const std::string& in, std::chrono::seconds& window)
+{
+  if (in.empty())
+  {
+    return false;
+  }
+  std::string number = in;
+  int64_t unit = 1;
+  switch (in.back())
+  {
+  case 's': unit = 1; number.pop_back(); break;
+  case 'm': unit = 60; number.pop_back(); break;
+  case 'h': unit = 3600; number.pop_back(); break;
+  case 'd': unit = 86400; number.pop_back(); break;
+  default: break;
+  }
+  int64_t value = 0;
+  try
+  {
+    value = boost::lexical_cast<int64_t>(number);
+  }
+  catch (const boost::bad_lexical_cast&)
+  {
+    return false;
+  }
+  if (value <= 0 || value > std::numeric_limits<int64_t>::max() / unit)
+  {
+    return false;
+  }
+  window = std::chrono::seconds(value * unit);
+  return true;
+}
+
+/// Longest a /jobs/{handle} request may wait for its job to finish.
+const int job_max_wait_seconds = 60;
+
+/// Fill in the reply to a /jobs/{handle} request: once the job is done its
+/// results as /predict returns them, otherwise a json object with its status,
+/// with 202 while it is pending and 500 if it failed.
+void job_reply(SISD::HistoryStorage::JobHandle handle, bool binary, reply& rep)
+{
+  SISD::JobQueue::Status status;
+  SISD::ImageRecordVec results;
+  if (!SISD::JobQueue::getInstance().lookup(handle, status, results))
+  {
+    rep = reply::stock_reply(reply::not_found);
+    return;
+  }
+  rep.content.clear();
+  if (status == SISD::JobQueue::Done)
+  {
+    rep.status = reply::ok;
+    if (binary)
+    {
+      SISD::ResultCodec::encodeBinary(results, rep.content);
+    }
+    else
+    {
+      rep.content = SISD::ResultCodec::toJson(results);
+    }
+  }
+  else
+  {
+    rep.status = status == SISD::JobQueue::Failed ?
+        reply::internal_server_error : reply::accepted;
+    binary = false;
+    rep.content = "{\"handle\": \"" + std::to_string(handle) + "\", \"status\": \""
+        + SISD::JobQueue::statusName(status) + "\"}\n";
+  }
+  rep.headers.resize(3);
+  rep.headers[0].name = "Content-Length";
+  rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
+  rep.headers[1].name = "Content-Type";
+  rep.headers[1].value = binary ? SISD::ResultCodec::binaryMimeType : mime_types::extension_to_type("json");
+  rep.headers[2].name = "X-Job-Status";
+  rep.headers[2].value = SISD::JobQueue::statusName(status);
+}
+
+/// Where the pages of a /history reply are read from: the whole history, the
+/// records saved within a time range, or the records matching an attribute
+/// filter, which are looked up once for all pages.
+struct history_query
+{
+  bool by_time = false;
+  int64_t from_ms = std::numeric_limits<int64_t>::min();
+  int64_t to_ms = std::numeric_limits<int64_t>::max();
+  std::shared_ptr<const SISD::HistoryStorage::FilterResult> matches;
+
+  bool fetch(const std::string& cursor, std::size_t count,
+      SISD::HistoryStorage::RecordVec& records, std::string& next) const
+  {
+    SISD::HistoryStorage& storage = SISD::HistoryStorage::getInstance();
+    if (matches)
+    {
+      // the cursor of a filtered history is the offset into the matches
+      std::size_t offset = strtoull(cursor.c_str(), nullptr, 10);
+      next = offset + count < matches->handles.size() ?
+          boost::lexical_cast<std::string>(offset + count) : "0";
+      return storage.fetch(matches->handles, offset, count, records);
+    }
+    if (by_time)
+    {
+      return storage.scanRange(from_ms, to_ms, cursor, count, records, next);
+    }
+    return storage.scan(cursor, count, records, next);
+  }
+};
+
+} // namespace
+
+request_handler::request_handler(const std::string& doc_root,
+    const SISD::BackendConfig& backend)
+  : doc_root_(doc_root),
+    backend_(backend)
+{
+}
+
+request_handler::~request_handler()
 {
 }
 
 void request_handler::handle_request(const request& req, reply& rep)
 {
-  // Decode url to path.
+  SISD_TRACE_SCOPE("handle_request");
+  request_accounting accounting(rep);
+
+  // Decode url to path and query parameters.
   std::string request_path;
-  if (!url_decode(req.uri, request_path))
+  std::unordered_map<std::string, std::string> query;
+  std::string::size_type query_pos = req.uri.find('?');
+  if (!url_decode(req.uri.substr(0, query_pos), request_path)
+      || (query_pos != std::string::npos
+        && !parseQuery(req.uri.substr(query_pos + 1), query)))
   {
     rep = reply::stock_reply(reply::bad_request);
     return;
@@ -55,63 +369,285 @@ void request_handler::handle_request(const request& req, reply& rep)
 
   if(request_path == "/predict"){
     // in case of predict route
-    std::string boundary = "";
-
-    // as the http request transmit multiple images in form of multipart message
-    //  we need to find out what the boundary is
-    for(const auto& iter : req.headers){
-      if(iter.name == "Content-Type"){
-        if(!retrieveMultipartBoundary(iter.value, boundary)){
-          rep = reply::stock_reply(reply::bad_request);
-          return;
-        }
+    accounting.set_route(SISD::Metrics::Predict);
+    SISD::TrafficCapture::getInstance().record(req);
+    std::unordered_map<std::string, std::string> images;
+    if(!retrieveRequestImages(req, images)){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+
+    // the client may ask for the compact binary layout instead of json, and
+    //  for the stage timings to be embedded in the json body
+    bool binaryReply = acceptsBinary(req);
+    bool timingInBody = !binaryReply && query.count("timing") && query["timing"] != "0";
+    SISD::StageTimings timings = req.timings;
+    std::vector<SISD::StageTimings> imageTimings(images.size());
+
+    // the person pipeline, which consists of a detection network and a person
+    //  attribute classification network, is loaded once and reused
+    if(!pipeline_){
+      std::unique_ptr<SISD::PersonPipeline> pipeline(new SISD::PersonPipeline(backend_));
+      if(!pipeline->init()){
+        rep = reply::stock_reply(reply::service_unavailable);
+        return;
       }
+      pipeline_ = std::move(pipeline);
     }
-    if(boundary==""){
+
+    SISD::Metrics& metrics = SISD::Metrics::getInstance();
+    metrics.inferenceQueueDepth.add();
+
+    SISD::ImageRecordVec results;
+    results.reserve(images.size());
+    for(const auto& iter : images){
+      SISD::StageTimings& imageTiming = imageTimings[results.size()];
+      std::string decoded;
+      {
+        SISD::StageTimings::Scope scope(&imageTiming, SISD::StageTimings::Base64Decode);
+        SISD_TRACE_SCOPE("base64_decode");
+        std::string base64(iter.second);
+        base64.shrink_to_fit();
+
+        // decode base64 to raw binary in form of its original image format
+        decoded = base64_decode(base64, true);
+      }
+
+      // run the pipeline
+      SISD::ImageRecord result;
+      pipeline_->run(decoded.data(), decoded.length(), iter.first, result, &imageTiming);
+      metrics.imagesProcessed.add();
+      metrics.personsDetected.add(result.persons.size());
+      results.push_back(std::move(result));
+      timings.merge(imageTiming);
+    }
+    metrics.inferenceQueueDepth.sub();
+    // we combine results from batch of images together to a single json string
+    std::string stringReplyData;
+    {
+      SISD::StageTimings::Scope scope(&timings, SISD::StageTimings::Serialization);
+      stringReplyData = SISD::ResultCodec::toJson(results);
+    }
+
+    // generate a unique storage handle and queue the result for history storage,
+    //  which writes it in the background
+    {
+      SISD::StageTimings::Scope scope(&timings, SISD::StageTimings::Storage);
+      SISD::HistoryStorage::JobHandle handle = SISD::HistoryStorage::getInstance().generateHandle();
+      SISD::HistoryStorage::getInstance().save(handle, stringReplyData, results);
+    }
+
+    // make reply
+    if(binaryReply){
+      SISD::StageTimings::Scope scope(&timings, SISD::StageTimings::Serialization);
+      SISD::ResultCodec::encodeBinary(results, rep.content);
+    }
+    else if(timingInBody){
+      rep.content.append("{\n\"results\": ");
+      rep.content.append(stringReplyData);
+      rep.content.append(",\n\"timing\": {\"request\": ");
+      rep.content.append(timings.toJson());
+      rep.content.append(", \"images\": {");
+      for(std::size_t i = 0; i < results.size(); ++i){
+        // image names are the client's file names and may hold any character
+        rep.content.append(i == 0 ? "" : ", ");
+        SISD::ResultCodec::appendJsonString(rep.content, results[i].imageName);
+        rep.content.append(": ");
+        rep.content.append(imageTimings[i].toJson());
+      }
+      rep.content.append("}}\n}\n");
+    }
+    else{
+      rep.content.append(stringReplyData);
+    }
+    
+    rep.status = reply::ok;
+    rep.headers.resize(3);
+    rep.headers[0].name = "Content-Length";
+    rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
+    rep.headers[1].name = "Content-Type";
+    rep.headers[1].value = binaryReply ? SISD::ResultCodec::binaryMimeType : mime_types::extension_to_type("json");
+    rep.headers[2].name = "Server-Timing";
+    rep.headers[2].value = timings.toServerTiming();
+
+    metrics.observeStages(timings);
+  }
+  else if(request_path == "/history"){
+    // in case of a history route, either return one page of records if a
+    //  limit is given, or stream all of them page by page. from and to, in
+    //  milliseconds since epoch, restrict the records to a time range, and
+    //  attributes to those with a person having all the listed attributes
+    accounting.set_route(SISD::Metrics::History);
+    bool binaryReply = acceptsBinary(req);
+    std::size_t limit = 0;
+    std::string cursor = "0";
+    uint32_t attributes = 0;
+    history_query history;
+    if(query.count("attributes") && !parse_attributes(query["attributes"], attributes)){
       rep = reply::stock_reply(reply::bad_request);
       return;
     }
-
-    // with known boundary, we extract the image data encoded in base64
-    std::unordered_map<std::string, std::string> images;
-    if(!retrieveImages(boundary, req.jsonData, images)){
+    try{
+      if(query.count("from")){
+        history.by_time = true;
+        history.from_ms = boost::lexical_cast<int64_t>(query["from"]);
+      }
+      if(query.count("to")){
+        history.by_time = true;
+        history.to_ms = boost::lexical_cast<int64_t>(query["to"]);
+      }
+      if(query.count("limit")){
+        limit = boost::lexical_cast<std::size_t>(query["limit"]);
+      }
+      if(query.count("cursor")){
+        cursor = query["cursor"];
+      }
+    }
+    catch(const boost::bad_lexical_cast&){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+    if((query.count("limit") && limit == 0) || history.from_ms > history.to_ms ||
+        !SISD::HistoryStorage::isCursor(cursor)){
       rep = reply::stock_reply(reply::bad_request);
       return;
     }
 
-    // start and init the person pipeline, which consists of a detection 
-    //  network and a person attribute classification network
-    SISD::PersonPipeline person;
-    person.init();
+    // the entity tag is the version of the history, taken before anything is
+    //  read so that a record saved meanwhile changes the tag of the next poll.
+    //  A client that already has this version gets a 304 without the database
+    //  being queried
+    header etag;
+    etag.name = "ETag";
+    etag.value = "\"" + SISD::HistoryStorage::getInstance().versionTag() + (binaryReply ? "-b" : "-j") + "\"";
+    if(if_none_match(req, etag.value)){
+      rep.status = reply::not_modified;
+      rep.content.clear();
+      rep.headers.assign(1, etag);
+      return;
+    }
 
-    std::vector<std::string> results;
-    std::stringstream replyData;
-    for(const auto& iter : images){
-      // std::cout<<"Filename: "<<iter.first<<std::endl;
-      // std::cout<<"Image data: "<<std::endl;
-      // std::cout<<iter.second<<std::endl;
+    // the records matching a filter are counted up front and the counts sent
+    //  as headers, so a client can learn them from a page of a single record
+    std::vector<header> match_headers;
+    if(attributes != 0){
+      std::shared_ptr<SISD::HistoryStorage::FilterResult> matches(new SISD::HistoryStorage::FilterResult);
+      if(!SISD::HistoryStorage::getInstance().filter(attributes, history.from_ms, history.to_ms, *matches)){
+        rep = reply::stock_reply(reply::service_unavailable);
+        return;
+      }
+      match_headers.resize(2);
+      match_headers[0].name = "X-Match-Records";
+      match_headers[0].value = boost::lexical_cast<std::string>(matches->handles.size());
+      match_headers[1].name = "X-Match-Persons";
+      match_headers[1].value = boost::lexical_cast<std::string>(matches->persons);
+      history.matches = matches;
+    }
 
-      std::string base64(iter.second);
-      base64.shrink_to_fit();
+    if(limit > 0){
+      SISD::HistoryStorage::RecordVec records;
+      std::string next;
+      if(!history.fetch(cursor, limit, records, next)){
+        rep = reply::stock_reply(reply::service_unavailable);
+        return;
+      }
+      append_history(records, binaryReply, rep.content);
+
+      rep.status = reply::ok;
+      rep.headers.resize(3);
+      rep.headers[0].name = "Content-Length";
+      rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
+      rep.headers[1].name = "Content-Type";
+      rep.headers[1].value = binaryReply ? SISD::ResultCodec::binaryMimeType : mime_types::extension_to_type("json");
+      // a cursor of 0 means the scan is complete
+      rep.headers[2].name = "X-Next-Cursor";
+      rep.headers[2].value = next;
+      rep.headers.push_back(etag);
+      rep.headers.insert(rep.headers.end(), match_headers.begin(), match_headers.end());
+      return;
+    }
 
-      // decode base64 to raw binary in form of its original image format
-      std::string decoded = base64_decode(base64, true);
+    // the connection asks for the next page once the previous one has been
+    //  written, so only one page is held in memory however large the history is
+    rep.next_chunk = [binaryReply, history, cursor](std::string& chunk) mutable {
+      SISD::HistoryStorage::RecordVec records;
+      std::string next;
+      if(!history.fetch(cursor, history_stream_chunk, records, next)){
+        // the reply is cut short, which the client notices as a malformed body
+        return false;
+      }
+      append_history(records, binaryReply, chunk);
+      cursor = next;
+      return cursor != "0";
+    };
 
-      // run the pipeline
-      results.push_back(person.run(decoded.data(), decoded.length(), iter.first));
+    rep.status = reply::ok;
+    rep.headers.resize(1);
+    rep.headers[0].name = "Content-Type";
+    rep.headers[0].value = binaryReply ? SISD::ResultCodec::binaryMimeType : mime_types::extension_to_type("json");
+    rep.headers.push_back(etag);
+    rep.headers.insert(rep.headers.end(), match_headers.begin(), match_headers.end());
+  }
+  else if(request_path == "/history/export"){
+    // in case of an export route, stream all records of a time range, oldest
+    //  first, as json lines or columnar batches. Only a page of records and
+    //  its encoding are held in memory at a time, and the output is gzip
+    //  compressed if the client accepts it and the server is built with zlib
+    accounting.set_route(SISD::Metrics::Export);
+    SISD::HistoryExport::Format format = SISD::HistoryExport::Ndjson;
+    int64_t from_ms = std::numeric_limits<int64_t>::min();
+    int64_t to_ms = std::numeric_limits<int64_t>::max();
+    if(query.count("format") && !SISD::HistoryExport::parseFormat(query["format"], format)){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+    try{
+      if(query.count("from")){
+        from_ms = boost::lexical_cast<int64_t>(query["from"]);
+      }
+      if(query.count("to")){
+        to_ms = boost::lexical_cast<int64_t>(query["to"]);
+      }
+    }
+    catch(const boost::bad_lexical_cast&){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+    if(from_ms > to_ms){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
     }
-    // we combine results from batch of images together to a single string
-    combineJsonResults(results, replyData);
 
-    std::string stringReplyData = replyData.str();
+    const bool gzip = SISD::HistoryExport::gzipAvailable() && accepts_gzip(req);
+    std::shared_ptr<SISD::HistoryExport> exporter(
+        new SISD::HistoryExport(format, from_ms, to_ms, history_export_chunk, gzip));
+    rep.next_chunk = [exporter](std::string& chunk) {
+      return exporter->next(chunk);
+    };
 
-    // generate a unique storage handle and save to history storage
-    SISD::HistoryStorage::JobHandle handle = SISD::HistoryStorage::getInstance().generateHandle();
-    SISD::HistoryStorage::getInstance().save(handle, stringReplyData);
+    rep.status = reply::ok;
+    rep.headers.resize(1);
+    rep.headers[0].name = "Content-Type";
+    rep.headers[0].value = SISD::HistoryExport::mimeType(format);
+    if(gzip){
+      rep.headers.resize(2);
+      rep.headers[1].name = "Content-Encoding";
+      rep.headers[1].value = "gzip";
+    }
+  }
+  else if(request_path == "/stats"){
+    // in case of a stats route, return the aggregates of the results saved
+    //  within the window, an hour unless given. They are kept up to date at
+    //  save time, so no stored record is read
+    accounting.set_route(SISD::Metrics::Stats);
+    std::chrono::seconds window = std::chrono::hours(1);
+    if(query.count("window") && (!parse_window(query["window"], window) ||
+        window > SISD::AttributeStats::maxWindow())){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+    rep.content = SISD::AttributeStats::getInstance().toJson(window);
 
-    // make reply
-    rep.content.append(stringReplyData);
-    
     rep.status = reply::ok;
     rep.headers.resize(2);
     rep.headers[0].name = "Content-Length";
@@ -119,19 +655,107 @@ void request_handler::handle_request(const request& req, reply& rep)
     rep.headers[1].name = "Content-Type";
     rep.headers[1].value = mime_types::extension_to_type("json");
   }
-  else if(request_path == "/history"){
-    // in case of a history route
+  else if(request_path == "/jobs"){
+    // in case of a jobs route, queue the images of a multipart request like
+    //  /predict takes them and return the handle of the job right away. The
+    //  job runs on the worker pool and is fetched from /jobs/{handle}
+    accounting.set_route(SISD::Metrics::Jobs);
+    SISD::TrafficCapture::getInstance().record(req);
+    SISD::JobQueue::ImageMap images;
+    if(!retrieveRequestImages(req, images)){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+    SISD::HistoryStorage::JobHandle handle;
+    if(!SISD::JobQueue::getInstance().submit(images, handle)){
+      // the queue is full, the client should try again later
+      rep = reply::stock_reply(reply::service_unavailable);
+      return;
+    }
+    rep.content = "{\"handle\": \"" + std::to_string(handle) + "\", \"status\": \""
+        + SISD::JobQueue::statusName(SISD::JobQueue::Queued) + "\"}\n";
 
-    // we retrieve all records in database
-    std::unordered_map<std::string, std::string> history;
-    SISD::HistoryStorage::getInstance().getAll(history);
+    rep.status = reply::accepted;
+    rep.headers.resize(3);
+    rep.headers[0].name = "Content-Length";
+    rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
+    rep.headers[1].name = "Content-Type";
+    rep.headers[1].value = mime_types::extension_to_type("json");
+    rep.headers[2].name = "Location";
+    rep.headers[2].value = "/jobs/" + std::to_string(handle);
+  }
+  else if(request_path.compare(0, 6, "/jobs/") == 0){
+    // in case of a job route, return the status or the results of a job. With
+    //  wait, a pending job is waited for up to that many seconds without
+    //  blocking the server, and the reply is sent as soon as it finishes
+    accounting.set_route(SISD::Metrics::Jobs);
+    SISD::HistoryStorage::JobHandle handle = 0;
+    int wait = 0;
+    try{
+      handle = boost::lexical_cast<SISD::HistoryStorage::JobHandle>(request_path.substr(6));
+      if(query.count("wait")){
+        wait = boost::lexical_cast<int>(query["wait"]);
+      }
+    }
+    catch(const boost::bad_lexical_cast&){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
+    if(wait < 0 || wait > job_max_wait_seconds){
+      rep = reply::stock_reply(reply::bad_request);
+      return;
+    }
 
-    // make reply
-    std::stringstream replyData;
-    for(const auto& iter : history){
-      replyData << iter.second;
+    bool binaryReply = acceptsBinary(req);
+    if(wait == 0){
+      job_reply(handle, binaryReply, rep);
+      return;
     }
-    rep.content.append(replyData.str());
+    // a job that is not pending, or unknown, completes the wait right away.
+    //  The request is accounted when the wait starts
+    rep.status = reply::accepted;
+    rep.wait = [handle](const std::function<void()>& ready){
+      if(!SISD::JobQueue::getInstance().watch(handle, ready)){
+        ready();
+      }
+    };
+    rep.wait_timeout = std::chrono::seconds(wait);
+    rep.complete = [handle, binaryReply](reply& r){
+      job_reply(handle, binaryReply, r);
+    };
+  }
+  else if(request_path == "/metrics"){
+    // in case of a metrics route, export all counters and histograms
+    accounting.set_route(SISD::Metrics::MetricsRoute);
+    rep.content = SISD::Metrics::getInstance().exposition();
+
+    rep.status = reply::ok;
+    rep.headers.resize(2);
+    rep.headers[0].name = "Content-Length";
+    rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
+    rep.headers[1].name = "Content-Type";
+    rep.headers[1].value = "text/plain; version=0.0.4";
+  }
+  else if(request_path == "/debug/trace"){
+    // in case of a trace route, either start a capture of the given length or
+    //  return the spans recorded so far
+    accounting.set_route(SISD::Metrics::Debug);
+    if(query.count("seconds")){
+      int seconds = 0;
+      try{
+        seconds = boost::lexical_cast<int>(query["seconds"]);
+      }
+      catch(const boost::bad_lexical_cast&){
+      }
+      if(seconds <= 0){
+        rep = reply::stock_reply(reply::bad_request);
+        return;
+      }
+      SISD::Trace::start(std::chrono::seconds(seconds));
+      rep = reply::stock_reply(reply::accepted);
+      return;
+    }
+    rep.content = SISD::Trace::dumpJson();
 
     rep.status = reply::ok;
     rep.headers.resize(2);
@@ -139,7 +763,26 @@ void request_handler::handle_request(const request& req, reply& rep)
     rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
     rep.headers[1].name = "Content-Type";
     rep.headers[1].value = mime_types::extension_to_type("json");
+  }
+  else if(request_path == "/debug/layers"){
+    // in case of a layers route, optionally toggle or reset performance
+    //  counting, then return the per-layer table aggregated so far
+    accounting.set_route(SISD::Metrics::Debug);
+    SISD::LayerProfile& profile = SISD::LayerProfile::getInstance();
+    if(query.count("enable")){
+      profile.setEnabled(query["enable"] != "0");
+    }
+    if(query.count("reset") && query["reset"] != "0"){
+      profile.reset();
+    }
+    rep.content = profile.toJson();
 
+    rep.status = reply::ok;
+    rep.headers.resize(2);
+    rep.headers[0].name = "Content-Length";
+    rep.headers[0].value = boost::lexical_cast<std::string>(rep.content.size());
+    rep.headers[1].name = "Content-Type";
+    rep.headers[1].value = mime_types::extension_to_type("json");
   }
   else{
     // invalid route
@@ -294,14 +937,66 @@ bool request_handler::retrieveImageFromMultiPartMessage(const std::string& in, s
   return true;
 }
 
-bool request_handler::combineJsonResults(const std::vector<std::string>& results, std::stringstream& resultss){
-  resultss<<"{\n";
-  for(const auto& iter : results){
-    resultss << iter.substr(2, iter.length()-4);
+bool request_handler::parseQuery(const std::string& in, std::unordered_map<std::string, std::string>& out)
+{
+  out.clear();
+  std::string::size_type start = 0;
+  while (start <= in.size())
+  {
+    std::string::size_type end = in.find('&', start);
+    if (end == std::string::npos)
+    {
+      end = in.size();
+    }
+    if (end > start)
+    {
+      std::string::size_type eq = in.find('=', start);
+      std::string key;
+      std::string value;
+      if (eq == std::string::npos || eq > end)
+      {
+        eq = end;
+      }
+      if (!url_decode(in.substr(start, eq - start), key)
+          || (eq < end && !url_decode(in.substr(eq + 1, end - eq - 1), value)))
+      {
+        return false;
+      }
+      out[key] = value;
+    }
+    start = end + 1;
   }
-  resultss<<"}\n";
   return true;
 }
 
+bool request_handler::retrieveRequestImages(const request& req, std::unordered_map<std::string, std::string>& out){
+  std::string boundary = "";
+
+  // as the http request transmit multiple images in form of multipart message
+  //  we need to find out what the boundary is
+  for(const auto& iter : req.headers){
+    if(iter.name == "Content-Type"){
+      if(!retrieveMultipartBoundary(iter.value, boundary)){
+        return false;
+      }
+    }
+  }
+  if(boundary==""){
+    return false;
+  }
+
+  // with known boundary, we extract the image data encoded in base64
+  return retrieveImages(boundary, req.jsonData, out);
+}
+
+bool request_handler::acceptsBinary(const request& req){
+  for(const auto& iter : req.headers){
+    if(iter.name == "Accept" && iter.value.find(SISD::ResultCodec::binaryMimeType) != std::string::npos){
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace server
 } // namespace http
@@ -11,18 +11,20 @@
 #include "server/server/server.hpp"
 #include <boost/bind/bind.hpp>
 #include <signal.h>
+#include <server/profiling/trace.hpp>
 
 namespace http {
 namespace server {
 
 server::server(const std::string& address, const std::string& port,
-    const std::string& doc_root)
+    const std::string& doc_root, const SISD::BackendConfig& backend)
   : io_context_(),
     signals_(io_context_),
+    trace_signals_(io_context_),
     acceptor_(io_context_),
     connection_manager_(),
     new_connection_(),
-    request_handler_(doc_root)
+    request_handler_(doc_root, backend)
 {
   // Register to handle the signals that indicate when the server should exit.
   // It is safe to register for the same signal multiple times in a program,
@@ -34,6 +36,12 @@ server::server(const std::string& address, const std::string& port,
 #endif // defined(SIGQUIT)
   signals_.async_wait(boost::bind(&server::handle_stop, this));
 
+  // SIGUSR1 writes the spans recorded by the current trace capture to a file.
+#if defined(SIGUSR1)
+  trace_signals_.add(SIGUSR1);
+  trace_signals_.async_wait(boost::bind(&server::handle_trace_dump, this));
+#endif // defined(SIGUSR1)
+
   // Open the acceptor with the option to reuse the address (i.e. SO_REUSEADDR).
   boost::asio::ip::tcp::resolver resolver(io_context_);
   boost::asio::ip::tcp::endpoint endpoint =
@@ -81,12 +89,35 @@ void server::handle_accept(const boost::system::error_code& e)
   start_accept();
 }
 
+void server::handle_trace_dump()
+{
+  // The wait is cancelled when the server stops.
+  if (!acceptor_.is_open())
+  {
+    return;
+  }
+
+  const std::string path = "sisd_trace.json";
+  if (SISD::Trace::dumpToFile(path))
+  {
+    std::cout << "Trace written to " << path << std::endl;
+  }
+  else
+  {
+    std::cerr << "Unable to write trace to " << path << std::endl;
+  }
+
+  // Keep listening for further dump requests.
+  trace_signals_.async_wait(boost::bind(&server::handle_trace_dump, this));
+}
+
 void server::handle_stop()
 {
   // The server is stopped by cancelling all outstanding asynchronous
   // operations. Once all operations have finished the io_context::run() call
   // will exit.
   acceptor_.close();
+  trace_signals_.cancel();
   connection_manager_.stop_all();
 }
 
@@ -0,0 +1,112 @@
+#!/bin/bash
+# End-to-end performance regression test. Starts SISDServer on the mock inference backend with its history in a
+# private log, or in a private redis if asked to, drives a fixed closed loop workload with SISDLoad and checks it
+# against the recorded baseline. Without a baseline the workload is only reported, as the numbers depend on the
+# host; SISD_PERF_RECORD=1 records one from the run.
+#
+# usage: runPerfTest.sh <SISDServer> <SISDLoad> <artifact dir>
+#
+# Environment:
+#   SISD_PERF_PORT        port of the server, default 18080
+#   SISD_PERF_HISTORY     history backend of the server, log or redis, default log
+#   SISD_PERF_REDIS_PORT  port of the private redis, default 16379
+#   SISD_PERF_TOLERANCE   allowed relative regression, default 0.15
+#   SISD_PERF_BASELINE    baseline json, default baseline.json next to this script
+#   SISD_PERF_RECORD      1 to write the throughput and p99 of this run to the baseline instead of checking it
+#   REDIS_SERVER          redis-server executable, default the one on PATH
+#
+# Exit code 0 if the workload is within the baseline or there is none, 2 if it regressed, 77 if the redis history is
+# asked for and redis is not available and any other failure otherwise. Timings are written to
+# <artifact dir>/perf.json
+
+server=$1
+load=$2
+artifactDir=$3
+if [ -z "${server}" ] || [ -z "${load}" ] || [ -z "${artifactDir}" ]; then
+    echo "usage: $0 <SISDServer> <SISDLoad> <artifact dir>"
+    exit 1
+fi
+
+here=$(cd "$(dirname "$0")" && pwd)
+port=${SISD_PERF_PORT:-18080}
+redisPort=${SISD_PERF_REDIS_PORT:-16379}
+tolerance=${SISD_PERF_TOLERANCE:-0.15}
+baseline=${SISD_PERF_BASELINE:-${here}/baseline.json}
+history=${SISD_PERF_HISTORY:-log}
+redisServer=${REDIS_SERVER:-$(command -v redis-server)}
+
+if [ "${history}" != "log" ] && [ "${history}" != "redis" ]; then
+    echo "SISD_PERF_HISTORY must be log or redis"
+    exit 1
+fi
+if [ "${history}" = "redis" ] && [ -z "${redisServer}" ]; then
+    echo "redis-server not found, skipping"
+    exit 77
+fi
+
+mkdir -p "${artifactDir}"
+workDir=$(mktemp -d)
+pids=()
+cleanup() {
+    for pid in "${pids[@]}"; do
+        kill "${pid}" 2>/dev/null
+        wait "${pid}" 2>/dev/null
+    done
+    rm -rf "${workDir}"
+}
+trap cleanup EXIT
+
+# wait until something listens on a local port
+waitForPort() {
+    for i in $(seq 1 100); do
+        if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "nothing is listening on port $1"
+    return 1
+}
+
+if [ "${history}" = "redis" ]; then
+    "${redisServer}" --port "${redisPort}" --bind 127.0.0.1 --save "" --appendonly no --dir "${workDir}" \
+        > "${artifactDir}/redis.log" 2>&1 &
+    pids+=($!)
+    waitForPort "${redisPort}" || exit 1
+    historyArgs=(--history-backend redis --redis "tcp://127.0.0.1:${redisPort}")
+else
+    historyArgs=(--history-backend log --history-log-dir "${workDir}/history.log")
+fi
+
+# the server runs in the work directory so that it does not pick up models or traces lying around
+(cd "${workDir}" && exec "${server}" -a 127.0.0.1 -p "${port}" -b mock "${historyArgs[@]}") \
+    > "${artifactDir}/server.log" 2>&1 &
+pids+=($!)
+waitForPort "${port}" || exit 1
+
+checkArgs=()
+if [ "${SISD_PERF_RECORD}" != "1" ]; then
+    if [ -f "${baseline}" ]; then
+        checkArgs=(--baseline "${baseline}" --tolerance "${tolerance}")
+    else
+        echo "no baseline at ${baseline}, reporting only. Record one on this host with SISD_PERF_RECORD=1"
+    fi
+fi
+
+# the warm-up covers loading the mock networks on the first request
+"${load}" --host 127.0.0.1 -p "${port}" -d "${here}/images" -m closed -c 4 -t 20 -w 3 \
+    "${checkArgs[@]}" -j "${artifactDir}/perf.json"
+result=$?
+if [ ${result} -ne 0 ] || [ "${SISD_PERF_RECORD}" != "1" ]; then
+    exit ${result}
+fi
+
+# perf.json holds one stage; its throughput comes first and p99 is read from the latencies of all requests
+throughput=$(grep -o '"throughput": [0-9.]*' "${artifactDir}/perf.json" | head -n 1 | cut -d ' ' -f 2)
+p99=$(grep -o '"all": {[^}]*}' "${artifactDir}/perf.json" | grep -o '"p99": [0-9.]*' | cut -d ' ' -f 2)
+if [ -z "${throughput}" ] || [ -z "${p99}" ]; then
+    echo "unable to read the results of the run from ${artifactDir}/perf.json"
+    exit 1
+fi
+printf '{\n    "throughput": %s,\n    "p99_ms": %s\n}\n' "${throughput}" "${p99}" > "${baseline}"
+echo "recorded throughput ${throughput} req/s and p99 ${p99}ms to ${baseline}"